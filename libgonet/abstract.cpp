@@ -1,11 +1,44 @@
 #include "abstract.h"
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <unistd.h>
+#include <sys/un.h>
 
 namespace network {
 
     FakeSession SessionEntry::fake_sess;
 
+    SessionEntry SessionBase::GetSession()
+    {
+        return SessionEntry();
+    }
+
+    void SessionBase::SendShared(SharedBuffer const& buf, SndCb const& cb)
+    {
+        if (!buf) {
+            if (cb) cb(boost_ec());
+            return ;
+        }
+        Send(buf->data(), buf->size(), cb);
+    }
+
+    void SessionBase::SendFile(int fd, off_t offset, size_t bytes, SndCb const& cb)
+    {
+        Buffer buf(bytes);
+        size_t pos = 0;
+        while (pos < bytes) {
+            ssize_t n = ::pread(fd, &buf[pos], bytes - pos, offset + pos);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                if (cb) cb(boost_ec(n < 0 ? errno : EIO, boost::system::system_category()));
+                return ;
+            }
+            pos += n;
+        }
+        Send(std::move(buf), cb);
+    }
+
     void FakeSession::SendNoDelay(Buffer &&, const SndCb & cb)
     {
         if (cb) cb(MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
@@ -53,7 +86,10 @@ namespace network {
         "udp",
         "http",
         "https",
+        "ws",
+        "wss",
         "zk",
+        "unix",
     };
 
     proto_type str2proto(std::string const& s)
@@ -94,11 +130,15 @@ namespace network {
             case proto_type::udp:
                 return ::boost::asio::ip::udp::v4().type();
             case proto_type::http:
+            case proto_type::ws:
+            case proto_type::wss:
                 return ::boost::asio::ip::tcp::v4().type();
             case proto_type::https:
                 break;
             case proto_type::zk:
                 break;
+            case proto_type::uds:
+                return SOCK_STREAM;
         }
         return 0;
     }
@@ -114,10 +154,13 @@ namespace network {
             case proto_type::udp:
                 return ::boost::asio::ip::udp::v4().protocol();
             case proto_type::http:
+            case proto_type::ws:
+            case proto_type::wss:
                 return ::boost::asio::ip::tcp::v4().protocol();
             case proto_type::https:
                 break;
             case proto_type::zk:
+            case proto_type::uds:
                 break;
         }
         return 0;
@@ -129,6 +172,9 @@ namespace network {
 
     std::string Protocol::endpoint::to_string(boost_ec & ec) const
     {
+        if (proto() == proto_type::uds)
+            return proto2str(proto()) + "://" + path();
+
         std::string url;
         if (proto() != proto_type::unkown) {
             url += proto2str(proto()) + "://";
@@ -149,6 +195,22 @@ namespace network {
             return endpoint();
         }
 
+        static const std::string uds_prefix = "unix://";
+        if (url.compare(0, uds_prefix.size(), uds_prefix) == 0) {
+            // sockaddr_un::sun_path为108字节, 文件路径需要结尾的'\0'; 抽象命名空间开头的@对应'\0', 也按此限制.
+            std::string path = url.substr(uds_prefix.size());
+            if (path.size() <= 1 || path.size() >= sizeof(sockaddr_un::sun_path)
+                    || (path[0] != '/' && path[0] != '@')) {
+                ec = MakeNetworkErrorCode(eNetworkErrorCode::ec_url_parse_error);
+                return endpoint();
+            }
+
+            endpoint ep;
+            ep.set_proto(proto_type::uds);
+            ep.set_path(path);
+            return ep;
+        }
+
         static ::boost::regex re("((.*)://)?([^:/]+)(:(\\d+))?(/.*)?");                
         boost::smatch result;                                                          
         bool ok = boost::regex_match(url, result, re);
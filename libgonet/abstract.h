@@ -17,7 +17,10 @@ namespace network {
         udp,
         http,
         https,
+        ws,
+        wss,
         zk,
+        uds,        // unix域stream socket(url的scheme为unix, 避开gnu模式下预定义的unix宏)
     };
     proto_type str2proto(std::string const& s);
     std::string proto2str(proto_type proto);
@@ -111,6 +114,8 @@ namespace network {
         //  http://127.0.0.1:3030/route/index.html
         //  https
         //  zk://127.0.0.1:2181,192.168.1.10:2181/zk_path/node
+        //  unix:///var/run/app.sock    unix域socket, 路径保存在path中, 没有地址和端口
+        //  unix://@app                 以@开头的是抽象命名空间(Linux), 不在文件系统中创建文件
         static endpoint from_string(std::string const& url, boost_ec & ec);
 
     private:
@@ -120,7 +125,18 @@ namespace network {
     typedef std::vector<char> Buffer;
     typedef boost::function<void(boost_ec const&)> SndCb;
 
+    // 只读的共享数据, 可以同时在多个session的发送队列中, 发送时不复制.
+    typedef boost::shared_ptr<const Buffer> SharedBuffer;
+
+    // 带代数的session标识, 由Server分配, 0表示无效.
+    // 应用层可以只保存这个整数, 通过Server::Lookup/Server::Send访问session,
+    // session关闭后旧的id会立即失效.
+    typedef uint64_t SessionId;
+    static const SessionId kInvalidSessionId = 0;
+
     struct OptionsBase;
+    struct OptionSSL;
+    class SessionEntry;
     struct SessionBase
     {
         virtual ~SessionBase() {}
@@ -130,11 +146,23 @@ namespace network {
         virtual void SendNoDelay(const void* data, size_t bytes, SndCb const& cb = NULL) = 0;
         virtual void Send(Buffer && buf, SndCb const& cb = NULL) = 0;
         virtual void Send(const void* data, size_t bytes, SndCb const& cb = NULL) = 0;
+
+        // 发送共享数据, 发送完成前buf不会被修改. 默认实现复制后Send.
+        virtual void SendShared(SharedBuffer const& buf, SndCb const& cb = NULL);
+
+        // 发送文件fd中[offset, offset + bytes)的内容, 支持时使用sendfile, 不经过用户态.
+        // 调用者须保证fd在cb被调用前有效(例如由cb持有), 默认实现读出后Send.
+        virtual void SendFile(int fd, off_t offset, size_t bytes, SndCb const& cb = NULL);
+
         virtual bool IsEstab() = 0;
         virtual void Shutdown(bool immediately = true) = 0;
         virtual boost_ec SetSocketOptNoDelay(bool is_nodelay) { return boost_ec(); }
         virtual endpoint LocalAddr() = 0;
         virtual endpoint RemoteAddr() = 0;
+        virtual SessionId GetId() { return kInvalidSessionId; }
+
+        // 获取持有所有权的SessionEntry, 不支持时返回空的SessionEntry.
+        virtual SessionEntry GetSession();
 
         // statistics
         virtual std::size_t GetSendQueueSize() = 0;
@@ -142,8 +170,12 @@ namespace network {
         // storage
         boost::any & Storage() { return storage_; }
 
+        // 协议层(http等)保存连接状态使用, 应用层请使用Storage.
+        boost::any & ProtoStorage() { return proto_storage_; }
+
     private:
         boost::any storage_;
+        boost::any proto_storage_;
     };
 
     struct FakeSession : public SessionBase
@@ -199,7 +231,45 @@ namespace network {
         }
     };
 
+    // 不持有所有权的session引用, 只在回调期间有效, 传递时没有引用计数开销.
+    // 需要在回调之外保存session时, 用Lock()升级为SessionEntry.
+    class SessionRef
+    {
+        SessionBase* ptr_;
+
+    public:
+        explicit SessionRef(SessionBase* ptr) : ptr_(ptr) {}
+
+        // 以SessionRef为参数的接口也可以直接传入SessionEntry, 调用期间由后者持有.
+        SessionRef(SessionEntry const& sess) : ptr_(sess.operator->()) {}
+
+        inline SessionBase* operator->() const
+        {
+            return ptr_;
+        }
+
+        // 连接已断开时返回空的SessionEntry(操作落到FakeSession上), 不延长已关闭session的生命周期.
+        SessionEntry Lock() const
+        {
+            return ptr_->IsEstab() ? ptr_->GetSession() : SessionEntry();
+        }
+    };
+
     typedef boost::function<size_t(SessionEntry, const char* data, size_t bytes)> ReceiveCb;
+    // 同ReceiveCb, 设置后优先于ReceiveCb使用.
+    // http和ws协议由协议层安装自己的ReceiveRefCb, 用户设置的会被覆盖.
+    typedef boost::function<size_t(SessionRef, const char* data, size_t bytes)> ReceiveRefCb;
+
+    // TLS握手线程池的统计
+    struct HandshakeStats
+    {
+        uint64_t queued = 0;        // 当前排队数
+        uint64_t running = 0;       // 当前正在握手数
+        uint64_t completed = 0;
+        uint64_t failed = 0;        // 包括超时
+        uint64_t rejected = 0;      // 排队数超过上限被拒绝
+        uint64_t timeout = 0;
+    };
 
     struct ServerBase
     {
@@ -210,6 +280,12 @@ namespace network {
         virtual boost_ec goStartBeforeFork(endpoint addr) = 0;
         virtual void goStartAfterFork() {}
         virtual endpoint LocalAddr() = 0;
+        virtual SessionEntry Lookup(SessionId) { return SessionEntry(); }
+        // 按id发送, id无效时返回false且不处理buf和cb.
+        virtual bool Send(SessionId, Buffer &&, SndCb const&) { return false; }
+        virtual bool Send(SessionId, const void*, size_t, SndCb const&) { return false; }
+        virtual HandshakeStats GetHandshakeStats() { return HandshakeStats(); }
+        virtual boost_ec ReloadSSL(OptionSSL const&) { return boost::asio::error::operation_not_supported; }
     };
     struct ClientBase
     {
@@ -222,6 +298,24 @@ namespace network {
     // ----- tcp protocol effect only ------
     typedef boost::function<void(SessionEntry)> ConnectedCb;
     typedef boost::function<void(SessionEntry, boost_ec const&)> DisconnectedCb;
+    // 写空闲时生成心跳包
+    typedef boost::function<Buffer(SessionEntry)> HeartbeatCb;
+    // -------------------------------------
+
+    // ----- http protocol effect only ------
+    // 在session的接收协程中按请求顺序调用, 返回时填好res即完成应答. 见http.h.
+    struct HttpRequest;
+    struct HttpResponse;
+    typedef boost::function<void(SessionRef, HttpRequest const& req, HttpResponse & res)> HttpCb;
+    // -------------------------------------
+
+    // ----- websocket protocol effect only ------
+    // 收到完整的消息(分片已合并)时在session的接收协程中调用. 见ws.h.
+    struct WsMessage;
+    typedef boost::function<void(SessionRef, WsMessage const& msg)> WsMessageCb;
+    // 服务端收到升级请求时调用, 返回false拒绝升级, 以res(默认403)应答并关闭连接.
+    // 接受时可以在res中添加头部(如Sec-WebSocket-Protocol), 随101应答发出.
+    typedef boost::function<bool(SessionRef, HttpRequest const& req, HttpResponse & res)> WsHandshakeCb;
     // -------------------------------------
 
     struct Protocol
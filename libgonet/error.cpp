@@ -54,6 +54,12 @@ std::string network_error_category::message(int v) const
 
         case (int)eNetworkErrorCode::ec_dns_not_found:
             return "(network)dns not found";
+
+        case (int)eNetworkErrorCode::ec_session_not_found:
+            return "(network)session not found";
+
+        case (int)eNetworkErrorCode::ec_handshake_rejected:
+            return "(network)handshake rejected by peer";
     }
 
     return "";
@@ -22,6 +22,8 @@ enum class eNetworkErrorCode : int
     ec_recv_overflow        = 11,
     ec_send_overflow        = 12,
     ec_dns_not_found        = 13,
+    ec_session_not_found    = 14,
+    ec_handshake_rejected   = 15,
 
     // 兼容
     ec_timeout = ec_send_timeout,
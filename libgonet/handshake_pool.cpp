@@ -0,0 +1,128 @@
+#include "handshake_pool.h"
+
+namespace network {
+
+    HandshakePool::HandshakePool(int threads, std::size_t queue_limit, int timeout_ms)
+        : queue_limit_(queue_limit), timeout_ms_(timeout_ms)
+    {
+        threads = (std::max)(threads, 1);
+        running_.resize(threads);
+        for (int i = 0; i < threads; ++i)
+            threads_.emplace_back([this, i]{ Run(i); });
+
+        if (timeout_ms_ > 0)
+            watchdog_ = std::thread([this]{ Watchdog(); });
+    }
+
+    HandshakePool::~HandshakePool()
+    {
+        Stop();
+    }
+
+    void HandshakePool::Stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            stop_ = true;
+            // 中断正在进行的握手
+            for (auto & r : running_)
+                if (r.fd >= 0)
+                    ::shutdown(r.fd, SHUT_RDWR);
+        }
+        cv_.notify_all();
+        watchdog_cv_.notify_all();
+
+        for (auto & t : threads_)
+            t.join();
+        threads_.clear();
+
+        if (watchdog_.joinable())
+            watchdog_.join();
+    }
+
+    bool HandshakePool::Submit(SocketPtr s, DoneCb const& cb)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            if (stop_ || queue_.size() >= queue_limit_) {
+                ++stats_.rejected;
+                return false;
+            }
+
+            queue_.push_back(Job{s, cb});
+            stats_.queued = queue_.size();
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    HandshakeStats HandshakePool::Stats()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        return stats_;
+    }
+
+    void HandshakePool::Run(std::size_t index)
+    {
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this]{ return stop_ || !queue_.empty(); });
+                if (stop_) return ;
+
+                job = std::move(queue_.front());
+                queue_.pop_front();
+                stats_.queued = queue_.size();
+                ++stats_.running;
+
+                Running & r = running_[index];
+                r.fd = job.s->native_handle();
+                r.start = std::chrono::steady_clock::now();
+                r.timeout = false;
+            }
+
+            // 不在协程中, 阻塞在真实的poll上.
+            boost_ec ec = job.s->handshake(handshake_type_t::server);
+
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                Running & r = running_[index];
+                if (r.timeout)
+                    ec = boost::asio::error::timed_out;
+                r.fd = -1;
+
+                --stats_.running;
+                if (ec)
+                    ++stats_.failed;
+                else
+                    ++stats_.completed;
+            }
+
+            job.cb(job.s, ec);
+        }
+    }
+
+    void HandshakePool::Watchdog()
+    {
+        auto timeout = std::chrono::milliseconds(timeout_ms_);
+        auto interval = (std::min)(timeout, std::chrono::milliseconds(100));
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!stop_)
+        {
+            watchdog_cv_.wait_for(lock, interval);
+            auto now = std::chrono::steady_clock::now();
+            for (auto & r : running_) {
+                if (r.fd < 0 || r.timeout || now - r.start < timeout)
+                    continue;
+
+                // 关闭读写使阻塞中的握手立即失败返回
+                r.timeout = true;
+                ++stats_.timeout;
+                ::shutdown(r.fd, SHUT_RDWR);
+            }
+        }
+    }
+
+} //namespace network
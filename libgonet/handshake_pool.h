@@ -0,0 +1,65 @@
+#pragma once
+#include "config.h"
+#include "tcp_socket.h"
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace network {
+
+// TLS握手线程池.
+// 握手(RSA/ECDHE运算)在独立的线程上同步执行, 不占用运行协程的工作线程,
+// 完成后通过回调交还调用者, 由调用者把session送回I/O线程.
+// 排队数超过上限时拒绝新的握手; watchdog线程关闭超时未完成的握手连接.
+class HandshakePool
+{
+public:
+    typedef boost::shared_ptr<tcp_socket> SocketPtr;
+    // 在握手线程上回调, 不能执行耗时操作.
+    typedef std::function<void(SocketPtr, boost_ec const&)> DoneCb;
+
+    // @timeout_ms: 单次握手超时(ms), <=0表示不限制.
+    HandshakePool(int threads, std::size_t queue_limit, int timeout_ms);
+    ~HandshakePool();
+
+    // 排队数已达上限时返回false, 不会回调.
+    bool Submit(SocketPtr s, DoneCb const& cb);
+
+    HandshakeStats Stats();
+
+private:
+    void Run(std::size_t index);
+    void Watchdog();
+    void Stop();
+
+private:
+    struct Job
+    {
+        SocketPtr s;
+        DoneCb cb;
+    };
+
+    // 每个握手线程正在处理的连接
+    struct Running
+    {
+        int fd = -1;
+        std::chrono::steady_clock::time_point start;
+        bool timeout = false;
+    };
+
+    std::size_t queue_limit_;
+    int timeout_ms_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::condition_variable watchdog_cv_;
+    std::deque<Job> queue_;
+    std::vector<Running> running_;
+    std::vector<std::thread> threads_;
+    std::thread watchdog_;
+    bool stop_ = false;
+    HandshakeStats stats_;
+};
+
+} //namespace network
@@ -0,0 +1,438 @@
+#include "hpack.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+
+namespace network {
+
+    static const std::pair<const char*, const char*> kStaticTable[Hpack::kStaticTableSize + 1] = {
+        {"", ""},
+        {":authority", ""},
+        {":method", "GET"},
+        {":method", "POST"},
+        {":path", "/"},
+        {":path", "/index.html"},
+        {":scheme", "http"},
+        {":scheme", "https"},
+        {":status", "200"},
+        {":status", "204"},
+        {":status", "206"},
+        {":status", "304"},
+        {":status", "400"},
+        {":status", "404"},
+        {":status", "500"},
+        {"accept-charset", ""},
+        {"accept-encoding", "gzip, deflate"},
+        {"accept-language", ""},
+        {"accept-ranges", ""},
+        {"accept", ""},
+        {"access-control-allow-origin", ""},
+        {"age", ""},
+        {"allow", ""},
+        {"authorization", ""},
+        {"cache-control", ""},
+        {"content-disposition", ""},
+        {"content-encoding", ""},
+        {"content-language", ""},
+        {"content-length", ""},
+        {"content-location", ""},
+        {"content-range", ""},
+        {"content-type", ""},
+        {"cookie", ""},
+        {"date", ""},
+        {"etag", ""},
+        {"expect", ""},
+        {"expires", ""},
+        {"from", ""},
+        {"host", ""},
+        {"if-match", ""},
+        {"if-modified-since", ""},
+        {"if-none-match", ""},
+        {"if-range", ""},
+        {"if-unmodified-since", ""},
+        {"last-modified", ""},
+        {"link", ""},
+        {"location", ""},
+        {"max-forwards", ""},
+        {"proxy-authenticate", ""},
+        {"proxy-authorization", ""},
+        {"range", ""},
+        {"referer", ""},
+        {"refresh", ""},
+        {"retry-after", ""},
+        {"server", ""},
+        {"set-cookie", ""},
+        {"strict-transport-security", ""},
+        {"transfer-encoding", ""},
+        {"user-agent", ""},
+        {"vary", ""},
+        {"via", ""},
+        {"www-authenticate", ""},
+    };
+
+    // RFC 7541附录B中各符号(256为EOS)的码长. 这是一个规范huffman码:
+    // 码字按(码长, 符号)顺序依次分配, 因此由码长即可还原整张码表.
+    static const uint8_t kHuffmanBits[257] = {
+        13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+        28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+         6, 10, 10, 12, 13,  6,  8, 11, 10, 10,  8, 11,  8,  6,  6,  6,
+         5,  5,  5,  6,  6,  6,  6,  6,  6,  6,  7,  8, 15,  6, 12, 10,
+        13,  6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+         7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  8, 13, 19, 13, 14,  6,
+        15,  5,  6,  5,  6,  5,  6,  6,  6,  5,  7,  7,  6,  6,  6,  5,
+         6,  7,  6,  5,  5,  6,  7,  7,  7,  7,  7, 15, 11, 14, 13, 28,
+        20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+        24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+        22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+        21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+        26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+        19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+        20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+        26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+        30,
+    };
+
+    struct HuffmanTable
+    {
+        static const int kMaxBits = 30;
+
+        uint32_t code[257];
+        uint32_t first[kMaxBits + 1];       // 每个码长的第一个码字
+        uint16_t count[kMaxBits + 1];
+        uint16_t offset[kMaxBits + 1];      // 在symbols中的起始位置
+        uint16_t symbols[257];              // 按(码长, 符号)排序
+
+        HuffmanTable()
+        {
+            for (int i = 0; i < 257; ++i)
+                symbols[i] = i;
+            std::stable_sort(symbols, symbols + 257, [](uint16_t a, uint16_t b) {
+                        return kHuffmanBits[a] < kHuffmanBits[b];
+                    });
+
+            memset(first, 0, sizeof(first));
+            memset(count, 0, sizeof(count));
+            memset(offset, 0, sizeof(offset));
+            uint32_t c = 0;
+            int bits = kHuffmanBits[symbols[0]];
+            for (int i = 0; i < 257; ++i) {
+                int sym = symbols[i];
+                if (kHuffmanBits[sym] != bits) {
+                    c <<= kHuffmanBits[sym] - bits;
+                    bits = kHuffmanBits[sym];
+                }
+                if (!count[bits]) {
+                    first[bits] = c;
+                    offset[bits] = i;
+                }
+                ++count[bits];
+                code[sym] = c++;
+            }
+        }
+
+        static HuffmanTable const& Instance()
+        {
+            static HuffmanTable table;
+            return table;
+        }
+    };
+
+    std::pair<const char*, const char*> const& Hpack::StaticEntry(size_t index)
+    {
+        return kStaticTable[index];
+    }
+
+    // 静态表的查找表: 完整的名称+值, 以及名称的第一个索引.
+    struct StaticIndex
+    {
+        std::unordered_map<std::string, size_t> full;
+        std::unordered_map<std::string, size_t> names;
+
+        StaticIndex()
+        {
+            for (size_t i = Hpack::kStaticTableSize; i >= 1; --i) {
+                names[kStaticTable[i].first] = i;
+                if (*kStaticTable[i].second)
+                    full[Key(kStaticTable[i].first, kStaticTable[i].second)] = i;
+            }
+        }
+
+        static std::string Key(string_view name, string_view value)
+        {
+            std::string key(name.data(), name.size());
+            key += '\0';
+            key.append(value.data(), value.size());
+            return key;
+        }
+
+        static StaticIndex const& Instance()
+        {
+            static StaticIndex index;
+            return index;
+        }
+    };
+
+    void Hpack::EncodeInt(Buffer & out, uint64_t value, int prefix_bits, uint8_t first)
+    {
+        uint64_t max_prefix = (1u << prefix_bits) - 1;
+        if (value < max_prefix) {
+            out.push_back((char)(first | value));
+            return ;
+        }
+
+        out.push_back((char)(first | max_prefix));
+        value -= max_prefix;
+        while (value >= 0x80) {
+            out.push_back((char)(0x80 | (value & 0x7f)));
+            value >>= 7;
+        }
+        out.push_back((char)value);
+    }
+
+    size_t Hpack::HuffmanSize(string_view s)
+    {
+        size_t bits = 0;
+        for (char c : s)
+            bits += kHuffmanBits[(uint8_t)c];
+        return (bits + 7) / 8;
+    }
+
+    void Hpack::HuffmanEncode(Buffer & out, string_view s)
+    {
+        HuffmanTable const& t = HuffmanTable::Instance();
+        uint64_t acc = 0;
+        int nbits = 0;
+        for (char c : s) {
+            uint8_t sym = (uint8_t)c;
+            acc = (acc << kHuffmanBits[sym]) | t.code[sym];
+            nbits += kHuffmanBits[sym];
+            while (nbits >= 8) {
+                nbits -= 8;
+                out.push_back((char)(acc >> nbits));
+            }
+        }
+        // 以EOS的高位(全1)填充
+        if (nbits)
+            out.push_back((char)((acc << (8 - nbits)) | (0xff >> nbits)));
+    }
+
+    bool Hpack::HuffmanDecode(const uint8_t* p, size_t bytes, std::string & out)
+    {
+        HuffmanTable const& t = HuffmanTable::Instance();
+        uint64_t acc = 0;       // 左对齐
+        int nbits = 0;
+        size_t i = 0;
+        for (;;) {
+            while (nbits <= 56 && i < bytes) {
+                acc |= (uint64_t)p[i++] << (56 - nbits);
+                nbits += 8;
+            }
+
+            int bits = 5;
+            for (; bits <= HuffmanTable::kMaxBits && bits <= nbits; ++bits) {
+                uint32_t c = (uint32_t)(acc >> (64 - bits));
+                if (c - t.first[bits] < t.count[bits])
+                    break;
+            }
+
+            if (bits > HuffmanTable::kMaxBits || bits > nbits) {
+                // 剩余的只能是不超过7位的全1填充
+                if (nbits > 7)
+                    return false;
+                uint64_t mask = nbits ? ~0ull << (64 - nbits) : 0;
+                return (acc & mask) == mask;
+            }
+
+            uint32_t c = (uint32_t)(acc >> (64 - bits));
+            uint16_t sym = t.symbols[t.offset[bits] + c - t.first[bits]];
+            if (sym == 256)
+                return false;
+            out += (char)sym;
+            acc <<= bits;
+            nbits -= bits;
+        }
+    }
+
+    void Hpack::EncodeString(Buffer & out, string_view s)
+    {
+        size_t huffman = HuffmanSize(s);
+        if (huffman < s.size()) {
+            EncodeInt(out, huffman, 7, 0x80);
+            HuffmanEncode(out, s);
+        } else {
+            EncodeInt(out, s.size(), 7, 0);
+            out.insert(out.end(), s.begin(), s.end());
+        }
+    }
+
+    void Hpack::Encode(Buffer & out, string_view name, string_view value)
+    {
+        StaticIndex const& index = StaticIndex::Instance();
+        std::string key = StaticIndex::Key(name, value);
+        auto it = index.full.find(key);
+        if (it != index.full.end()) {
+            EncodeInt(out, it->second, 7, 0x80);
+            return ;
+        }
+
+        // 不索引的字面值
+        key.resize(name.size());
+        it = index.names.find(key);
+        if (it != index.names.end()) {
+            EncodeInt(out, it->second, 4, 0);
+        } else {
+            out.push_back(0);
+            EncodeString(out, name);
+        }
+        EncodeString(out, value);
+    }
+
+    void Hpack::EncodeStatus(Buffer & out, int status)
+    {
+        switch (status) {
+        case 200: EncodeInt(out, 8, 7, 0x80); return ;
+        case 204: EncodeInt(out, 9, 7, 0x80); return ;
+        case 206: EncodeInt(out, 10, 7, 0x80); return ;
+        case 304: EncodeInt(out, 11, 7, 0x80); return ;
+        case 400: EncodeInt(out, 12, 7, 0x80); return ;
+        case 404: EncodeInt(out, 13, 7, 0x80); return ;
+        case 500: EncodeInt(out, 14, 7, 0x80); return ;
+        default: break;
+        }
+
+        char s[16];
+        int n = snprintf(s, sizeof(s), "%d", status);
+        EncodeInt(out, 8, 4, 0);
+        EncodeString(out, string_view(s, n));
+    }
+
+    static bool ReadInt(const uint8_t*& p, const uint8_t* end, int prefix_bits, uint64_t & value)
+    {
+        if (p >= end) return false;
+        uint64_t max_prefix = (1u << prefix_bits) - 1;
+        value = *p++ & max_prefix;
+        if (value < max_prefix)
+            return true;
+
+        for (int shift = 0; p < end && shift <= 28; shift += 7) {
+            uint8_t b = *p++;
+            value += (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    static bool ReadString(const uint8_t*& p, const uint8_t* end, std::string & s)
+    {
+        if (p >= end) return false;
+        bool huffman = *p & 0x80;
+        uint64_t len;
+        if (!ReadInt(p, end, 7, len) || len > (uint64_t)(end - p))
+            return false;
+
+        s.clear();
+        if (huffman) {
+            if (!Hpack::HuffmanDecode(p, len, s))
+                return false;
+        } else {
+            s.assign((const char*)p, len);
+        }
+        p += len;
+        return true;
+    }
+
+    bool HpackDecoder::Lookup(uint64_t index, Entry & entry) const
+    {
+        if (index == 0)
+            return false;
+        if (index <= Hpack::kStaticTableSize) {
+            entry.first = kStaticTable[index].first;
+            entry.second = kStaticTable[index].second;
+            return true;
+        }
+        index -= Hpack::kStaticTableSize + 1;
+        if (index >= table_.size())
+            return false;
+        entry = table_[index];
+        return true;
+    }
+
+    void HpackDecoder::Evict(size_t max_size)
+    {
+        while (size_ > max_size) {
+            Entry const& e = table_.back();
+            size_ -= e.first.size() + e.second.size() + 32;
+            table_.pop_back();
+        }
+    }
+
+    void HpackDecoder::Insert(Entry const& entry)
+    {
+        size_t size = entry.first.size() + entry.second.size() + 32;
+        if (size > max_size_) {
+            // 比整个表还大, 结果是清空
+            Evict(0);
+            return ;
+        }
+        Evict(max_size_ - size);
+        table_.push_front(entry);
+        size_ += size;
+    }
+
+    bool HpackDecoder::Decode(const uint8_t* p, size_t bytes, Hpack::Headers & headers)
+    {
+        const uint8_t* end = p + bytes;
+        Entry entry;
+        // 一个字节的索引就能引用动态表中4KB的条目, 按解码后的大小限制, 防止放大攻击.
+        size_t list_size = 0;
+        too_large_ = false;
+        auto append = [&]{
+            list_size += entry.first.size() + entry.second.size() + 32;
+            if (list_size > max_list_size_)
+                too_large_ = true;
+            else
+                headers.push_back(entry);
+        };
+        while (p < end) {
+            uint8_t b = *p;
+            uint64_t index;
+            if (b & 0x80) {
+                // 索引
+                if (!ReadInt(p, end, 7, index) || !Lookup(index, entry))
+                    return false;
+                append();
+                continue;
+            }
+
+            if ((b & 0xe0) == 0x20) {
+                // 动态表大小更新
+                if (!ReadInt(p, end, 5, index) || index > limit_)
+                    return false;
+                max_size_ = index;
+                Evict(max_size_);
+                continue;
+            }
+
+            // 字面值: 01 增量索引, 0000 不索引, 0001 永不索引
+            bool indexing = b & 0x40;
+            if (!ReadInt(p, end, indexing ? 6 : 4, index))
+                return false;
+            if (index) {
+                if (!Lookup(index, entry))
+                    return false;
+            } else if (!ReadString(p, end, entry.first)) {
+                return false;
+            }
+            if (!ReadString(p, end, entry.second))
+                return false;
+
+            if (indexing)
+                Insert(entry);
+            append();
+        }
+        return true;
+    }
+
+} //namespace network
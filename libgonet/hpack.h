@@ -0,0 +1,70 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+#include "http_parser.h"
+#include <deque>
+
+namespace network {
+
+// HPACK(RFC 7541)头部压缩.
+// 编码时不使用动态表: 与静态表完全相同的头部编码为索引, 否则以静态表中的名称加字面值编码,
+// 不需要与对端同步表状态, 编码可以在多个连接间共享.
+struct Hpack
+{
+    typedef std::vector<std::pair<std::string, std::string>> Headers;
+
+    // 静态表中的条目, 1 ~ kStaticTableSize
+    static const size_t kStaticTableSize = 61;
+    static std::pair<const char*, const char*> const& StaticEntry(size_t index);
+
+    // 编码一个头部, name须为小写.
+    static void Encode(Buffer & out, string_view name, string_view value);
+    static void EncodeStatus(Buffer & out, int status);
+
+    // 以prefix_bits位前缀编码整数, first为首字节中前缀以外的标志位.
+    static void EncodeInt(Buffer & out, uint64_t value, int prefix_bits, uint8_t first);
+
+    // 字符串字面值, huffman编码更短时使用huffman.
+    static void EncodeString(Buffer & out, string_view s);
+
+    // huffman编解码. 解码遇到非法填充或EOS时返回false.
+    static size_t HuffmanSize(string_view s);
+    static void HuffmanEncode(Buffer & out, string_view s);
+    static bool HuffmanDecode(const uint8_t* p, size_t bytes, std::string & out);
+};
+
+// 每个连接一个解码器, 维护动态表.
+class HpackDecoder
+{
+public:
+    // 解码一个完整的头部块, 追加到headers. 失败时返回false(COMPRESSION_ERROR, 须关闭连接).
+    // 头部列表超过上限时不再追加, 但仍解码完整个块以保持动态表同步, HeaderListTooLarge()返回true.
+    bool Decode(const uint8_t* p, size_t bytes, Hpack::Headers & headers);
+
+    // SETTINGS_HEADER_TABLE_SIZE, 对端的表大小更新不能超过它. 须在解码之前设置.
+    void SetMaxTableSize(size_t size) { limit_ = max_size_ = size; }
+
+    // SETTINGS_MAX_HEADER_LIST_SIZE, 每个头部按名称+值+32计算.
+    void SetMaxHeaderListSize(size_t size) { max_list_size_ = size; }
+
+    // 上一次Decode的头部列表是否超过上限
+    bool HeaderListTooLarge() const { return too_large_; }
+
+    size_t TableSize() const { return size_; }
+
+private:
+    typedef std::pair<std::string, std::string> Entry;
+
+    bool Lookup(uint64_t index, Entry & entry) const;
+    void Insert(Entry const& entry);
+    void Evict(size_t max_size);
+
+    std::deque<Entry> table_;   // 最新的在前, 对应索引kStaticTableSize + 1
+    size_t size_ = 0;           // 每项的大小为名称+值+32
+    size_t max_size_ = 4096;    // 对端通过表大小更新设定的当前上限
+    size_t limit_ = 4096;
+    size_t max_list_size_ = HttpRequestParser::kMaxHeaderSize;
+    bool too_large_ = false;
+};
+
+} //namespace network
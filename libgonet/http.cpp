@@ -0,0 +1,21 @@
+#include "http.h"
+#include <boost/make_shared.hpp>
+
+namespace network {
+
+    http::http()
+        : Protocol(::boost::asio::ip::tcp::v4().family(), proto_type::http)
+    {}
+
+    boost::shared_ptr<ServerBase> http::CreateServer()
+    {
+        return boost::make_shared<server>();
+    }
+
+    http* http::instance()
+    {
+        static http obj;
+        return &obj;
+    }
+
+} //namespace network
@@ -0,0 +1,26 @@
+#pragma once
+#include "config.h"
+#include "http_detail.h"
+#include "http_router.h"
+#include "http_client.h"
+#include "http_static.h"
+#include "abstract.h"
+
+namespace network {
+
+// http/https: 以tcp/ssl为传输层的http/1.1.
+// 服务端开启SetHttp2后, http://还接受h2c(prior knowledge的明文HTTP/2), 同一个HttpCb处理两种请求.
+// 服务端通过Server::SetHttpCb使用; 客户端使用HttpClient, 不支持Client::Connect.
+class http : public Protocol
+{
+public:
+    typedef Protocol::endpoint endpoint;
+    typedef http_detail::HttpServer server;
+
+    http();
+    virtual boost::shared_ptr<ServerBase> CreateServer();
+
+    static http* instance();
+};
+
+}//namespace network
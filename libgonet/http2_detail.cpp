@@ -0,0 +1,600 @@
+#include "http2_detail.h"
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace network {
+namespace http_detail {
+
+    // http/2禁止的逐跳头部
+    static bool IsConnectionHeader(string_view name)
+    {
+        return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+            || name == "transfer-encoding" || name == "upgrade";
+    }
+
+    Http2Connection::Http2Connection(Http2Options const& opt)
+        : opt_(opt)
+    {
+    }
+
+    size_t Http2Connection::OnReceive(HttpCb const& cb, SessionRef sess, const char* data, size_t bytes)
+    {
+        if (closed_)
+            return bytes;
+
+        size_t pos = 0;
+        if (!preface_) {
+            if (bytes < Http2Frame::kPrefaceSize)
+                return 0;
+            if (memcmp(data, Http2Frame::kPreface, Http2Frame::kPrefaceSize) != 0)
+                return (size_t)-1;
+            pos = Http2Frame::kPrefaceSize;
+            preface_ = true;
+
+            Http2Frame::AppendSettings(out_, {
+                        {h2_setting::max_concurrent_streams, opt_.max_concurrent_streams},
+                        {h2_setting::initial_window_size, opt_.window_size},
+                        {h2_setting::max_header_list_size, (uint32_t)HttpRequestParser::kMaxHeaderSize},
+                    });
+            if (opt_.window_size > Http2Frame::kDefaultWindowSize) {
+                Http2Frame::AppendWindowUpdate(out_, 0, opt_.window_size - Http2Frame::kDefaultWindowSize);
+                recv_window_ = opt_.window_size;
+            }
+        }
+
+        while (bytes - pos >= Http2Frame::kHeaderSize) {
+            Http2FrameHeader h = Http2Frame::ParseHeader(data + pos);
+            // 没有通告更大的SETTINGS_MAX_FRAME_SIZE
+            if (h.length > Http2Frame::kDefaultMaxFrameSize) {
+                ConnectionError(h2_error::frame_size_error);
+                break;
+            }
+            if (bytes - pos < Http2Frame::kHeaderSize + h.length)
+                break;
+
+            const char* payload = data + pos + Http2Frame::kHeaderSize;
+            pos += Http2Frame::kHeaderSize + h.length;
+            if (!OnFrame(cb, sess, h, payload))
+                break;
+        }
+
+        if (!out_.empty()) {
+            Buffer buf;
+            buf.swap(out_);
+            sess->Send(std::move(buf));
+        }
+
+        if (closed_ || (goaway_ && streams_.empty())) {
+            closed_ = true;
+            sess->Shutdown(false);
+            return bytes;
+        }
+        return pos;
+    }
+
+    bool Http2Connection::OnFrame(HttpCb const& cb, SessionRef sess, Http2FrameHeader const& h, const char* payload)
+    {
+        // 头部块必须连续
+        if (in_header_block_ && (h.type != h2_frame::continuation || h.stream_id != header_stream_))
+            return ConnectionError(h2_error::protocol_error);
+
+        // 连接前言之后的第一个帧必须是SETTINGS
+        if (!settings_received_ && h.type != h2_frame::settings)
+            return ConnectionError(h2_error::protocol_error);
+
+        switch (h.type) {
+        case h2_frame::data:
+            return OnData(cb, sess, h, payload);
+
+        case h2_frame::headers:
+            return OnHeaders(cb, sess, h, payload);
+
+        case h2_frame::continuation:
+            if (!in_header_block_)
+                return ConnectionError(h2_error::protocol_error);
+            if (header_block_.size() + h.length > HttpRequestParser::kMaxHeaderSize)
+                return ConnectionError(h2_error::enhance_your_calm);
+            header_block_.append(payload, h.length);
+            if (h.flags & h2_end_headers) {
+                in_header_block_ = false;
+                return OnHeaderBlock(cb, sess);
+            }
+            return true;
+
+        case h2_frame::priority:
+            if (!h.stream_id)
+                return ConnectionError(h2_error::protocol_error);
+            if (h.length != 5)
+                StreamError(h.stream_id, h2_error::frame_size_error);
+            return true;
+
+        case h2_frame::rst_stream:
+            if (!h.stream_id || h.stream_id > last_stream_id_)
+                return ConnectionError(h2_error::protocol_error);
+            if (h.length != 4)
+                return ConnectionError(h2_error::frame_size_error);
+            streams_.erase(h.stream_id);
+            return true;
+
+        case h2_frame::settings:
+            return OnSettings(h, payload);
+
+        case h2_frame::push_promise:
+            // 客户端不能推送
+            return ConnectionError(h2_error::protocol_error);
+
+        case h2_frame::ping:
+            if (h.stream_id)
+                return ConnectionError(h2_error::protocol_error);
+            if (h.length != 8)
+                return ConnectionError(h2_error::frame_size_error);
+            if (!(h.flags & h2_ack))
+                Http2Frame::AppendPing(out_, payload, true);
+            return true;
+
+        case h2_frame::goaway:
+            if (h.stream_id)
+                return ConnectionError(h2_error::protocol_error);
+            goaway_ = true;
+            return true;
+
+        case h2_frame::window_update:
+            return OnWindowUpdate(h, payload);
+
+        default:
+            // 忽略未知类型的帧
+            return true;
+        }
+    }
+
+    bool Http2Connection::OnHeaders(HttpCb const& cb, SessionRef sess, Http2FrameHeader const& h, const char* payload)
+    {
+        if (!h.stream_id || !(h.stream_id & 1))
+            return ConnectionError(h2_error::protocol_error);
+
+        size_t off = 0, pad = 0;
+        if (h.flags & h2_padded) {
+            if (h.length < 1)
+                return ConnectionError(h2_error::frame_size_error);
+            pad = (uint8_t)payload[0];
+            off = 1;
+        }
+        if (h.flags & h2_priority)
+            off += 5;
+        if (off + pad > h.length)
+            return ConnectionError(h2_error::protocol_error);
+
+        header_block_.assign(payload + off, h.length - off - pad);
+        header_stream_ = h.stream_id;
+        header_end_stream_ = h.flags & h2_end_stream;
+        if (h.flags & h2_end_headers)
+            return OnHeaderBlock(cb, sess);
+
+        in_header_block_ = true;
+        return true;
+    }
+
+    bool Http2Connection::OnHeaderBlock(HttpCb const& cb, SessionRef sess)
+    {
+        // 即使之后拒绝这个流, 也要解码以保持动态表同步.
+        Hpack::Headers headers;
+        if (!decoder_.Decode((const uint8_t*)header_block_.data(), header_block_.size(), headers))
+            return ConnectionError(h2_error::compression_error);
+        bool too_large = decoder_.HeaderListTooLarge();
+
+        uint32_t id = header_stream_;
+        Streams::iterator it = streams_.find(id);
+        if (it != streams_.end()) {
+            // 已打开的流上只能是结束流的trailers, 忽略其内容.
+            Stream & s = it->second;
+            if (s.end_stream) {
+                StreamError(id, h2_error::stream_closed);
+                return true;
+            }
+            if (!header_end_stream_) {
+                StreamError(id, h2_error::protocol_error);
+                return true;
+            }
+            if (too_large) {
+                StreamError(id, h2_error::enhance_your_calm);
+                return true;
+            }
+            s.end_stream = true;
+            Dispatch(cb, sess, it);
+            return true;
+        }
+
+        if (id <= last_stream_id_)
+            return ConnectionError(h2_error::stream_closed);
+        last_stream_id_ = id;
+
+        if (goaway_)
+            return true;
+
+        // 超过通告的SETTINGS_MAX_HEADER_LIST_SIZE
+        if (too_large) {
+            Http2Frame::AppendRstStream(out_, id, h2_error::enhance_your_calm);
+            return true;
+        }
+
+        if (streams_.size() >= opt_.max_concurrent_streams) {
+            Http2Frame::AppendRstStream(out_, id, h2_error::refused_stream);
+            return true;
+        }
+
+        it = streams_.insert(std::make_pair(id, Stream())).first;
+        Stream & s = it->second;
+        s.id = id;
+        s.send_window = peer_initial_window_;
+        s.recv_window = opt_.window_size;
+        s.headers.swap(headers);
+        s.end_stream = header_end_stream_;
+        if (s.end_stream)
+            Dispatch(cb, sess, it);
+        return true;
+    }
+
+    bool Http2Connection::OnData(HttpCb const& cb, SessionRef sess, Http2FrameHeader const& h, const char* payload)
+    {
+        if (!h.stream_id)
+            return ConnectionError(h2_error::protocol_error);
+
+        // 连接级流控按整个帧(包括填充)计算, 被丢弃的帧也计入.
+        if (h.length > recv_window_)
+            return ConnectionError(h2_error::flow_control_error);
+        recv_window_ -= h.length;
+        recv_consumed_ += h.length;
+        if (recv_consumed_ >= opt_.window_size / 2) {
+            Http2Frame::AppendWindowUpdate(out_, 0, recv_consumed_);
+            recv_window_ += recv_consumed_;
+            recv_consumed_ = 0;
+        }
+
+        size_t off = 0, pad = 0;
+        if (h.flags & h2_padded) {
+            if (h.length < 1)
+                return ConnectionError(h2_error::frame_size_error);
+            pad = (uint8_t)payload[0];
+            off = 1;
+        }
+        if (off + pad > h.length)
+            return ConnectionError(h2_error::protocol_error);
+
+        Streams::iterator it = streams_.find(h.stream_id);
+        if (it == streams_.end() || it->second.end_stream) {
+            if (h.stream_id > last_stream_id_)
+                return ConnectionError(h2_error::protocol_error);
+            StreamError(h.stream_id, h2_error::stream_closed);
+            return true;
+        }
+
+        Stream & s = it->second;
+        if (h.length > s.recv_window) {
+            StreamError(h.stream_id, h2_error::flow_control_error);
+            return true;
+        }
+        s.recv_window -= h.length;
+
+        size_t n = h.length - off - pad;
+        if (s.body.size() + n > opt_.max_body_size) {
+            StreamError(h.stream_id, h2_error::enhance_your_calm);
+            return true;
+        }
+        s.body.append(payload + off, n);
+
+        if (h.flags & h2_end_stream) {
+            s.end_stream = true;
+            Dispatch(cb, sess, it);
+        } else if (s.recv_window < opt_.window_size / 2) {
+            Http2Frame::AppendWindowUpdate(out_, s.id, opt_.window_size - s.recv_window);
+            s.recv_window = opt_.window_size;
+        }
+        return true;
+    }
+
+    bool Http2Connection::OnSettings(Http2FrameHeader const& h, const char* payload)
+    {
+        if (h.stream_id)
+            return ConnectionError(h2_error::protocol_error);
+        if (h.flags & h2_ack)
+            return h.length ? ConnectionError(h2_error::frame_size_error) : true;
+        if (h.length % 6)
+            return ConnectionError(h2_error::frame_size_error);
+
+        bool window_grown = false;
+        for (size_t i = 0; i < h.length; i += 6) {
+            h2_setting id = (h2_setting)(((uint8_t)payload[i] << 8) | (uint8_t)payload[i + 1]);
+            uint32_t value = Http2Frame::ReadUint32(payload + i + 2);
+            switch (id) {
+            case h2_setting::enable_push:
+                if (value > 1)
+                    return ConnectionError(h2_error::protocol_error);
+                break;
+
+            case h2_setting::initial_window_size:
+                {
+                    if (value > Http2Frame::kMaxWindowSize)
+                        return ConnectionError(h2_error::flow_control_error);
+                    int64_t delta = (int64_t)value - peer_initial_window_;
+                    for (auto & kv : streams_) {
+                        kv.second.send_window += delta;
+                        if (kv.second.send_window > Http2Frame::kMaxWindowSize)
+                            return ConnectionError(h2_error::flow_control_error);
+                    }
+                    peer_initial_window_ = value;
+                    window_grown = window_grown || delta > 0;
+                }
+                break;
+
+            case h2_setting::max_frame_size:
+                if (value < Http2Frame::kDefaultMaxFrameSize || value > 0xffffff)
+                    return ConnectionError(h2_error::protocol_error);
+                peer_max_frame_size_ = value;
+                break;
+
+            default:
+                // 不使用动态表编码, 忽略header_table_size; 其余对服务端无影响.
+                break;
+            }
+        }
+
+        Http2Frame::AppendSettingsAck(out_);
+        settings_received_ = true;
+        if (window_grown)
+            ResumeBlocked();
+        return true;
+    }
+
+    bool Http2Connection::OnWindowUpdate(Http2FrameHeader const& h, const char* payload)
+    {
+        if (h.length != 4)
+            return ConnectionError(h2_error::frame_size_error);
+
+        uint32_t increment = Http2Frame::ReadUint32(payload) & 0x7fffffff;
+        if (!h.stream_id) {
+            if (!increment)
+                return ConnectionError(h2_error::protocol_error);
+            send_window_ += increment;
+            if (send_window_ > Http2Frame::kMaxWindowSize)
+                return ConnectionError(h2_error::flow_control_error);
+            ResumeBlocked();
+            return true;
+        }
+
+        Streams::iterator it = streams_.find(h.stream_id);
+        if (it == streams_.end()) {
+            // 已关闭的流上仍可能收到, 忽略
+            if (h.stream_id > last_stream_id_)
+                return ConnectionError(h2_error::protocol_error);
+            return true;
+        }
+
+        Stream & s = it->second;
+        if (!increment) {
+            StreamError(s.id, h2_error::protocol_error);
+            return true;
+        }
+        s.send_window += increment;
+        if (s.send_window > Http2Frame::kMaxWindowSize) {
+            StreamError(s.id, h2_error::flow_control_error);
+            return true;
+        }
+        if (s.blocked)
+            ResumeBlocked();
+        return true;
+    }
+
+    void Http2Connection::Dispatch(HttpCb const& cb, SessionRef sess, Streams::iterator it)
+    {
+        Stream & s = it->second;
+
+        // :authority转为host, 在取string_view之前加入, 避免headers扩容后失效.
+        string_view authority;
+        bool has_host = false;
+        for (auto const& kv : s.headers) {
+            if (kv.first == ":authority")
+                authority = kv.second;
+            else if (kv.first == "host")
+                has_host = true;
+        }
+        if (!has_host && !authority.empty()) {
+            std::string host = authority.to_string();
+            s.headers.emplace_back("host", std::move(host));
+        }
+
+        HttpRequest & req = req_;
+        req.method = req.target = req.path = req.query = string_view();
+        req.headers.clear();
+        bool regular = false;
+        for (auto const& kv : s.headers) {
+            string_view name = kv.first;
+            if (!name.empty() && name[0] == ':') {
+                if (regular) {
+                    StreamError(s.id, h2_error::protocol_error);
+                    return ;
+                }
+                if (name == ":method")
+                    req.method = kv.second;
+                else if (name == ":path")
+                    req.target = kv.second;
+                else if (name != ":scheme" && name != ":authority") {
+                    StreamError(s.id, h2_error::protocol_error);
+                    return ;
+                }
+                continue;
+            }
+
+            if (name != "host")
+                regular = true;
+            if (IsConnectionHeader(name)) {
+                StreamError(s.id, h2_error::protocol_error);
+                return ;
+            }
+            req.headers.push_back(HttpHeader{name, kv.second});
+        }
+
+        if (req.method.empty() || req.target.empty()) {
+            StreamError(s.id, h2_error::protocol_error);
+            return ;
+        }
+
+        size_t q = req.target.find('?');
+        req.path = req.target.substr(0, q);
+        req.query = q == string_view::npos ? string_view() : req.target.substr(q + 1);
+        req.major_version = 2;
+        req.minor_version = 0;
+        req.keep_alive = true;
+        req.chunked = false;
+        req.body = s.body;
+
+        HttpResponse res;
+        if (cb)
+            cb(sess, req, res);
+        else
+            res.status = 404;
+
+        Respond(s, req, res);
+        if (!s.left)
+            streams_.erase(it);
+    }
+
+    void Http2Connection::Respond(Stream & s, HttpRequest const& req, HttpResponse & res)
+    {
+        if (res.Raw()) {
+            // 预先序列化的http/1.1应答, 还原成状态和头部
+            HttpResponseParser parser;
+            parser.Reset(req.method == "HEAD");
+            HttpClientResponse raw;
+            size_t consumed = 0;
+            HttpResponseParser::result_t r = parser.Parse(res.Raw()->data(), res.Raw()->size(),
+                    raw, consumed, NULL);
+            if (r == HttpResponseParser::incomplete)
+                r = parser.OnEof();
+            if (r != HttpResponseParser::complete) {
+                // 只重置不删除, s.left为0, 由Dispatch删除流(StreamError会使调用方的迭代器失效)
+                Http2Frame::AppendRstStream(out_, s.id, h2_error::internal_error);
+                return ;
+            }
+            res.status = raw.status;
+            res.headers.swap(raw.headers);
+            res.body.swap(raw.body);
+        }
+
+        Buffer block;
+        Hpack::EncodeStatus(block, res.status);
+        std::string name;
+        for (auto const& kv : res.headers) {
+            name = kv.first;
+            for (char & c : name)
+                c = tolower((unsigned char)c);
+            if (IsConnectionHeader(name) || name == "content-length")
+                continue;
+            Hpack::Encode(block, name, kv.second);
+        }
+
+        boost::shared_ptr<HttpFile> const& file = res.File();
+        size_t length = file ? file->bytes : res.body.size();
+        bool has_body = res.status / 100 != 1 && res.status != 204 && res.status != 304;
+        if (has_body) {
+            char n[24];
+            int len = snprintf(n, sizeof(n), "%zu", length);
+            Hpack::Encode(block, "content-length", string_view(n, len));
+        }
+        if (req.method == "HEAD")
+            has_body = false;
+
+        has_body = has_body && length;
+        Http2Frame::AppendHeaders(out_, s.id, block.data(), block.size(), !has_body, peer_max_frame_size_);
+        if (!has_body)
+            return ;
+
+        s.left = length;
+        if (file) {
+            s.file = file;
+            s.file_pos = file->offset;
+        } else {
+            s.out.swap(res.body);
+            s.out_pos = 0;
+        }
+
+        if (!SendData(s) && !s.blocked) {
+            s.blocked = true;
+            blocked_.push_back(s.id);
+        }
+    }
+
+    bool Http2Connection::SendData(Stream & s)
+    {
+        while (s.left) {
+            int64_t n = (std::min<int64_t>)((std::min<int64_t>)(s.left, peer_max_frame_size_),
+                    (std::min<int64_t>)(send_window_, s.send_window));
+            if (n <= 0)
+                return false;
+
+            bool last = (size_t)n == s.left;
+            Http2Frame::AppendHeader(out_, n, h2_frame::data, last ? h2_end_stream : 0, s.id);
+            size_t old = out_.size();
+            if (s.file) {
+                out_.resize(old + n);
+                size_t done = 0;
+                while (done < (size_t)n) {
+                    ssize_t r = ::pread(s.file->fd, &out_[old + done], n - done, s.file_pos + done);
+                    if (r < 0 && errno == EINTR)
+                        continue;
+                    if (r <= 0) {
+                        // 文件被截断等, 撤销这个帧并重置流
+                        out_.resize(old - Http2Frame::kHeaderSize);
+                        Http2Frame::AppendRstStream(out_, s.id, h2_error::internal_error);
+                        s.left = 0;
+                        return true;
+                    }
+                    done += r;
+                }
+                s.file_pos += n;
+            } else {
+                out_.insert(out_.end(), s.out.data() + s.out_pos, s.out.data() + s.out_pos + n);
+                s.out_pos += n;
+            }
+
+            send_window_ -= n;
+            s.send_window -= n;
+            s.left -= n;
+        }
+        return true;
+    }
+
+    void Http2Connection::ResumeBlocked()
+    {
+        for (size_t i = blocked_.size(); i > 0 && send_window_ > 0; --i) {
+            uint32_t id = blocked_.front();
+            blocked_.pop_front();
+            Streams::iterator it = streams_.find(id);
+            if (it == streams_.end())
+                continue;
+
+            Stream & s = it->second;
+            if (SendData(s)) {
+                streams_.erase(it);
+            } else {
+                blocked_.push_back(id);
+            }
+        }
+    }
+
+    void Http2Connection::StreamError(uint32_t id, h2_error code)
+    {
+        Http2Frame::AppendRstStream(out_, id, code);
+        streams_.erase(id);
+    }
+
+    bool Http2Connection::ConnectionError(h2_error code)
+    {
+        Http2Frame::AppendGoaway(out_, last_stream_id_, code);
+        closed_ = true;
+        return false;
+    }
+
+} //namespace http_detail
+} //namespace network
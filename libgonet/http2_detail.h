@@ -0,0 +1,102 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+#include "http_parser.h"
+#include "http_response.h"
+#include "http2_frame.h"
+#include "hpack.h"
+#include <map>
+#include <deque>
+
+namespace network {
+namespace http_detail {
+
+// h2c相关的配置, 安装接收回调时从OptionsUser中取出.
+struct Http2Options
+{
+    bool enabled = false;
+    uint32_t max_concurrent_streams = 100;
+    uint32_t window_size = 1024 * 1024;
+    size_t max_body_size = 4 * 1024 * 1024;     // 与http/1.1一致, 取接收缓冲区的上限
+};
+
+// 一个h2c连接, 由HttpServer在连接以HTTP/2连接前言开头时创建, 只在接收协程中访问.
+// 请求在流结束(END_STREAM)时按顺序交给HttpCb, 与http/1.1一样在接收协程中同步调用.
+// 应答的DATA帧在对端的连接级和流级窗口内输出, 窗口用尽的流挂起,
+// 收到WINDOW_UPDATE或SETTINGS后按挂起顺序继续. 一次接收中产生的所有帧合并成一次Send.
+// 流式应答(WriteChunk)合并到body中一次发送.
+class Http2Connection
+{
+public:
+    explicit Http2Connection(Http2Options const& opt);
+
+    // @data: 从连接前言开始的数据. 返回消费的字节数.
+    size_t OnReceive(HttpCb const& cb, SessionRef sess, const char* data, size_t bytes);
+
+private:
+    struct Stream
+    {
+        uint32_t id = 0;
+        int64_t send_window = 0;
+        int64_t recv_window = 0;
+        Hpack::Headers headers;
+        std::string body;
+        bool end_stream = false;    // 对端已结束发送
+        bool blocked = false;       // 在blocked_中
+
+        // 未发出的应答body, 来自内存或文件
+        std::string out;
+        size_t out_pos = 0;
+        boost::shared_ptr<HttpFile> file;
+        off_t file_pos = 0;
+        size_t left = 0;
+    };
+    typedef std::map<uint32_t, Stream> Streams;
+
+    bool OnFrame(HttpCb const& cb, SessionRef sess, Http2FrameHeader const& h, const char* payload);
+    bool OnHeaders(HttpCb const& cb, SessionRef sess, Http2FrameHeader const& h, const char* payload);
+    bool OnHeaderBlock(HttpCb const& cb, SessionRef sess);
+    bool OnData(HttpCb const& cb, SessionRef sess, Http2FrameHeader const& h, const char* payload);
+    bool OnSettings(Http2FrameHeader const& h, const char* payload);
+    bool OnWindowUpdate(Http2FrameHeader const& h, const char* payload);
+
+    // 调用HttpCb并输出应答
+    void Dispatch(HttpCb const& cb, SessionRef sess, Streams::iterator it);
+    // 不删除流, 没有剩余的body(s.left为0)时由调用方删除.
+    void Respond(Stream & s, HttpRequest const& req, HttpResponse & res);
+
+    // 在窗口内尽量输出body, 全部输出时返回true.
+    bool SendData(Stream & s);
+    void ResumeBlocked();
+
+    void StreamError(uint32_t id, h2_error code);
+    bool ConnectionError(h2_error code);
+
+    Http2Options opt_;
+    HpackDecoder decoder_;
+    Streams streams_;
+    std::deque<uint32_t> blocked_;  // 等待窗口的流
+    Buffer out_;
+    HttpRequest req_;               // 复用, 保留headers的容量
+
+    int64_t send_window_ = Http2Frame::kDefaultWindowSize;
+    int64_t recv_window_ = Http2Frame::kDefaultWindowSize;
+    uint32_t recv_consumed_ = 0;    // 尚未通过WINDOW_UPDATE归还的连接级窗口
+    uint32_t peer_initial_window_ = Http2Frame::kDefaultWindowSize;
+    uint32_t peer_max_frame_size_ = Http2Frame::kDefaultMaxFrameSize;
+    uint32_t last_stream_id_ = 0;
+
+    // 未结束的头部块(HEADERS + CONTINUATION)
+    std::string header_block_;
+    uint32_t header_stream_ = 0;
+    bool header_end_stream_ = false;
+    bool in_header_block_ = false;
+
+    bool preface_ = false;
+    bool settings_received_ = false;
+    bool goaway_ = false;           // 对端不再发起新的流
+    bool closed_ = false;
+};
+
+} //namespace http_detail
+} //namespace network
@@ -0,0 +1,95 @@
+#include "http2_frame.h"
+#include <string.h>
+
+namespace network {
+
+    const size_t Http2Frame::kHeaderSize;
+    const uint32_t Http2Frame::kDefaultWindowSize;
+    const uint32_t Http2Frame::kMaxWindowSize;
+    const uint32_t Http2Frame::kDefaultMaxFrameSize;
+    const size_t Http2Frame::kPrefaceSize;
+    const char Http2Frame::kPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    static void AppendUint32(Buffer & out, uint32_t v)
+    {
+        char b[4] = {(char)(v >> 24), (char)(v >> 16), (char)(v >> 8), (char)v};
+        out.insert(out.end(), b, b + 4);
+    }
+
+    Http2FrameHeader Http2Frame::ParseHeader(const char* p)
+    {
+        const uint8_t* u = (const uint8_t*)p;
+        Http2FrameHeader h;
+        h.length = ((uint32_t)u[0] << 16) | ((uint32_t)u[1] << 8) | u[2];
+        h.type = (h2_frame)u[3];
+        h.flags = u[4];
+        h.stream_id = ReadUint32(p + 5) & 0x7fffffff;
+        return h;
+    }
+
+    void Http2Frame::AppendHeader(Buffer & out, uint32_t length, h2_frame type, uint8_t flags, uint32_t stream_id)
+    {
+        char b[kHeaderSize] = {(char)(length >> 16), (char)(length >> 8), (char)length,
+            (char)type, (char)flags,
+            (char)(stream_id >> 24), (char)(stream_id >> 16), (char)(stream_id >> 8), (char)stream_id};
+        out.insert(out.end(), b, b + kHeaderSize);
+    }
+
+    void Http2Frame::AppendSettings(Buffer & out, std::vector<std::pair<h2_setting, uint32_t>> const& settings)
+    {
+        AppendHeader(out, settings.size() * 6, h2_frame::settings, 0, 0);
+        for (auto const& kv : settings) {
+            uint16_t id = (uint16_t)kv.first;
+            out.push_back((char)(id >> 8));
+            out.push_back((char)id);
+            AppendUint32(out, kv.second);
+        }
+    }
+
+    void Http2Frame::AppendSettingsAck(Buffer & out)
+    {
+        AppendHeader(out, 0, h2_frame::settings, h2_ack, 0);
+    }
+
+    void Http2Frame::AppendWindowUpdate(Buffer & out, uint32_t stream_id, uint32_t increment)
+    {
+        AppendHeader(out, 4, h2_frame::window_update, 0, stream_id);
+        AppendUint32(out, increment);
+    }
+
+    void Http2Frame::AppendRstStream(Buffer & out, uint32_t stream_id, h2_error code)
+    {
+        AppendHeader(out, 4, h2_frame::rst_stream, 0, stream_id);
+        AppendUint32(out, (uint32_t)code);
+    }
+
+    void Http2Frame::AppendGoaway(Buffer & out, uint32_t last_stream_id, h2_error code)
+    {
+        AppendHeader(out, 8, h2_frame::goaway, 0, 0);
+        AppendUint32(out, last_stream_id);
+        AppendUint32(out, (uint32_t)code);
+    }
+
+    void Http2Frame::AppendPing(Buffer & out, const char data[8], bool ack)
+    {
+        AppendHeader(out, 8, h2_frame::ping, ack ? h2_ack : 0, 0);
+        out.insert(out.end(), data, data + 8);
+    }
+
+    void Http2Frame::AppendHeaders(Buffer & out, uint32_t stream_id, const char* block, size_t bytes,
+            bool end_stream, uint32_t max_frame_size)
+    {
+        h2_frame type = h2_frame::headers;
+        uint8_t flags = end_stream ? h2_end_stream : 0;
+        do {
+            size_t n = (std::min<size_t>)(bytes, max_frame_size);
+            bytes -= n;
+            AppendHeader(out, n, type, flags | (bytes ? 0 : h2_end_headers), stream_id);
+            out.insert(out.end(), block, block + n);
+            block += n;
+            type = h2_frame::continuation;
+            flags = 0;
+        } while (bytes);
+    }
+
+} //namespace network
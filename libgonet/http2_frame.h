@@ -0,0 +1,101 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+
+namespace network {
+
+// HTTP/2(RFC 7540)的帧类型、标志、错误码和设置项
+enum class h2_frame : uint8_t
+{
+    data = 0x0,
+    headers = 0x1,
+    priority = 0x2,
+    rst_stream = 0x3,
+    settings = 0x4,
+    push_promise = 0x5,
+    ping = 0x6,
+    goaway = 0x7,
+    window_update = 0x8,
+    continuation = 0x9,
+};
+
+enum h2_flag : uint8_t
+{
+    h2_end_stream = 0x1,
+    h2_ack = 0x1,
+    h2_end_headers = 0x4,
+    h2_padded = 0x8,
+    h2_priority = 0x20,
+};
+
+enum class h2_error : uint32_t
+{
+    no_error = 0x0,
+    protocol_error = 0x1,
+    internal_error = 0x2,
+    flow_control_error = 0x3,
+    settings_timeout = 0x4,
+    stream_closed = 0x5,
+    frame_size_error = 0x6,
+    refused_stream = 0x7,
+    cancel = 0x8,
+    compression_error = 0x9,
+    connect_error = 0xa,
+    enhance_your_calm = 0xb,
+    inadequate_security = 0xc,
+    http_1_1_required = 0xd,
+};
+
+enum class h2_setting : uint16_t
+{
+    header_table_size = 0x1,
+    enable_push = 0x2,
+    max_concurrent_streams = 0x3,
+    initial_window_size = 0x4,
+    max_frame_size = 0x5,
+    max_header_list_size = 0x6,
+};
+
+struct Http2FrameHeader
+{
+    uint32_t length = 0;
+    h2_frame type = h2_frame::data;
+    uint8_t flags = 0;
+    uint32_t stream_id = 0;
+};
+
+// 帧的编解码工具, 服务端和压测客户端共用.
+struct Http2Frame
+{
+    static const size_t kHeaderSize = 9;
+    static const uint32_t kDefaultWindowSize = 65535;
+    static const uint32_t kMaxWindowSize = 0x7fffffff;
+    static const uint32_t kDefaultMaxFrameSize = 16384;
+
+    // 客户端连接前言
+    static const char kPreface[];
+    static const size_t kPrefaceSize = 24;
+
+    // p至少有kHeaderSize字节
+    static Http2FrameHeader ParseHeader(const char* p);
+
+    static void AppendHeader(Buffer & out, uint32_t length, h2_frame type, uint8_t flags, uint32_t stream_id);
+    static void AppendSettings(Buffer & out, std::vector<std::pair<h2_setting, uint32_t>> const& settings);
+    static void AppendSettingsAck(Buffer & out);
+    static void AppendWindowUpdate(Buffer & out, uint32_t stream_id, uint32_t increment);
+    static void AppendRstStream(Buffer & out, uint32_t stream_id, h2_error code);
+    static void AppendGoaway(Buffer & out, uint32_t last_stream_id, h2_error code);
+    static void AppendPing(Buffer & out, const char data[8], bool ack);
+
+    // 头部块按max_frame_size切分成HEADERS + CONTINUATION
+    static void AppendHeaders(Buffer & out, uint32_t stream_id, const char* block, size_t bytes,
+            bool end_stream, uint32_t max_frame_size);
+
+    static uint32_t ReadUint32(const char* p)
+    {
+        const uint8_t* u = (const uint8_t*)p;
+        return ((uint32_t)u[0] << 24) | ((uint32_t)u[1] << 16) | ((uint32_t)u[2] << 8) | u[3];
+    }
+};
+
+} //namespace network
@@ -0,0 +1,493 @@
+#include "http_client.h"
+#include "tcp_detail.h"
+#include "error.h"
+#include <deque>
+#include <list>
+#include <chrono>
+#include <iterator>
+
+namespace network {
+namespace http_detail {
+
+    using boost::shared_ptr;
+    using boost::weak_ptr;
+    typedef std::chrono::steady_clock clock;
+
+    struct HttpConn;
+
+    // 一次请求. 等待者超时返回后, 连接上仍可能持有它, 因此由shared_ptr管理.
+    struct HttpCall
+    {
+        std::string request;
+        bool head = false;
+        bool reused = false;        // 发送在复用的连接上
+        HttpResponseParser::BodyCb on_body;
+        HttpClientResponse res;
+        weak_ptr<HttpConn> conn;
+        co::co_chan<boost_ec> done{1};
+
+        // 保护on_body: 等待者超时后置abandoned, 之后不再回调.
+        co::LFLock body_mtx;
+        bool abandoned = false;
+    };
+
+    struct HttpHost
+    {
+        std::string scheme;         // 创建时设置, 之后只读
+        std::string authority;      // host[:port]
+        co::LFLock mtx;
+        std::list<shared_ptr<HttpConn>> conns;
+        int connecting = 0;
+        endpoint addr;              // 首次建立连接时解析
+        bool resolved = false;
+        co::co_chan<bool> wakeup{1024};    // 有连接可用时通知等待者
+
+        boost_ec Resolve(endpoint & out);
+    };
+
+    struct HttpConn : public boost::enable_shared_from_this<HttpConn>
+    {
+        weak_ptr<HttpHost> host;
+        shared_ptr<tcp_detail::TcpClient> client;
+
+        co_mutex send_mtx;      // 串行化Send, 持有期间不持有mtx
+
+        // 以下由mtx保护
+        co::LFLock mtx;
+        std::deque<shared_ptr<HttpCall>> pending;  // 已发出, 等待应答
+        clock::time_point idle_since = clock::now();
+        bool closed = false;
+        bool used = false;
+
+        // 只在接收协程(及其后的断开回调)中访问
+        HttpResponseParser parser;
+
+        bool Send(shared_ptr<HttpCall> const& call, std::size_t max_pipeline);
+        size_t OnReceive(const char* data, size_t bytes);
+        void OnClose(boost_ec const& ec);
+        void Finish(shared_ptr<HttpCall> const& call);
+        void Close();
+    };
+
+    boost_ec HttpHost::Resolve(endpoint & out)
+    {
+        std::unique_lock<co::LFLock> lock(mtx);
+        if (resolved) {
+            out = addr;
+            return boost_ec();
+        }
+        lock.unlock();
+
+        boost_ec ec;
+        endpoint ep = endpoint::from_string(scheme + "://" + authority, ec);
+        if (ec) return ec;
+        if (!ep.port())
+            ep.port(ep.proto() == proto_type::https ? 443 : 80);
+
+        lock.lock();
+        addr = ep;
+        resolved = true;
+        out = ep;
+        return boost_ec();
+    }
+
+    bool HttpConn::Send(shared_ptr<HttpCall> const& call, std::size_t max_pipeline)
+    {
+        // 入队和发送都在send_mtx内, 线路上的顺序与pending一致.
+        // Send可能直接写socket, 不能在自旋锁mtx内进行, 因此用协程锁串行化.
+        std::unique_lock<co_mutex> send_lock(send_mtx);
+        {
+            std::unique_lock<co::LFLock> lock(mtx);
+            if (closed || pending.size() >= max_pipeline)
+                return false;
+
+            call->reused = used;
+            call->conn = this->shared_from_this();
+            used = true;
+            pending.push_back(call);
+        }
+        client->GetSession()->Send(call->request.data(), call->request.size());
+        return true;
+    }
+
+    size_t HttpConn::OnReceive(const char* data, size_t bytes)
+    {
+        size_t pos = 0;
+        while (pos < bytes) {
+            shared_ptr<HttpCall> call;
+            {
+                std::unique_lock<co::LFLock> lock(mtx);
+                if (pending.empty())
+                    return (size_t)-1;  // 没有请求却收到了数据
+                call = pending.front();
+            }
+
+            if (!parser.Started())
+                parser.Reset(call->head);
+
+            size_t consumed = 0;
+            HttpResponseParser::result_t r;
+            {
+                std::unique_lock<co::LFLock> lock(call->body_mtx);
+                static const HttpResponseParser::BodyCb discard = [](const char*, size_t){};
+                r = parser.Parse(data + pos, bytes - pos, call->res, consumed,
+                        call->abandoned ? discard : call->on_body);
+            }
+            pos += consumed;
+
+            if (r == HttpResponseParser::error)
+                return (size_t)-1;
+            if (r == HttpResponseParser::incomplete)
+                break;
+
+            parser.Reset();
+            Finish(call);
+        }
+        return pos;
+    }
+
+    void HttpConn::Finish(shared_ptr<HttpCall> const& call)
+    {
+        {
+            std::unique_lock<co::LFLock> lock(mtx);
+            pending.pop_front();
+            // 服务端要关闭连接, 不再在这个连接上发出新的请求.
+            if (!call->res.keep_alive)
+                closed = true;
+            if (pending.empty())
+                idle_since = clock::now();
+        }
+
+        call->done.TryPush(boost_ec());
+        if (auto h = host.lock())
+            h->wakeup.TryPush(true);
+    }
+
+    void HttpConn::OnClose(boost_ec const& ec)
+    {
+        std::deque<shared_ptr<HttpCall>> calls;
+        {
+            std::unique_lock<co::LFLock> lock(mtx);
+            closed = true;
+            calls.swap(pending);
+        }
+
+        // 以关闭连接为结束的应答
+        if (!calls.empty() && parser.Started() && parser.OnEof() == HttpResponseParser::complete) {
+            calls.front()->done.TryPush(boost_ec());
+            calls.pop_front();
+        }
+
+        boost_ec err = ec ? ec : MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown);
+        for (auto & call : calls)
+            call->done.TryPush(err);
+
+        if (auto h = host.lock()) {
+            {
+                std::unique_lock<co::LFLock> lock(h->mtx);
+                h->conns.remove(this->shared_from_this());
+            }
+            h->wakeup.TryPush(true);
+        }
+    }
+
+    void HttpConn::Close()
+    {
+        {
+            std::unique_lock<co::LFLock> lock(mtx);
+            closed = true;
+        }
+        client->GetSession()->Shutdown(true);
+    }
+
+    static bool SplitUrl(std::string const& url, std::string & scheme,
+            std::string & authority, std::string & target)
+    {
+        size_t pos = url.find("://");
+        if (pos == std::string::npos) return false;
+        scheme = url.substr(0, pos);
+        size_t slash = url.find('/', pos + 3);
+        authority = url.substr(pos + 3, slash == std::string::npos ? std::string::npos : slash - pos - 3);
+        target = slash == std::string::npos ? "/" : url.substr(slash);
+        return !authority.empty();
+    }
+
+    static bool IsIdempotent(std::string const& method)
+    {
+        return method == "GET" || method == "HEAD" || method == "PUT" ||
+            method == "DELETE" || method == "OPTIONS";
+    }
+
+    static std::string BuildRequest(HttpClientRequest const& req, std::string const& authority,
+            std::string const& target)
+    {
+        std::string s;
+        s.reserve(128 + target.size() + req.body.size());
+        s += req.method;
+        s += ' ';
+        s += target;
+        s += " HTTP/1.1\r\nHost: ";
+        s += authority;
+        s += "\r\n";
+        for (auto const& kv : req.headers) {
+            s += kv.first;
+            s += ": ";
+            s += kv.second;
+            s += "\r\n";
+        }
+        if (!req.body.empty() || req.method == "POST" || req.method == "PUT" || req.method == "PATCH") {
+            s += "Content-Length: ";
+            s += std::to_string(req.body.size());
+            s += "\r\n";
+        }
+        s += "\r\n";
+        s += req.body;
+        return s;
+    }
+
+    static shared_ptr<HttpConn> Connect(shared_ptr<HttpHost> const& host,
+            shared_ptr<const OptionsData> const& opt, boost_ec & ec)
+    {
+        endpoint addr;
+        ec = host->Resolve(addr);
+        if (ec) return shared_ptr<HttpConn>();
+
+        shared_ptr<HttpConn> conn = boost::make_shared<HttpConn>();
+        conn->host = host;
+        conn->client = boost::make_shared<tcp_detail::TcpClient>();
+
+        // 继承HttpClient上的配置, 收发回调由连接池占用.
+        OptionsBase* o = conn->client->GetOptions();
+        o->opt_ = *opt;
+#if ENABLE_SSL
+        std::string hostname = host->authority.substr(0, host->authority.rfind(':'));
+        boost_ec ignore_ec;
+        boost::asio::ip::address::from_string(hostname, ignore_ec);
+        if (addr.proto() == proto_type::https && o->opt_.ssl_option_.server_name.empty() && ignore_ec)
+            o->opt_.ssl_option_.server_name = hostname;
+#endif
+        weak_ptr<HttpConn> weak(conn);
+        o->SetReceiveRefCb([weak](SessionRef, const char* data, size_t bytes) {
+                    shared_ptr<HttpConn> c = weak.lock();
+                    return c ? c->OnReceive(data, bytes) : (size_t)-1;
+                });
+        o->SetDisconnectedCb([weak](SessionEntry, boost_ec const& ec) {
+                    if (shared_ptr<HttpConn> c = weak.lock())
+                        c->OnClose(ec);
+                });
+
+        ec = conn->client->Connect(addr);
+        if (ec) return shared_ptr<HttpConn>();
+        return conn;
+    }
+
+    // 选择或新建一个连接并发出请求
+    static boost_ec Submit(shared_ptr<HttpHost> const& host, shared_ptr<HttpCall> const& call,
+            shared_ptr<const OptionsData> const& opt, clock::time_point deadline)
+    {
+        std::size_t max_pipeline = (std::max)(opt->http_max_pipeline_, 1);
+        std::size_t max_conns = (std::max)(opt->http_max_conns_per_host_, 1);
+        auto keepalive = std::chrono::milliseconds((std::max)(opt->http_keepalive_timeout_, 0));
+
+        for (;;) {
+            shared_ptr<HttpConn> conn;
+            std::vector<shared_ptr<HttpConn>> expired;
+            bool create = false;
+            {
+                std::unique_lock<co::LFLock> lock(host->mtx);
+                clock::time_point now = clock::now();
+                std::size_t best = max_pipeline;
+                for (auto it = host->conns.begin(); it != host->conns.end(); ) {
+                    shared_ptr<HttpConn> const& c = *it++;
+                    std::unique_lock<co::LFLock> conn_lock(c->mtx);
+                    if (c->closed) {
+                        // 建立后立即断开的连接, 断开回调可能早于加入连接池.
+                        if (!c->client->GetSession()->IsEstab()) {
+                            conn_lock.unlock();
+                            host->conns.erase(std::prev(it));
+                        }
+                        continue;
+                    }
+                    if (c->pending.empty() && now - c->idle_since > keepalive) {
+                        expired.push_back(c);
+                        continue;
+                    }
+                    if (c->pending.size() < best) {
+                        best = c->pending.size();
+                        conn = c;
+                        if (!best) break;
+                    }
+                }
+
+                if (!conn && host->conns.size() - expired.size() + host->connecting < max_conns) {
+                    ++host->connecting;
+                    create = true;
+                }
+            }
+
+            for (auto & c : expired)
+                c->Close();
+
+            if (create) {
+                boost_ec ec;
+                conn = Connect(host, opt, ec);
+                {
+                    std::unique_lock<co::LFLock> lock(host->mtx);
+                    --host->connecting;
+                    if (conn)
+                        host->conns.push_back(conn);
+                }
+                if (ec) {
+                    host->wakeup.TryPush(true);
+                    return ec;
+                }
+            }
+
+            if (conn && conn->Send(call, max_pipeline))
+                return boost_ec();
+
+            if (!conn) {
+                // 连接数已满, 等待有连接空闲或断开
+                clock::duration wait = std::chrono::milliseconds(100);
+                if (deadline != clock::time_point::max()) {
+                    clock::time_point now = clock::now();
+                    if (now >= deadline)
+                        return MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_timeout);
+                    wait = (std::min)(wait, deadline - now);
+                }
+                bool ignore;
+                host->wakeup.TimedPop(ignore, wait);
+            }
+        }
+    }
+
+    static boost_ec Wait(shared_ptr<HttpCall> const& call, clock::time_point deadline)
+    {
+        boost_ec ec;
+        if (deadline == clock::time_point::max()) {
+            call->done >> ec;
+            return ec;
+        }
+
+        clock::time_point now = clock::now();
+        if (now < deadline && call->done.TimedPop(ec, deadline - now))
+            return ec;
+
+        {
+            std::unique_lock<co::LFLock> lock(call->body_mtx);
+            call->abandoned = true;
+        }
+        // 后续的应答无法再与请求对应, 关闭连接.
+        if (shared_ptr<HttpConn> conn = call->conn.lock())
+            conn->Close();
+        return MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_timeout);
+    }
+
+} //namespace http_detail
+
+    using namespace http_detail;
+
+    HttpClient::HttpClient()
+    {
+    }
+
+    HttpClient::~HttpClient()
+    {
+        Shutdown();
+    }
+
+    boost::shared_ptr<HttpHost> HttpClient::GetHost(std::string const& scheme, std::string const& authority)
+    {
+        std::unique_lock<co::LFLock> lock(hosts_mtx_);
+        boost::shared_ptr<HttpHost> & host = hosts_[scheme + "://" + authority];
+        if (!host) {
+            // 在放入hosts_之前设置, 之后不再修改, 其他协程无需加锁读取.
+            host = boost::make_shared<HttpHost>();
+            host->scheme = scheme;
+            host->authority = authority;
+        }
+        return host;
+    }
+
+    boost_ec HttpClient::Do(HttpClientRequest const& req, HttpClientResponse & res)
+    {
+        std::string scheme, authority, target;
+        if (!SplitUrl(req.url, scheme, authority, target))
+            return MakeNetworkErrorCode(eNetworkErrorCode::ec_url_parse_error);
+        if (scheme != "http" && scheme != "https")
+            return MakeNetworkErrorCode(eNetworkErrorCode::ec_unsupport_protocol);
+
+        boost::shared_ptr<HttpHost> host = GetHost(scheme, authority);
+
+        boost::shared_ptr<const OptionsData> opt = GetSnapshot();
+        int timeout = req.timeout > 0 ? req.timeout : opt->http_request_timeout_;
+        clock::time_point deadline = timeout > 0
+            ? clock::now() + std::chrono::milliseconds(timeout)
+            : clock::time_point::max();
+
+        std::string request = BuildRequest(req, authority, target);
+        for (int attempt = 0; ; ++attempt) {
+            boost::shared_ptr<HttpCall> call = boost::make_shared<HttpCall>();
+            call->request = request;
+            call->head = req.method == "HEAD";
+            call->on_body = req.on_body;
+
+            boost_ec ec = Submit(host, call, opt, deadline);
+            if (!ec)
+                ec = Wait(call, deadline);
+            if (!ec) {
+                res = std::move(call->res);
+                return ec;
+            }
+
+            // 复用的连接已被对端关闭, 请求没有得到任何应答, 幂等请求重试一次.
+            bool retry = attempt == 0 && call->reused && !call->res.status &&
+                IsIdempotent(req.method) && ec != MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_timeout);
+            if (!retry)
+                return ec;
+        }
+    }
+
+    boost_ec HttpClient::Get(std::string const& url, HttpClientResponse & res)
+    {
+        HttpClientRequest req;
+        req.url = url;
+        return Do(req, res);
+    }
+
+    boost_ec HttpClient::Post(std::string const& url, std::string const& body, HttpClientResponse & res)
+    {
+        HttpClientRequest req;
+        req.method = "POST";
+        req.url = url;
+        req.body = body;
+        return Do(req, res);
+    }
+
+    void HttpClient::Shutdown()
+    {
+        std::vector<boost::shared_ptr<HttpConn>> conns;
+        {
+            std::unique_lock<co::LFLock> lock(hosts_mtx_);
+            for (auto & kv : hosts_) {
+                std::unique_lock<co::LFLock> host_lock(kv.second->mtx);
+                conns.insert(conns.end(), kv.second->conns.begin(), kv.second->conns.end());
+            }
+        }
+
+        for (auto & conn : conns)
+            conn->Close();
+    }
+
+    std::size_t HttpClient::ConnectionCount()
+    {
+        std::size_t n = 0;
+        std::unique_lock<co::LFLock> lock(hosts_mtx_);
+        for (auto & kv : hosts_) {
+            std::unique_lock<co::LFLock> host_lock(kv.second->mtx);
+            n += kv.second->conns.size();
+        }
+        return n;
+    }
+
+} //namespace network
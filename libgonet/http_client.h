@@ -0,0 +1,59 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+#include "option.h"
+#include "http_parser.h"
+#include <map>
+
+namespace network {
+
+namespace http_detail { struct HttpHost; }
+
+struct HttpClientRequest
+{
+    std::string method = "GET";
+    std::string url;            // http://host[:port][/path][?query], 或https
+    std::vector<std::pair<std::string, std::string>> headers;  // Host和Content-Length自动生成
+    std::string body;
+    int timeout = 0;            // ms, <=0时使用SetHttpRequestTimeout的配置
+
+    // 流式接收: 设置后应答的body不保存在HttpClientResponse中, 每收到一段即回调.
+    // 在连接的接收协程中调用; Do返回(包括超时)之后不会再被调用.
+    HttpResponseParser::BodyCb on_body;
+};
+
+// http/1.1客户端, 以TcpClient为连接, 按host(协议+地址+端口)维护keep-alive连接池.
+// 请求在调用者的协程中同步等待应答, 不占用线程; 多个协程可以同时使用同一个HttpClient.
+//
+// 连接池的配置见option.h中的http_*选项, ssl等其他配置作用于池中新建的连接.
+// http_max_pipeline_ > 1时, 同一连接上可以连续发出多个请求, 应答按顺序对应.
+// 复用的空闲连接可能恰好已被服务端关闭, 此时幂等请求(GET/HEAD/PUT/DELETE/OPTIONS)
+// 在尚未收到任何应答数据的情况下自动在新连接上重试一次.
+class HttpClient : public Options<HttpClient>
+{
+public:
+    HttpClient();
+    ~HttpClient();
+
+    // 收到完整的应答(包括4xx/5xx)时返回成功, 状态码见res.status.
+    // 超时返回ec_recv_timeout, 其他为url解析、连接、数据解析等错误.
+    boost_ec Do(HttpClientRequest const& req, HttpClientResponse & res);
+    boost_ec Get(std::string const& url, HttpClientResponse & res);
+    boost_ec Post(std::string const& url, std::string const& body, HttpClientResponse & res);
+
+    // 关闭所有连接, 等待中的请求以错误返回.
+    void Shutdown();
+
+    // 池中的连接总数(包括空闲的)
+    std::size_t ConnectionCount();
+
+private:
+    boost::shared_ptr<http_detail::HttpHost> GetHost(std::string const& scheme, std::string const& authority);
+
+private:
+    typedef std::map<std::string, boost::shared_ptr<http_detail::HttpHost>> Hosts;
+    co::LFLock hosts_mtx_;
+    Hosts hosts_;
+};
+
+} //namespace network
@@ -0,0 +1,204 @@
+#include "http_detail.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace network {
+namespace http_detail {
+
+    void HttpConnection::Flush()
+    {
+        if (out.empty()) return ;
+        Buffer buf;
+        buf.swap(out);
+        sess->Send(std::move(buf));
+    }
+
+    HttpConnection& HttpConnection::Get(SessionRef sess)
+    {
+        boost::any & storage = sess->ProtoStorage();
+        HttpConnection* conn = boost::any_cast<HttpConnection>(&storage);
+        if (!conn) {
+            storage = HttpConnection();
+            conn = boost::any_cast<HttpConnection>(&storage);
+        }
+        conn->sess = sess.operator->();
+        return *conn;
+    }
+
+    static void Append(Buffer & out, const char* data, size_t bytes)
+    {
+        out.insert(out.end(), data, data + bytes);
+    }
+
+    static void AppendChunk(Buffer & out, const char* data, size_t bytes)
+    {
+        char size[24];
+        int n = snprintf(size, sizeof(size), "%zx\r\n", bytes);
+        Append(out, size, n);
+        Append(out, data, bytes);
+        Append(out, "\r\n", 2);
+    }
+
+    size_t HttpServer::OnReceive(HttpCb const& cb, Http2Options const& h2, SessionRef sess,
+            const char* data, size_t bytes)
+    {
+        HttpConnection & conn = HttpConnection::Get(sess);
+        if (conn.h2)
+            return conn.h2->OnReceive(cb, sess, data, bytes);
+
+        if (h2.enabled && !conn.h2_checked) {
+            // 只在连接开头检查连接前言, 收到完整的前言之前不消费数据.
+            size_t n = (std::min)(bytes, Http2Frame::kPrefaceSize);
+            if (memcmp(data, Http2Frame::kPreface, n) == 0) {
+                if (n < Http2Frame::kPrefaceSize)
+                    return 0;
+                conn.h2.reset(new Http2Connection(h2));
+                return conn.h2->OnReceive(cb, sess, data, bytes);
+            }
+            conn.h2_checked = true;
+        }
+
+        size_t pos = 0;
+        bool close = false;
+        while (pos < bytes) {
+            size_t consumed = 0;
+            HttpRequestParser::result_t r = conn.parser.Parse(data + pos, bytes - pos, conn.req, consumed);
+            if (r == HttpRequestParser::incomplete)
+                break;
+
+            if (r == HttpRequestParser::error) {
+                HttpResponse res(&conn);
+                res.status = 400;
+                res.SerializeHead(conn.out, false, 1, false);
+                conn.parser.Reset();
+                pos = bytes;
+                close = true;
+                break;
+            }
+
+            pos += consumed;
+            HttpRequest const& req = conn.req;
+            conn.keep_alive = req.keep_alive;
+            conn.head = req.method == "HEAD";
+            conn.minor_version = req.minor_version;
+
+            HttpResponse res(&conn);
+            if (cb)
+                cb(sess, req, res);
+            else
+                res.status = 404;
+
+            bool keep_alive = req.keep_alive && !res.close;
+            if (res.IsStreaming()) {
+                // HEAD的应答只有头部, 也不能有结束块, 否则会被当作下一个应答的开始.
+                if (!conn.head) {
+                    if (!res.body.empty())
+                        AppendChunk(conn.out, res.body.data(), res.body.size());
+                    Append(conn.out, "0\r\n\r\n", 5);
+                }
+            } else if (res.Raw()) {
+                // 先带出之前的应答, 保持顺序
+                conn.Flush();
+                sess->SendShared(res.Raw());
+            } else {
+                res.SerializeHead(conn.out, keep_alive, req.minor_version, false);
+                if (conn.head) {
+                    // HEAD只发送头部
+                } else if (res.File()) {
+                    boost::shared_ptr<HttpFile> file = res.File();
+                    conn.Flush();
+                    sess->SendFile(file->fd, file->offset, file->bytes, [file](boost_ec const&){});
+                } else {
+                    Append(conn.out, res.body.data(), res.body.size());
+                }
+            }
+
+            if (!keep_alive) {
+                // 之后的请求不再处理
+                conn.parser.Reset();
+                pos = bytes;
+                close = true;
+                break;
+            }
+        }
+
+        conn.Flush();
+        if (close)
+            sess->Shutdown(false);
+        return pos;
+    }
+
+    boost_ec HttpServer::goStartBeforeFork(endpoint addr)
+    {
+        InstallReceiveCb();
+        return TcpServer::goStartBeforeFork(addr);
+    }
+
+    void HttpServer::OnSetHttpCb()
+    {
+        InstallReceiveCb();
+    }
+
+    void HttpServer::OnSetReceiveRefCb()
+    {
+        // 接收回调归协议层所有, 用户设置的回调被覆盖(见network.h).
+        InstallReceiveCb();
+    }
+
+    void HttpServer::OnSetHttp2()
+    {
+        InstallReceiveCb();
+    }
+
+    void HttpServer::OnSetHttp2MaxConcurrentStreams()
+    {
+        InstallReceiveCb();
+    }
+
+    void HttpServer::OnSetHttp2WindowSize()
+    {
+        InstallReceiveCb();
+    }
+
+    void HttpServer::InstallReceiveCb()
+    {
+        Http2Options h2;
+        h2.enabled = opt_.http2_;
+        h2.max_concurrent_streams = opt_.http2_max_concurrent_streams_;
+        // 窗口不能超过2^31-1, 也不能小于协议默认值(不发送缩小窗口的SETTINGS)
+        h2.window_size = (std::max)((std::min)(opt_.http2_window_size_, Http2Frame::kMaxWindowSize),
+                Http2Frame::kDefaultWindowSize);
+        // 与http/1.1请求的上限(接收缓冲区上限)一致
+        h2.max_body_size = (std::max)(opt_.max_pack_size_hard_, opt_.max_pack_size_);
+
+        // 直接修改而不经过SetReceiveRefCb, 避免再次进入OnSetReceiveRefCb.
+        HttpCb cb = opt_.http_cb_;
+        opt_.receive_ref_cb_ = [cb, h2](SessionRef sess, const char* data, size_t bytes) {
+            return HttpServer::OnReceive(cb, h2, sess, data, bytes);
+        };
+        ++version_;
+    }
+
+} //namespace http_detail
+
+    void HttpResponse::WriteChunk(const void* data, size_t bytes)
+    {
+        http_detail::HttpConnection* conn = conn_;
+        if (!conn || conn->minor_version == 0) {
+            // HTTP/1.0不支持chunked, 合并到body中一次发送.
+            body.append((const char*)data, bytes);
+            return ;
+        }
+
+        if (!streaming_) {
+            streaming_ = true;
+            SerializeHead(conn->out, conn->keep_alive && !close, conn->minor_version, true);
+        }
+
+        if (bytes && !conn->head)
+            http_detail::AppendChunk(conn->out, (const char*)data, bytes);
+        // 同时带出同一批中之前请求的应答, 保持顺序.
+        conn->Flush();
+    }
+
+} //namespace network
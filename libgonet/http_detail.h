@@ -0,0 +1,59 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+#include "option.h"
+#include "tcp_detail.h"
+#include "http_parser.h"
+#include "http_response.h"
+#include "http2_detail.h"
+
+namespace network {
+namespace http_detail {
+
+// 每个http连接的状态, 保存在session的ProtoStorage中, 只在接收协程中访问.
+struct HttpConnection
+{
+    HttpRequestParser parser;
+    HttpRequest req;            // 复用, 保留headers的容量
+    Buffer out;                 // 一次接收中处理的所有请求的应答, 合并发送
+
+    // 当前请求, 供流式应答使用
+    SessionBase* sess = nullptr;
+    bool keep_alive = true;
+    bool head = false;          // HEAD请求不发送body
+    int minor_version = 1;
+
+    // h2c: 连接以HTTP/2连接前言开头时创建, 之后的数据都交给它.
+    boost::shared_ptr<Http2Connection> h2;
+    bool h2_checked = false;    // 已确定是http/1.x连接
+
+    void Flush();
+
+    static HttpConnection& Get(SessionRef sess);
+};
+
+// 基于TcpServer的http/1.1服务端.
+// 接收回调由引擎占用: 解析出的请求按顺序交给HttpCb, 一次接收到的多个请求(pipelining)
+// 的应答按请求顺序合并成一次发送. 请求要求关闭连接(或应答设置了close)时, 发送完应答后关闭.
+// 开启SetHttp2后, 以HTTP/2连接前言开头的连接交给Http2Connection处理(h2c prior knowledge).
+class HttpServer : public tcp_detail::TcpServer
+{
+public:
+    boost_ec goStartBeforeFork(endpoint addr) override;
+
+    static size_t OnReceive(HttpCb const& cb, Http2Options const& h2, SessionRef sess,
+            const char* data, size_t bytes);
+
+protected:
+    void OnSetHttpCb() override;
+    void OnSetReceiveRefCb() override;
+    void OnSetHttp2() override;
+    void OnSetHttp2MaxConcurrentStreams() override;
+    void OnSetHttp2WindowSize() override;
+
+private:
+    void InstallReceiveCb();
+};
+
+} //namespace http_detail
+} //namespace network
@@ -0,0 +1,555 @@
+#include "http_parser.h"
+#include <string.h>
+#include <ctype.h>
+#include <limits>
+
+namespace network {
+
+    static bool IEquals(string_view a, string_view b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+                return false;
+        return true;
+    }
+
+    static string_view Trim(string_view s)
+    {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        return s;
+    }
+
+    // 逗号分隔的列表中是否有token
+    static bool HasToken(string_view list, string_view token)
+    {
+        while (!list.empty()) {
+            size_t pos = list.find(',');
+            if (IEquals(Trim(list.substr(0, pos)), token))
+                return true;
+            if (pos == string_view::npos)
+                break;
+            list.remove_prefix(pos + 1);
+        }
+        return false;
+    }
+
+    // 逗号分隔的列表中的最后一项
+    static string_view LastToken(string_view list)
+    {
+        size_t pos = list.rfind(',');
+        return Trim(pos == string_view::npos ? list : list.substr(pos + 1));
+    }
+
+    static bool ParseContentLength(string_view value, size_t & length)
+    {
+        if (value.empty()) return false;
+        length = 0;
+        for (char c : value) {
+            if (!isdigit((unsigned char)c)) return false;
+            if (length > (std::numeric_limits<size_t>::max() - 9) / 10) return false;
+            length = length * 10 + (c - '0');
+        }
+        return true;
+    }
+
+    // 头部行: name ":" OWS value OWS CRLF, p指向行首.
+    // 返回complete时name/value指向数据中去掉空白的部分, next指向下一行.
+    // 请求和应答解析器共用, 返回对应解析器的result_t.
+    template <typename Parser>
+    static typename Parser::result_t ParseHeaderLine(const char* p, const char* end,
+            string_view & name, string_view & value, const char* & next)
+    {
+        const char* colon = HttpScan::Find(p, end, HttpScan::cs_token);
+        if (colon == end)
+            return Parser::incomplete;
+        if (*colon != ':' || colon == p)
+            return Parser::error;
+
+        const char* v = colon + 1;
+        while (v < end && (*v == ' ' || *v == '\t'))
+            ++v;
+        const char* eol = HttpScan::Find(v, end, HttpScan::cs_value);
+        if (end - eol < 2)
+            return Parser::incomplete;
+        if (eol[0] != '\r' || eol[1] != '\n')
+            return Parser::error;
+
+        const char* ve = eol;
+        while (ve > v && (ve[-1] == ' ' || ve[-1] == '\t'))
+            --ve;
+        name = string_view(p, colon - p);
+        value = string_view(v, ve - v);
+        next = eol + 2;
+        return Parser::complete;
+    }
+
+    // chunk-size [; ext] CRLF, nl指向行尾的'\n'
+    static bool ParseChunkSize(const char* p, const char* nl, size_t & size)
+    {
+        size_t digits = 0;
+        size = 0;
+        for (; p < nl && isxdigit((unsigned char)*p); ++p, ++digits) {
+            if (digits >= sizeof(size_t) * 2 - 1) return false;
+            size = size * 16 + (isdigit((unsigned char)*p) ? *p - '0' : (tolower(*p) - 'a' + 10));
+        }
+        return digits && (*p == ';' || *p == '\r') && nl[-1] == '\r';
+    }
+
+    string_view HttpRequest::GetHeader(string_view name) const
+    {
+        for (auto const& h : headers)
+            if (IEquals(h.name, name))
+                return h.value;
+        return string_view();
+    }
+
+    void HttpRequestParser::Reset()
+    {
+        line_pos_ = 0;
+        header_len_ = 0;
+        content_length_ = 0;
+        body_pos_ = 0;
+        chunk_left_ = 0;
+        headers_.clear();
+        body_.clear();
+        minor_version_ = 1;
+        keep_alive_ = true;
+        chunked_ = false;
+        has_length_ = false;
+        chunk_state_ = cs_size;
+        transfer_encoding_ = Slice{0, 0};
+    }
+
+    HttpRequestParser::result_t HttpRequestParser::Parse(const char* data, size_t bytes,
+            HttpRequest & req, size_t & consumed)
+    {
+        if (!header_len_) {
+            result_t r = ParseHead(data, bytes);
+            if (r == incomplete && bytes > kMaxHeaderSize)
+                return error;
+            if (r != complete)
+                return r;
+            if (header_len_ > kMaxHeaderSize)
+                return error;
+            body_pos_ = header_len_;
+        }
+
+        size_t total;
+        if (chunked_) {
+            result_t r = ParseChunked(data, bytes);
+            if (r != complete)
+                return r;
+            total = body_pos_;
+        } else {
+            if (bytes - header_len_ < content_length_)
+                return incomplete;
+            total = header_len_ + content_length_;
+        }
+
+        Fill(data, req);
+        consumed = total;
+        Reset();
+        return complete;
+    }
+
+    HttpRequestParser::result_t HttpRequestParser::ParseHead(const char* data, size_t bytes)
+    {
+        const char* end = data + bytes;
+
+        if (!line_pos_) {
+            // request-line: method SP target SP HTTP/1.x CRLF
+            const char* p = data;
+            const char* sp = HttpScan::Find(p, end, HttpScan::cs_token);
+            if (sp == end) return incomplete;
+            if (*sp != ' ' || sp == p) return error;
+            method_ = Slice{0, (uint32_t)(sp - p)};
+
+            p = sp + 1;
+            sp = HttpScan::Find(p, end, HttpScan::cs_target);
+            if (sp == end) return incomplete;
+            if (*sp != ' ' || sp == p) return error;
+            target_ = Slice{(uint32_t)(p - data), (uint32_t)(sp - p)};
+
+            p = sp + 1;
+            if (end - p < 10) return incomplete;
+            if (memcmp(p, "HTTP/1.", 7) != 0 || !isdigit((unsigned char)p[7]) ||
+                    p[8] != '\r' || p[9] != '\n')
+                return error;
+            minor_version_ = p[7] - '0';
+            keep_alive_ = minor_version_ >= 1;
+            line_pos_ = p + 10 - data;
+        }
+
+        for (;;) {
+            const char* p = data + line_pos_;
+            if (p == end) return incomplete;
+            if (*p == '\r') {
+                // 空行, 头部结束
+                if (end - p < 2) return incomplete;
+                if (p[1] != '\n') return error;
+                header_len_ = line_pos_ + 2;
+                break;
+            }
+
+            string_view name, value;
+            const char* next;
+            result_t r = ParseHeaderLine<HttpRequestParser>(p, end, name, value, next);
+            if (r != complete) return r;
+
+            Slice name_slice{(uint32_t)(name.data() - data), (uint32_t)name.size()};
+            Slice value_slice{(uint32_t)(value.data() - data), (uint32_t)value.size()};
+            if (!OnHeader(data, name_slice, value_slice))
+                return error;
+            headers_.push_back(std::make_pair(name_slice, value_slice));
+            line_pos_ = next - data;
+        }
+
+        // 同时存在时以Transfer-Encoding为准; 最后一个编码不是chunked时无法确定请求体长度.
+        if (transfer_encoding_.len) {
+            string_view te(data + transfer_encoding_.off, transfer_encoding_.len);
+            if (!IEquals(LastToken(te), "chunked"))
+                return error;
+            chunked_ = true;
+            content_length_ = 0;
+        }
+        return complete;
+    }
+
+    bool HttpRequestParser::OnHeader(const char* data, Slice name_slice, Slice value_slice)
+    {
+        string_view name(data + name_slice.off, name_slice.len);
+        string_view value(data + value_slice.off, value_slice.len);
+
+        if (IEquals(name, "content-length")) {
+            size_t length = 0;
+            if (!ParseContentLength(value, length)) return false;
+            if (has_length_ && length != content_length_) return false;
+            content_length_ = length;
+            has_length_ = true;
+        } else if (IEquals(name, "transfer-encoding")) {
+            transfer_encoding_ = value_slice;
+        } else if (IEquals(name, "connection")) {
+            if (HasToken(value, "close"))
+                keep_alive_ = false;
+            else if (HasToken(value, "keep-alive"))
+                keep_alive_ = true;
+        }
+        return true;
+    }
+
+    HttpRequestParser::result_t HttpRequestParser::ParseChunked(const char* data, size_t bytes)
+    {
+        for (;;) {
+            switch (chunk_state_) {
+            case cs_size:
+                {
+                    // chunk-size [; ext] CRLF
+                    const char* nl = (const char*)memchr(data + body_pos_, '\n', bytes - body_pos_);
+                    if (!nl)
+                        return bytes - body_pos_ > 1024 ? error : incomplete;
+
+                    size_t size = 0;
+                    if (!ParseChunkSize(data + body_pos_, nl, size))
+                        return error;
+
+                    body_pos_ = nl + 1 - data;
+                    chunk_left_ = size;
+                    chunk_state_ = size ? cs_data : cs_trailer;
+                }
+                break;
+
+            case cs_data:
+                {
+                    size_t n = (std::min)(chunk_left_, bytes - body_pos_);
+                    body_.append(data + body_pos_, n);
+                    body_pos_ += n;
+                    chunk_left_ -= n;
+                    if (chunk_left_)
+                        return incomplete;
+                    chunk_state_ = cs_data_end;
+                }
+                break;
+
+            case cs_data_end:
+                if (bytes - body_pos_ < 2)
+                    return incomplete;
+                if (data[body_pos_] != '\r' || data[body_pos_ + 1] != '\n')
+                    return error;
+                body_pos_ += 2;
+                chunk_state_ = cs_size;
+                break;
+
+            case cs_trailer:
+                {
+                    // 忽略trailer, 空行结束
+                    const char* nl = (const char*)memchr(data + body_pos_, '\n', bytes - body_pos_);
+                    if (!nl)
+                        return bytes - body_pos_ > kMaxHeaderSize ? error : incomplete;
+                    bool empty_line = nl == data + body_pos_ + 1 && nl[-1] == '\r';
+                    body_pos_ = nl + 1 - data;
+                    if (empty_line)
+                        return complete;
+                }
+                break;
+            }
+        }
+    }
+
+    void HttpRequestParser::Fill(const char* data, HttpRequest & req)
+    {
+        req.method = string_view(data + method_.off, method_.len);
+        req.target = string_view(data + target_.off, target_.len);
+        size_t q = req.target.find('?');
+        req.path = req.target.substr(0, q);
+        req.query = q == string_view::npos ? string_view() : req.target.substr(q + 1);
+        req.major_version = 1;
+        req.minor_version = minor_version_;
+        req.keep_alive = keep_alive_;
+        req.chunked = chunked_;
+
+        req.headers.resize(headers_.size());
+        for (size_t i = 0; i < headers_.size(); ++i) {
+            req.headers[i].name = string_view(data + headers_[i].first.off, headers_[i].first.len);
+            req.headers[i].value = string_view(data + headers_[i].second.off, headers_[i].second.len);
+        }
+
+        if (chunked_) {
+            req.chunked_body_.swap(body_);
+            req.body = req.chunked_body_;
+        } else {
+            req.body = string_view(data + header_len_, content_length_);
+        }
+    }
+
+    string_view HttpClientResponse::GetHeader(string_view name) const
+    {
+        for (auto const& h : headers)
+            if (IEquals(h.first, name))
+                return h.second;
+        return string_view();
+    }
+
+    void HttpResponseParser::Reset(bool head_request)
+    {
+        head_size_ = 0;
+        left_ = 0;
+        state_ = st_status_line;
+        head_request_ = head_request;
+        started_ = false;
+    }
+
+    HttpResponseParser::result_t HttpResponseParser::Parse(const char* data, size_t bytes,
+            HttpClientResponse & res, size_t & consumed, BodyCb const& on_body)
+    {
+        size_t pos = 0;
+        consumed = 0;
+        if (bytes)
+            started_ = true;
+
+        for (;;) {
+            switch (state_) {
+            case st_status_line:
+            case st_header:
+                {
+                    if (state_ == st_status_line)
+                        head_size_ = 0;
+
+                    size_t n = 0;
+                    result_t r = state_ == st_status_line
+                        ? ParseStatusLine(data + pos, bytes - pos, res, n)
+                        : ParseHeader(data + pos, bytes - pos, res, n);
+                    if (r == error)
+                        return error;
+                    if (r == incomplete)
+                        return head_size_ + (bytes - pos) > HttpRequestParser::kMaxHeaderSize ? error : incomplete;
+
+                    pos += n;
+                    consumed = pos;
+                    head_size_ += n;
+                    if (head_size_ > HttpRequestParser::kMaxHeaderSize)
+                        return error;
+                }
+                break;
+
+            case st_length:
+            case st_chunk_data:
+                {
+                    size_t n = (std::min)(left_, bytes - pos);
+                    Body(data + pos, n, res, on_body);
+                    pos += n;
+                    consumed = pos;
+                    left_ -= n;
+                    if (left_)
+                        return incomplete;
+                    state_ = state_ == st_length ? st_done : st_chunk_data_end;
+                }
+                break;
+
+            case st_chunk_size:
+                {
+                    const char* nl = (const char*)memchr(data + pos, '\n', bytes - pos);
+                    if (!nl)
+                        return bytes - pos > 1024 ? error : incomplete;
+                    if (!ParseChunkSize(data + pos, nl, left_))
+                        return error;
+                    pos = nl + 1 - data;
+                    consumed = pos;
+                    state_ = left_ ? st_chunk_data : st_trailer;
+                }
+                break;
+
+            case st_chunk_data_end:
+                if (bytes - pos < 2)
+                    return incomplete;
+                if (data[pos] != '\r' || data[pos + 1] != '\n')
+                    return error;
+                pos += 2;
+                consumed = pos;
+                state_ = st_chunk_size;
+                break;
+
+            case st_trailer:
+                {
+                    const char* nl = (const char*)memchr(data + pos, '\n', bytes - pos);
+                    if (!nl)
+                        return bytes - pos > HttpRequestParser::kMaxHeaderSize ? error : incomplete;
+                    bool empty_line = nl == data + pos + 1 && nl[-1] == '\r';
+                    pos = nl + 1 - data;
+                    consumed = pos;
+                    if (empty_line)
+                        state_ = st_done;
+                }
+                break;
+
+            case st_until_close:
+                Body(data + pos, bytes - pos, res, on_body);
+                consumed = bytes;
+                return incomplete;
+
+            case st_done:
+                return complete;
+            }
+        }
+    }
+
+    HttpResponseParser::result_t HttpResponseParser::OnEof()
+    {
+        if (state_ == st_until_close)
+            state_ = st_done;
+        return state_ == st_done ? complete : error;
+    }
+
+    void HttpResponseParser::Body(const char* data, size_t bytes,
+            HttpClientResponse & res, BodyCb const& on_body)
+    {
+        if (!bytes) return ;
+        if (on_body)
+            on_body(data, bytes);
+        else
+            res.body.append(data, bytes);
+    }
+
+    HttpResponseParser::result_t HttpResponseParser::ParseStatusLine(const char* data, size_t bytes,
+            HttpClientResponse & res, size_t & consumed)
+    {
+        // status-line: HTTP/1.x SP status SP reason CRLF
+        const char* end = data + bytes;
+        if (bytes < 12)
+            return incomplete;
+        if (memcmp(data, "HTTP/1.", 7) != 0 || !isdigit((unsigned char)data[7]) ||
+                data[8] != ' ' || !isdigit((unsigned char)data[9]) ||
+                !isdigit((unsigned char)data[10]) || !isdigit((unsigned char)data[11]))
+            return error;
+
+        const char* reason = data + 12;
+        if (reason < end && *reason == ' ')
+            ++reason;
+        const char* eol = HttpScan::Find(reason, end, HttpScan::cs_value);
+        if (end - eol < 2)
+            return incomplete;
+        if (eol[0] != '\r' || eol[1] != '\n' || (reason == data + 12 && eol != reason))
+            return error;
+
+        res.minor_version = data[7] - '0';
+        res.status = (data[9] - '0') * 100 + (data[10] - '0') * 10 + (data[11] - '0');
+        res.reason.assign(reason, eol);
+        res.keep_alive = res.minor_version >= 1;
+        res.headers.clear();
+
+        length_ = 0;
+        has_length_ = false;
+        has_transfer_encoding_ = false;
+        chunked_ = false;
+        state_ = st_header;
+        consumed = eol + 2 - data;
+        return complete;
+    }
+
+    HttpResponseParser::result_t HttpResponseParser::ParseHeader(const char* data, size_t bytes,
+            HttpClientResponse & res, size_t & consumed)
+    {
+        if (!bytes)
+            return incomplete;
+        if (data[0] == '\r') {
+            // 空行, 头部结束
+            if (bytes < 2)
+                return incomplete;
+            if (data[1] != '\n')
+                return error;
+            consumed = 2;
+            OnHeadEnd(res);
+            return complete;
+        }
+
+        string_view name, value;
+        const char* next;
+        result_t r = ParseHeaderLine<HttpResponseParser>(data, data + bytes, name, value, next);
+        if (r != complete)
+            return r;
+        res.headers.push_back(std::make_pair(name.to_string(), value.to_string()));
+
+        if (IEquals(name, "content-length")) {
+            if (!ParseContentLength(value, length_))
+                return error;
+            has_length_ = true;
+        } else if (IEquals(name, "transfer-encoding")) {
+            has_transfer_encoding_ = !value.empty();
+            chunked_ = IEquals(LastToken(value), "chunked");
+        } else if (IEquals(name, "connection")) {
+            if (HasToken(value, "close"))
+                res.keep_alive = false;
+            else if (HasToken(value, "keep-alive"))
+                res.keep_alive = true;
+        }
+
+        consumed = next - data;
+        return complete;
+    }
+
+    void HttpResponseParser::OnHeadEnd(HttpClientResponse & res)
+    {
+        if (res.status / 100 == 1 && res.status != 101) {
+            // 100-continue等中间应答, 继续等待最终应答
+            state_ = st_status_line;
+            return ;
+        }
+
+        if (head_request_ || res.status == 204 || res.status == 304 || res.status == 101) {
+            state_ = st_done;
+        } else if (has_transfer_encoding_ && chunked_) {
+            state_ = st_chunk_size;
+        } else if (has_length_ && !has_transfer_encoding_) {
+            left_ = length_;
+            state_ = length_ ? st_length : st_done;
+        } else {
+            // 以关闭连接为结束
+            res.keep_alive = false;
+            state_ = st_until_close;
+        }
+    }
+
+} //namespace network
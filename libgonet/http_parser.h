@@ -0,0 +1,174 @@
+#pragma once
+#include "config.h"
+#include "http_scan.h"
+#include <boost/utility/string_view.hpp>
+#include <boost/function.hpp>
+#include <vector>
+#include <string>
+
+namespace network {
+
+typedef boost::string_view string_view;
+
+struct HttpHeader
+{
+    string_view name;
+    string_view value;
+};
+
+// http请求. 除chunked编码的请求体外, 各字段都直接指向接收缓冲区,
+// 只在HttpCb回调期间有效, 需要保存时请复制.
+struct HttpRequest
+{
+    string_view method;
+    string_view target;         // 请求行中的uri, 包括query
+    string_view path;
+    string_view query;          // '?'之后的部分, 不含'?'
+    int major_version = 1;      // h2c的请求为HTTP/2.0
+    int minor_version = 1;
+    std::vector<HttpHeader> headers;
+    string_view body;
+    bool keep_alive = true;
+    bool chunked = false;
+
+    // 按名称查找头部(不区分大小写), 不存在时返回空串.
+    string_view GetHeader(string_view name) const;
+
+    // chunked编码的请求体解码后存放于此, body指向它.
+    std::string chunked_body_;
+};
+
+// 增量式http请求解析器, 每个连接一个.
+// Parse的输入是接收缓冲区中尚未消费的数据, 总是从当前请求的第一个字节开始.
+// 请求不完整时不消费数据, 已解析完的行以相对于请求起始处的偏移保存,
+// 因此接收缓冲区扩容或移动数据后仍可继续, 只有最后一个不完整的行会被重新扫描.
+// 每行只扫描一次(见HttpScan), 查找分隔符的同时校验字符集, 不复制数据.
+class HttpRequestParser
+{
+public:
+    enum result_t
+    {
+        complete,
+        incomplete,
+        error,
+    };
+
+    // 请求行加头部的长度上限
+    static const size_t kMaxHeaderSize = 64 * 1024;
+
+    // @consumed: 返回complete时为该请求的总长度(头部+请求体).
+    result_t Parse(const char* data, size_t bytes, HttpRequest & req, size_t & consumed);
+    void Reset();
+
+private:
+    struct Slice
+    {
+        uint32_t off;
+        uint32_t len;
+    };
+
+    enum chunk_state_t : uint8_t
+    {
+        cs_size,
+        cs_data,
+        cs_data_end,
+        cs_trailer,
+    };
+
+    result_t ParseHead(const char* data, size_t bytes);
+    bool OnHeader(const char* data, Slice name, Slice value);
+    result_t ParseChunked(const char* data, size_t bytes);
+    void Fill(const char* data, HttpRequest & req);
+
+private:
+    size_t line_pos_ = 0;       // 下一个待解析的行, 0表示请求行还未解析
+    size_t header_len_ = 0;     // 0表示头部还不完整
+    size_t content_length_ = 0;
+    size_t body_pos_ = 0;       // chunked: 下一个待解析的位置
+    size_t chunk_left_ = 0;
+    Slice method_ = {0, 0};
+    Slice target_ = {0, 0};
+    std::vector<std::pair<Slice, Slice>> headers_;
+    std::string body_;
+    int minor_version_ = 1;
+    bool keep_alive_ = true;
+    bool chunked_ = false;
+    bool has_length_ = false;
+    chunk_state_t chunk_state_ = cs_size;
+    Slice transfer_encoding_ = {0, 0};
+};
+
+// HttpClient收到的应答, 数据都复制出来, 不依赖接收缓冲区.
+struct HttpClientResponse
+{
+    int status = 0;
+    std::string reason;
+    int minor_version = 1;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;           // 流式接收时为空
+    bool keep_alive = true;
+
+    // 按名称查找头部(不区分大小写), 不存在时返回空串.
+    string_view GetHeader(string_view name) const;
+};
+
+// 增量式http应答解析器, HttpClient的每个连接一个.
+// 与请求解析器不同, 头部逐行复制到应答中并消费, body边收边交出,
+// 应答可以大于接收缓冲区.
+class HttpResponseParser
+{
+public:
+    enum result_t
+    {
+        complete,
+        incomplete,
+        error,
+    };
+
+    typedef boost::function<void(const char* data, size_t bytes)> BodyCb;
+
+    // 开始解析一个新的应答. @head_request: 对应的请求是HEAD, 应答没有body.
+    void Reset(bool head_request = false);
+
+    // @consumed: 本次消费的字节数, 返回incomplete时也可能消费了部分数据.
+    // @on_body: 非空时body数据通过它交出, 否则追加到res.body.
+    result_t Parse(const char* data, size_t bytes, HttpClientResponse & res,
+            size_t & consumed, BodyCb const& on_body);
+
+    // 连接关闭. 以关闭连接为结束的应答此时完成, 返回complete.
+    result_t OnEof();
+
+    // 是否已收到当前应答的任何数据
+    bool Started() const { return started_; }
+
+private:
+    result_t ParseStatusLine(const char* data, size_t bytes, HttpClientResponse & res, size_t & consumed);
+    result_t ParseHeader(const char* data, size_t bytes, HttpClientResponse & res, size_t & consumed);
+    void OnHeadEnd(HttpClientResponse & res);
+    void Body(const char* data, size_t bytes, HttpClientResponse & res, BodyCb const& on_body);
+
+    enum state_t : uint8_t
+    {
+        st_status_line,
+        st_header,
+        st_length,      // Content-Length
+        st_chunk_size,
+        st_chunk_data,
+        st_chunk_data_end,
+        st_trailer,
+        st_until_close,
+        st_done,
+    };
+
+    size_t head_size_ = 0;      // 已消费的头部长度
+    size_t left_ = 0;
+    size_t length_ = 0;
+    state_t state_ = st_status_line;
+    bool head_request_ = false;
+    bool started_ = false;
+    bool has_length_ = false;
+    bool has_transfer_encoding_ = false;
+    bool chunked_ = false;
+};
+
+} //namespace network
@@ -0,0 +1,106 @@
+#include "http_response.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace network {
+
+    static void Append(Buffer & out, const char* data, size_t bytes)
+    {
+        out.insert(out.end(), data, data + bytes);
+    }
+
+    static void Append(Buffer & out, std::string const& s)
+    {
+        Append(out, s.data(), s.size());
+    }
+
+    HttpFile::~HttpFile()
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    void HttpResponse::SetFile(int fd, off_t offset, size_t bytes)
+    {
+        file_ = boost::make_shared<HttpFile>(fd, offset, bytes);
+    }
+
+    HttpResponse& HttpResponse::SetHeader(std::string const& name, std::string const& value)
+    {
+        headers.push_back(std::make_pair(name, value));
+        return *this;
+    }
+
+    const char* HttpResponse::Reason(int status)
+    {
+        switch (status) {
+            case 100: return "Continue";
+            case 101: return "Switching Protocols";
+            case 200: return "OK";
+            case 201: return "Created";
+            case 202: return "Accepted";
+            case 204: return "No Content";
+            case 206: return "Partial Content";
+            case 301: return "Moved Permanently";
+            case 302: return "Found";
+            case 304: return "Not Modified";
+            case 307: return "Temporary Redirect";
+            case 400: return "Bad Request";
+            case 401: return "Unauthorized";
+            case 403: return "Forbidden";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 408: return "Request Timeout";
+            case 413: return "Payload Too Large";
+            case 416: return "Range Not Satisfiable";
+            case 426: return "Upgrade Required";
+            case 500: return "Internal Server Error";
+            case 501: return "Not Implemented";
+            case 502: return "Bad Gateway";
+            case 503: return "Service Unavailable";
+            case 504: return "Gateway Timeout";
+            default: return "Unknown";
+        }
+    }
+
+    void HttpResponse::SerializeHead(Buffer & out, bool keep_alive, int minor_version, bool chunked) const
+    {
+        char line[64];
+        int n = snprintf(line, sizeof(line), "HTTP/1.%d %d ", minor_version, status);
+        Append(out, line, n);
+        if (reason.empty()) {
+            const char* r = Reason(status);
+            Append(out, r, strlen(r));
+        } else {
+            Append(out, reason);
+        }
+        Append(out, "\r\n", 2);
+
+        for (auto const& kv : headers) {
+            Append(out, kv.first);
+            Append(out, ": ", 2);
+            Append(out, kv.second);
+            Append(out, "\r\n", 2);
+        }
+
+        if (chunked) {
+            static const char te[] = "Transfer-Encoding: chunked\r\n";
+            Append(out, te, sizeof(te) - 1);
+        } else if (status / 100 != 1 && status != 204 && status != 304) {
+            n = snprintf(line, sizeof(line), "Content-Length: %zu\r\n", file_ ? file_->bytes : body.size());
+            Append(out, line, n);
+        }
+
+        // HTTP/1.1默认保持连接, HTTP/1.0默认关闭
+        if (!keep_alive) {
+            static const char c[] = "Connection: close\r\n";
+            Append(out, c, sizeof(c) - 1);
+        } else if (minor_version == 0) {
+            static const char c[] = "Connection: keep-alive\r\n";
+            Append(out, c, sizeof(c) - 1);
+        }
+        Append(out, "\r\n", 2);
+    }
+
+} //namespace network
@@ -0,0 +1,66 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+#include "http_parser.h"
+
+namespace network {
+
+namespace http_detail { struct HttpConnection; }
+
+// 作为应答body的文件区间, 析构时关闭fd.
+struct HttpFile
+{
+    int fd = -1;
+    off_t offset = 0;
+    size_t bytes = 0;
+
+    HttpFile(int f, off_t off, size_t n) : fd(f), offset(off), bytes(n) {}
+    ~HttpFile();
+    HttpFile(HttpFile const&) = delete;
+    HttpFile& operator=(HttpFile const&) = delete;
+};
+
+// http应答, 在HttpCb中填写, 回调返回后由引擎序列化并按请求顺序发送.
+// Content-Length由引擎根据body生成, 不需要设置.
+struct HttpResponse
+{
+    int status = 200;
+    std::string reason;         // 为空时按status取标准描述
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    bool close = false;         // 应答发送后关闭连接
+
+    HttpResponse& SetHeader(std::string const& name, std::string const& value);
+
+    // 流式应答: 以chunked编码立即发送一块数据, 第一次调用时先发送状态行和头部.
+    // 之后body(非空时)作为最后一块, 随结束块一起发送.
+    void WriteChunk(const void* data, size_t bytes);
+
+    bool IsStreaming() const { return streaming_; }
+
+    // 直接发送预先序列化好的完整应答(状态行+头部+body), 不复制, 可以在多个连接间共享.
+    // 设置后status/headers/body不再使用, 由调用者保证它适合当前请求(HTTP版本、HEAD等).
+    void SetRaw(SharedBuffer const& raw) { raw_ = raw; }
+    SharedBuffer const& Raw() const { return raw_; }
+
+    // 以文件的[offset, offset + bytes)作为body, 通过sendfile发送, 不读入内存.
+    // fd的所有权转移给应答, 发送完成(或放弃)后关闭. 设置后body不再使用.
+    void SetFile(int fd, off_t offset, size_t bytes);
+    boost::shared_ptr<HttpFile> const& File() const { return file_; }
+
+    // status对应的标准描述
+    static const char* Reason(int status);
+
+    // 把状态行和头部写入out, chunked为false时写入Content-Length(body或文件的长度).
+    void SerializeHead(Buffer & out, bool keep_alive, int minor_version, bool chunked) const;
+
+    explicit HttpResponse(http_detail::HttpConnection* conn = nullptr) : conn_(conn) {}
+
+private:
+    http_detail::HttpConnection* conn_;
+    SharedBuffer raw_;
+    boost::shared_ptr<HttpFile> file_;
+    bool streaming_ = false;
+};
+
+} //namespace network
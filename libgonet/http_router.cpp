@@ -0,0 +1,55 @@
+#include "http_router.h"
+#include <algorithm>
+
+namespace network {
+
+    HttpRouter& HttpRouter::Route(std::string const& method, std::string const& path, HttpCb cb)
+    {
+        Entry entry;
+        entry.method = method;
+        entry.path = path;
+        entry.prefix = !path.empty() && path.back() == '/';
+        entry.cb = cb;
+        routes_.push_back(entry);
+
+        std::stable_sort(routes_.begin(), routes_.end(), [](Entry const& lhs, Entry const& rhs){
+                    if (lhs.prefix != rhs.prefix)
+                        return !lhs.prefix;
+                    return lhs.prefix && lhs.path.size() > rhs.path.size();
+                });
+        return *this;
+    }
+
+    HttpRouter& HttpRouter::NotFound(HttpCb cb)
+    {
+        not_found_ = cb;
+        return *this;
+    }
+
+    void HttpRouter::operator()(SessionRef sess, HttpRequest const& req, HttpResponse & res) const
+    {
+        bool path_matched = false;
+        for (auto const& entry : routes_) {
+            bool match = entry.prefix
+                ? req.path.substr(0, entry.path.size()) == string_view(entry.path)
+                : req.path == string_view(entry.path);
+            if (!match) continue;
+
+            if (!entry.method.empty() && req.method != string_view(entry.method)) {
+                path_matched = true;
+                continue;
+            }
+
+            entry.cb(sess, req, res);
+            return ;
+        }
+
+        if (not_found_) {
+            not_found_(sess, req, res);
+            return ;
+        }
+
+        res.status = path_matched ? 405 : 404;
+    }
+
+} //namespace network
@@ -0,0 +1,41 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+#include "http_parser.h"
+#include "http_response.h"
+
+namespace network {
+
+// 按method和path分发请求, 可直接作为HttpCb使用:
+//   HttpRouter router;
+//   router.Route("GET", "/index.html", on_index)
+//         .Route("", "/static/", on_static);
+//   server.SetHttpCb(router);
+//
+// path以'/'结尾时按前缀匹配, 否则精确匹配; 精确匹配优先, 前缀匹配取最长的.
+// method为空时匹配所有方法. 没有匹配的路由时应答404, path匹配但方法不匹配时应答405.
+class HttpRouter
+{
+public:
+    HttpRouter& Route(std::string const& method, std::string const& path, HttpCb cb);
+
+    // 设置未匹配时的处理, 默认应答404/405.
+    HttpRouter& NotFound(HttpCb cb);
+
+    void operator()(SessionRef sess, HttpRequest const& req, HttpResponse & res) const;
+
+private:
+    struct Entry
+    {
+        std::string method;
+        std::string path;
+        bool prefix;
+        HttpCb cb;
+    };
+
+    // 精确匹配在前, 前缀匹配按长度降序
+    std::vector<Entry> routes_;
+    HttpCb not_found_;
+};
+
+} //namespace network
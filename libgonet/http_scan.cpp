@@ -0,0 +1,172 @@
+#include "http_scan.h"
+#include <string.h>
+#include <atomic>
+#if defined(__x86_64__) || defined(__i386__)
+# define HTTP_SCAN_X86 1
+# include <immintrin.h>
+#else
+# define HTTP_SCAN_X86 0
+#endif
+
+namespace network {
+
+    typedef const char* (*FindFn)(const char* p, const char* end, HttpScan::charset_t cs);
+
+    static inline bool IsStop(unsigned char c, HttpScan::charset_t cs)
+    {
+        switch (cs) {
+        case HttpScan::cs_token:
+            return c <= 0x20 || c == ':' || c >= 0x7f;
+        case HttpScan::cs_target:
+            return c <= 0x20 || c == 0x7f;
+        default:
+            return (c < 0x20 && c != '\t') || c == 0x7f;
+        }
+    }
+
+    static const char* FindScalar(const char* p, const char* end, HttpScan::charset_t cs)
+    {
+        for (; p < end; ++p)
+            if (IsStop((unsigned char)*p, cs))
+                return p;
+        return end;
+    }
+
+#if HTTP_SCAN_X86
+    // pcmpestri的范围表, 每两个字节为一个闭区间, 补齐到16字节以便整体加载.
+    struct Ranges
+    {
+        char chars[16];
+        int len;
+    };
+
+    static const Ranges kRanges[] = {
+        {{0x00, 0x20, ':', ':', 0x7f, (char)0xff}, 6},  // cs_token
+        {{0x00, 0x20, 0x7f, 0x7f}, 4},                  // cs_target
+        {{0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f}, 6},      // cs_value
+    };
+
+    __attribute__((target("sse4.2")))
+    static const char* FindSse42(const char* p, const char* end, HttpScan::charset_t cs)
+    {
+        const __m128i ranges = _mm_loadu_si128((const __m128i*)kRanges[cs].chars);
+        const int ranges_len = kRanges[cs].len;
+        for (; end - p >= 16; p += 16) {
+            __m128i b = _mm_loadu_si128((const __m128i*)p);
+            int i = _mm_cmpestri(ranges, ranges_len, b, 16,
+                    _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+            if (i != 16)
+                return p + i;
+        }
+        return FindScalar(p, end, cs);
+    }
+
+    // 无符号比较: b <= x 等价于 min(b, x) == b
+    __attribute__((target("avx2")))
+    static inline __m256i LessEq(__m256i b, char x)
+    {
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(b, _mm256_set1_epi8(x)), b);
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i GreaterEq(__m256i b, char x)
+    {
+        return _mm256_cmpeq_epi8(_mm256_max_epu8(b, _mm256_set1_epi8(x)), b);
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i Equal(__m256i b, char x)
+    {
+        return _mm256_cmpeq_epi8(b, _mm256_set1_epi8(x));
+    }
+
+    __attribute__((target("avx2")))
+    static const char* FindAvx2(const char* p, const char* end, HttpScan::charset_t cs)
+    {
+        for (; end - p >= 32; p += 32) {
+            __m256i b = _mm256_loadu_si256((const __m256i*)p);
+            __m256i stop;
+            switch (cs) {
+            case HttpScan::cs_token:
+                stop = _mm256_or_si256(_mm256_or_si256(LessEq(b, 0x20), GreaterEq(b, 0x7f)), Equal(b, ':'));
+                break;
+            case HttpScan::cs_target:
+                stop = _mm256_or_si256(LessEq(b, 0x20), Equal(b, 0x7f));
+                break;
+            default:
+                stop = _mm256_or_si256(_mm256_andnot_si256(Equal(b, '\t'), LessEq(b, 0x1f)), Equal(b, 0x7f));
+                break;
+            }
+            unsigned mask = (unsigned)_mm256_movemask_epi8(stop);
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+        return FindSse42(p, end, cs);
+    }
+#endif
+
+    struct ScanImpl
+    {
+        const char* name;
+        FindFn find;
+        bool (*supported)();
+    };
+
+    static bool Always() { return true; }
+#if HTTP_SCAN_X86
+    static bool HasAvx2() { return __builtin_cpu_supports("avx2"); }
+    static bool HasSse42() { return __builtin_cpu_supports("sse4.2"); }
+#endif
+
+    // 按优先级排列
+    static const ScanImpl kImpls[] = {
+#if HTTP_SCAN_X86
+        {"avx2", &FindAvx2, &HasAvx2},
+        {"sse4.2", &FindSse42, &HasSse42},
+#endif
+        {"scalar", &FindScalar, &Always},
+    };
+
+    static std::atomic<const ScanImpl*> g_impl{nullptr};
+
+    static const ScanImpl* Detect()
+    {
+        const ScanImpl* impl = nullptr;
+        for (auto const& i : kImpls)
+            if (i.supported()) {
+                impl = &i;
+                break;
+            }
+        g_impl.store(impl, std::memory_order_relaxed);
+        return impl;
+    }
+
+    static inline const ScanImpl* Current()
+    {
+        const ScanImpl* impl = g_impl.load(std::memory_order_relaxed);
+        return impl ? impl : Detect();
+    }
+
+    const char* HttpScan::Find(const char* p, const char* end, charset_t cs)
+    {
+        return Current()->find(p, end, cs);
+    }
+
+    const char* HttpScan::Impl()
+    {
+        return Current()->name;
+    }
+
+    bool HttpScan::SetImpl(const char* name)
+    {
+        for (auto const& i : kImpls)
+            if (strcmp(i.name, name) == 0) {
+                if (!i.supported())
+                    return false;
+                g_impl.store(&i, std::memory_order_relaxed);
+                return true;
+            }
+        return false;
+    }
+
+} //namespace network
@@ -0,0 +1,28 @@
+#pragma once
+#include "config.h"
+
+namespace network {
+
+// http报文扫描: 在一段数据中查找第一个"停止字节"(分隔符、控制字符等),
+// 一次扫描同时完成查找边界和校验字符集.
+// x86上运行时按cpu选择avx2/sse4.2实现, 每次比较32/16字节, 其他平台使用逐字节实现.
+struct HttpScan
+{
+    enum charset_t
+    {
+        cs_token,       // 方法、头部名称: 停在空白、控制字符、':'和非ascii字节
+        cs_target,      // 请求uri: 停在空白和控制字符
+        cs_value,       // 头部值、原因短语: 停在除tab外的控制字符(包括CR/LF)
+    };
+
+    // 返回[p, end)中第一个停止字节的位置, 没有时返回end.
+    static const char* Find(const char* p, const char* end, charset_t cs);
+
+    // 当前使用的实现: "avx2", "sse4.2"或"scalar".
+    static const char* Impl();
+
+    // 切换实现, 用于测试和压测对比. cpu不支持时返回false, 不做切换.
+    static bool SetImpl(const char* name);
+};
+
+} //namespace network
@@ -0,0 +1,397 @@
+#include "http_static.h"
+#include <list>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <stdio.h>
+
+namespace network {
+namespace http_detail {
+
+    struct StaticEntry
+    {
+        std::string key;
+        SharedBuffer raw;           // HTTP/1.1 200应答: 头部+body
+        SharedBuffer head;          // 只有头部, 用于HEAD
+        std::string content_type;
+        std::string last_modified;
+        std::string etag;
+
+        // 用于判断文件是否变化
+        off_t size = 0;
+        int64_t mtime_ns = 0;
+        ino_t ino = 0;
+        std::atomic<uint64_t> checked_ms{0};
+
+        size_t Bytes() const { return raw->size() + head->size(); }
+    };
+
+    // 按总字节数淘汰的LRU, 各个线程共享.
+    struct StaticCache
+    {
+        typedef boost::shared_ptr<StaticEntry> EntryPtr;
+        typedef std::list<EntryPtr> Lru;
+
+        std::string root;
+        std::string prefix;
+        std::string index = "index.html";
+        size_t capacity = 64 * 1024 * 1024;
+        size_t max_file = 256 * 1024;
+        int revalidate_ms = 1000;
+
+        mutable co::LFLock mtx;
+        Lru lru;    // 最近使用的在前
+        std::unordered_map<std::string, Lru::iterator> index_map;
+        size_t bytes = 0;
+
+        EntryPtr Get(std::string const& key)
+        {
+            std::unique_lock<co::LFLock> lock(mtx);
+            auto it = index_map.find(key);
+            if (it == index_map.end())
+                return EntryPtr();
+            lru.splice(lru.begin(), lru, it->second);
+            return *it->second;
+        }
+
+        void Put(EntryPtr const& entry)
+        {
+            if (entry->Bytes() > capacity)
+                return ;
+
+            std::unique_lock<co::LFLock> lock(mtx);
+            EraseLocked(entry->key);
+            lru.push_front(entry);
+            index_map[entry->key] = lru.begin();
+            bytes += entry->Bytes();
+            while (bytes > capacity)
+                EraseLocked(lru.back()->key);
+        }
+
+        void Erase(std::string const& key)
+        {
+            std::unique_lock<co::LFLock> lock(mtx);
+            EraseLocked(key);
+        }
+
+        void EraseLocked(std::string const& key)
+        {
+            auto it = index_map.find(key);
+            if (it == index_map.end())
+                return ;
+            bytes -= (*it->second)->Bytes();
+            lru.erase(it->second);
+            index_map.erase(it);
+        }
+    };
+
+    static uint64_t NowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t MtimeNs(struct stat const& st)
+    {
+        return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    static const char* ContentType(std::string const& path)
+    {
+        static const char* types[][2] = {
+            {".html", "text/html; charset=utf-8"},
+            {".htm", "text/html; charset=utf-8"},
+            {".css", "text/css; charset=utf-8"},
+            {".js", "application/javascript; charset=utf-8"},
+            {".json", "application/json"},
+            {".txt", "text/plain; charset=utf-8"},
+            {".xml", "application/xml"},
+            {".svg", "image/svg+xml"},
+            {".png", "image/png"},
+            {".jpg", "image/jpeg"},
+            {".jpeg", "image/jpeg"},
+            {".gif", "image/gif"},
+            {".webp", "image/webp"},
+            {".ico", "image/x-icon"},
+            {".wasm", "application/wasm"},
+            {".woff", "font/woff"},
+            {".woff2", "font/woff2"},
+            {".pdf", "application/pdf"},
+            {".mp4", "video/mp4"},
+        };
+
+        size_t dot = path.rfind('.');
+        if (dot != std::string::npos && path.find('/', dot) == std::string::npos) {
+            string_view ext = string_view(path).substr(dot);
+            for (auto const& t : types)
+                if (ext.size() == strlen(t[0]) && strncasecmp(ext.data(), t[0], ext.size()) == 0)
+                    return t[1];
+        }
+        return "application/octet-stream";
+    }
+
+    static std::string HttpDate(time_t t)
+    {
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        char buf[64];
+        size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return std::string(buf, n);
+    }
+
+    static int Hex(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // 把请求path映射为相对于root的路径, 拒绝"..", 返回false时应答404.
+    static bool MapPath(string_view path, StaticCache const& cache, std::string & rel)
+    {
+        if (path.substr(0, cache.prefix.size()) != cache.prefix)
+            return false;
+        path.remove_prefix(cache.prefix.size());
+
+        std::string decoded;
+        decoded.reserve(path.size());
+        for (size_t i = 0; i < path.size(); ++i) {
+            char c = path[i];
+            if (c == '%') {
+                if (i + 2 >= path.size()) return false;
+                int hi = Hex(path[i + 1]), lo = Hex(path[i + 2]);
+                if (hi < 0 || lo < 0) return false;
+                c = (char)(hi * 16 + lo);
+                i += 2;
+            }
+            if (c == '\0') return false;
+            decoded += c;
+        }
+
+        rel.clear();
+        size_t pos = 0;
+        while (pos <= decoded.size()) {
+            size_t slash = decoded.find('/', pos);
+            if (slash == std::string::npos) slash = decoded.size();
+            string_view seg(decoded.data() + pos, slash - pos);
+            if (seg == "..")
+                return false;
+            if (!seg.empty() && seg != ".") {
+                if (!rel.empty()) rel += '/';
+                rel.append(seg.data(), seg.size());
+            }
+            pos = slash + 1;
+        }
+
+        if (decoded.empty() || decoded.back() == '/') {
+            if (!rel.empty()) rel += '/';
+            rel += cache.index;
+        }
+        return true;
+    }
+
+    static bool NotModified(HttpRequest const& req, std::string const& etag, std::string const& last_modified)
+    {
+        string_view inm = req.GetHeader("if-none-match");
+        if (!inm.empty())
+            return inm == "*" || inm.find(etag) != string_view::npos;
+        string_view ims = req.GetHeader("if-modified-since");
+        return !ims.empty() && ims == last_modified;
+    }
+
+    static void SetMetaHeaders(HttpResponse & res, std::string const& content_type,
+            std::string const& last_modified, std::string const& etag)
+    {
+        res.SetHeader("Content-Type", content_type)
+            .SetHeader("Last-Modified", last_modified)
+            .SetHeader("ETag", etag);
+    }
+
+    static void ServeEntry(StaticEntry const& e, HttpRequest const& req, HttpResponse & res)
+    {
+        if (NotModified(req, e.etag, e.last_modified)) {
+            res.status = 304;
+            SetMetaHeaders(res, e.content_type, e.last_modified, e.etag);
+            return ;
+        }
+
+        bool head = req.method == "HEAD";
+        if (req.major_version == 1 && req.minor_version == 1 && req.keep_alive) {
+            // 热路径: 直接发送预先序列化好的应答
+            res.SetRaw(head ? e.head : e.raw);
+            return ;
+        }
+
+        // HTTP/1.0、HTTP/2或要关闭连接, 头部需要按请求生成.
+        SetMetaHeaders(res, e.content_type, e.last_modified, e.etag);
+        res.body.assign(e.raw->data() + e.head->size(), e.raw->size() - e.head->size());
+    }
+
+    static bool ReadAll(int fd, char* buf, size_t bytes)
+    {
+        size_t pos = 0;
+        while (pos < bytes) {
+            ssize_t n = ::pread(fd, buf + pos, bytes - pos, pos);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            pos += n;
+        }
+        return true;
+    }
+
+} //namespace http_detail
+
+    using namespace http_detail;
+
+    HttpStatic::HttpStatic(std::string const& root, std::string const& prefix)
+        : cache_(boost::make_shared<StaticCache>())
+    {
+        cache_->root = root;
+        while (cache_->root.size() > 1 && cache_->root.back() == '/')
+            cache_->root.pop_back();
+        cache_->prefix = prefix;
+    }
+
+    HttpStatic& HttpStatic::SetCacheSize(size_t bytes)
+    {
+        cache_->capacity = bytes;
+        return *this;
+    }
+
+    HttpStatic& HttpStatic::SetMaxCachedFile(size_t bytes)
+    {
+        cache_->max_file = bytes;
+        return *this;
+    }
+
+    HttpStatic& HttpStatic::SetRevalidateInterval(int ms)
+    {
+        cache_->revalidate_ms = ms;
+        return *this;
+    }
+
+    HttpStatic& HttpStatic::SetIndex(std::string const& index)
+    {
+        cache_->index = index;
+        return *this;
+    }
+
+    size_t HttpStatic::CachedFiles() const
+    {
+        std::unique_lock<co::LFLock> lock(cache_->mtx);
+        return cache_->index_map.size();
+    }
+
+    size_t HttpStatic::CachedBytes() const
+    {
+        std::unique_lock<co::LFLock> lock(cache_->mtx);
+        return cache_->bytes;
+    }
+
+    void HttpStatic::operator()(SessionRef, HttpRequest const& req, HttpResponse & res) const
+    {
+        StaticCache & cache = *cache_;
+        if (req.method != "GET" && req.method != "HEAD") {
+            res.status = 405;
+            res.SetHeader("Allow", "GET, HEAD");
+            return ;
+        }
+
+        std::string rel;
+        if (!MapPath(req.path, cache, rel)) {
+            res.status = 404;
+            return ;
+        }
+        std::string path = cache.root + "/" + rel;
+
+        uint64_t now = NowMs();
+        StaticCache::EntryPtr entry = cache.Get(rel);
+        if (entry && now - entry->checked_ms >= (uint64_t)cache.revalidate_ms) {
+            struct stat st;
+            if (::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_size == entry->size &&
+                    MtimeNs(st) == entry->mtime_ns && st.st_ino == entry->ino) {
+                entry->checked_ms = now;
+            } else {
+                cache.Erase(rel);
+                entry.reset();
+            }
+        }
+
+        if (entry) {
+            ServeEntry(*entry, req, res);
+            return ;
+        }
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            res.status = errno == EACCES ? 403 : 404;
+            return ;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            res.status = 404;
+            return ;
+        }
+
+        std::string content_type = ContentType(rel);
+        std::string last_modified = HttpDate(st.st_mtim.tv_sec);
+        char etag[64];
+        snprintf(etag, sizeof(etag), "\"%llx-%llx\"",
+                (unsigned long long)MtimeNs(st), (unsigned long long)st.st_size);
+
+        if ((size_t)st.st_size > cache.max_file || !cache.capacity) {
+            // 大文件不缓存, 以sendfile发送.
+            if (NotModified(req, etag, last_modified)) {
+                ::close(fd);
+                res.status = 304;
+            } else {
+                res.SetFile(fd, 0, st.st_size);
+            }
+            SetMetaHeaders(res, content_type, last_modified, etag);
+            return ;
+        }
+
+        // 读入内存, 预先序列化成完整的应答放入缓存.
+        HttpResponse prebuilt;
+        SetMetaHeaders(prebuilt, content_type, last_modified, etag);
+        prebuilt.body.resize(st.st_size);
+        bool ok = ReadAll(fd, &prebuilt.body[0], st.st_size);
+        ::close(fd);
+        if (!ok) {
+            res.status = 500;
+            return ;
+        }
+
+        Buffer head;
+        prebuilt.SerializeHead(head, true, 1, false);
+        boost::shared_ptr<Buffer> raw = boost::make_shared<Buffer>();
+        raw->reserve(head.size() + prebuilt.body.size());
+        raw->insert(raw->end(), head.begin(), head.end());
+        raw->insert(raw->end(), prebuilt.body.begin(), prebuilt.body.end());
+
+        entry = boost::make_shared<StaticEntry>();
+        entry->key = rel;
+        entry->raw = raw;
+        entry->head = boost::make_shared<Buffer>(std::move(head));
+        entry->content_type = content_type;
+        entry->last_modified = last_modified;
+        entry->etag = etag;
+        entry->size = st.st_size;
+        entry->mtime_ns = MtimeNs(st);
+        entry->ino = st.st_ino;
+        entry->checked_ms = now;
+        cache.Put(entry);
+        ServeEntry(*entry, req, res);
+    }
+
+} //namespace network
@@ -0,0 +1,52 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+#include "http_parser.h"
+#include "http_response.h"
+
+namespace network {
+
+namespace http_detail { struct StaticCache; }
+
+// 静态文件服务, 可直接作为HttpCb, 或挂在HttpRouter的前缀路由下:
+//   HttpStatic files("/var/www", "/static/");
+//   router.Route("", "/static/", files);
+//
+// 小文件(不超过SetMaxCachedFile)读入内存, 连同状态行和头部预先序列化成一个SharedBuffer,
+// 放入按总大小淘汰的LRU缓存. 命中时HTTP/1.1 keep-alive的GET/HEAD请求直接发送缓存的字节,
+// 没有序列化和复制, 队列空闲时只有一次write.
+// 缓存项每隔SetRevalidateInterval检查一次文件的mtime/大小/inode, 变化时重新读取.
+// 大文件不缓存, 以sendfile发送.
+// 支持If-None-Match/If-Modified-Since(与Last-Modified完全相同时)返回304.
+//
+// 可以被复制, 副本共享同一个缓存. 读盘在处理请求的协程中进行.
+class HttpStatic
+{
+public:
+    // @root: 文件根目录
+    // @prefix: 请求path的前缀, 去掉后作为相对于root的路径.
+    explicit HttpStatic(std::string const& root, std::string const& prefix = "/");
+
+    // 缓存总大小上限(字节), 默认64MB. 0表示不缓存.
+    HttpStatic& SetCacheSize(size_t bytes);
+
+    // 超过这个大小的文件不缓存, 默认256KB.
+    HttpStatic& SetMaxCachedFile(size_t bytes);
+
+    // 缓存项重新检查文件的最小间隔(ms), 默认1000.
+    HttpStatic& SetRevalidateInterval(int ms);
+
+    // 请求以'/'结尾时使用的文件名, 默认index.html.
+    HttpStatic& SetIndex(std::string const& index);
+
+    void operator()(SessionRef sess, HttpRequest const& req, HttpResponse & res) const;
+
+    // 当前缓存的文件数和字节数(包括头部)
+    size_t CachedFiles() const;
+    size_t CachedBytes() const;
+
+private:
+    boost::shared_ptr<http_detail::StaticCache> cache_;
+};
+
+} //namespace network
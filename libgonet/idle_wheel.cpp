@@ -0,0 +1,122 @@
+#include "idle_wheel.h"
+#include <chrono>
+
+namespace network {
+
+    std::atomic<uint64_t> IdleWheel::s_now_{0};
+
+    IdleWheel::IdleWheel()
+        : tick_(SteadyNow() / kPrecision), count_(0), running_(false)
+    {
+    }
+
+    IdleWheel& IdleWheel::ThreadLocal()
+    {
+        // 时间轮的协程可能在线程退出后仍在调度中, 因此故意不释放.
+        static thread_local IdleWheel* wheel = new IdleWheel;
+        return *wheel;
+    }
+
+    uint64_t IdleWheel::SteadyNow()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t IdleWheel::Now()
+    {
+        uint64_t now = s_now_.load(std::memory_order_relaxed);
+        if (!now) {
+            now = SteadyNow();
+            s_now_.store(now, std::memory_order_relaxed);
+        }
+        return now;
+    }
+
+    void IdleWheel::Add(boost::weak_ptr<IdleObserver> const& observer, uint64_t deadline)
+    {
+        s_now_.store(SteadyNow(), std::memory_order_relaxed);
+
+        std::unique_lock<co::LFLock> lock(lock_);
+        if (!running_)
+            tick_ = (std::max)(tick_, s_now_.load(std::memory_order_relaxed) / kPrecision);
+        slots_[SlotIndex(deadline)].push_back(observer);
+        ++count_;
+        if (running_) return ;
+
+        running_ = true;
+        lock.unlock();
+        goRun();
+    }
+
+    std::size_t IdleWheel::SlotIndex(uint64_t deadline)
+    {
+        uint64_t tick = (std::max)((deadline + kPrecision - 1) / kPrecision, tick_ + 1);
+        return tick % kSlots;
+    }
+
+    std::size_t IdleWheel::Size()
+    {
+        std::unique_lock<co::LFLock> lock(lock_);
+        return count_;
+    }
+
+    void IdleWheel::goRun()
+    {
+        go_dispatch(egod_local_thread) [this]{
+            for (;;) {
+                co_sleep(kPrecision);
+                if (!Tick()) return ;
+            }
+        };
+    }
+
+    bool IdleWheel::Tick()
+    {
+        uint64_t now = SteadyNow();
+        s_now_.store(now, std::memory_order_relaxed);
+
+        uint64_t target = now / kPrecision;
+        Slot expired;
+        {
+            // 调度延迟过大时, 最多只需要完整地扫描一圈.
+            std::unique_lock<co::LFLock> lock(lock_);
+            if (target > tick_ + kSlots)
+                tick_ = target - kSlots;
+        }
+
+        for (;;)
+        {
+            {
+                std::unique_lock<co::LFLock> lock(lock_);
+                if (tick_ >= target) {
+                    if (!count_) {
+                        // 没有需要检测的对象时退出协程, 以免影响RunUntilNoTask.
+                        running_ = false;
+                        return false;
+                    }
+                    return true;
+                }
+
+                ++tick_;
+                expired.clear();
+                expired.swap(slots_[tick_ % kSlots]);
+                count_ -= expired.size();
+            }
+
+            // 回调中可能会Send或Shutdown, 不能持有锁.
+            for (auto & weak : expired) {
+                boost::shared_ptr<IdleObserver> observer = weak.lock();
+                if (!observer) continue;
+
+                uint64_t deadline = observer->OnIdleCheck(now);
+                if (!deadline) continue;
+
+                std::unique_lock<co::LFLock> lock(lock_);
+                slots_[SlotIndex(deadline)].push_back(weak);
+                ++count_;
+            }
+        }
+    }
+
+} //namespace network
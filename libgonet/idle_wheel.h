@@ -0,0 +1,55 @@
+#pragma once
+#include "config.h"
+
+namespace network {
+
+// 空闲检测对象, 由IdleWheel周期性回调.
+struct IdleObserver
+{
+    virtual ~IdleObserver() {}
+
+    // @now: 时间轮当前的粗粒度时间(ms).
+    // @returns: 下一次需要检测的时间点(ms), 返回0表示不再需要检测.
+    virtual uint64_t OnIdleCheck(uint64_t now) = 0;
+};
+
+// 粗粒度时间轮, 每个线程一个, 由一个协程驱动, 替代每个session一个定时器.
+// session活跃时只更新自己的时间戳, 不操作时间轮; 槽位到期时回调OnIdleCheck,
+// 再按返回的真实超时时间重新挂入对应槽位(lazy reschedule).
+// 因此每次读写只有一次时间戳写入, 几十万连接也只需要一个定时协程.
+class IdleWheel
+{
+public:
+    static const int kPrecision = 100;  // 每格的时间跨度(ms)
+    static const int kSlots = 512;
+
+    // 当前线程的时间轮
+    static IdleWheel& ThreadLocal();
+
+    // 粗粒度时钟(ms), 精度为kPrecision.
+    static uint64_t Now();
+
+    void Add(boost::weak_ptr<IdleObserver> const& observer, uint64_t deadline);
+
+    std::size_t Size();
+
+private:
+    IdleWheel();
+    bool Tick();
+    void goRun();
+    std::size_t SlotIndex(uint64_t deadline);
+    static uint64_t SteadyNow();
+
+private:
+    typedef std::vector<boost::weak_ptr<IdleObserver>> Slot;
+
+    co::LFLock lock_;
+    Slot slots_[kSlots];
+    uint64_t tick_;
+    std::size_t count_;
+    bool running_;
+
+    static std::atomic<uint64_t> s_now_;
+};
+
+} //namespace network
@@ -0,0 +1,287 @@
+#include "ktls.h"
+
+#if ENABLE_SSL
+#include <string.h>
+#include <netinet/tcp.h>
+#if defined(__linux__)
+# include <linux/tls.h>
+#endif
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+# include <openssl/kdf.h>
+# include <openssl/core_names.h>
+#endif
+
+#ifndef SOL_TLS
+# define SOL_TLS 282
+#endif
+
+namespace network {
+
+    // TLS1.3的流量密钥, 由keylog回调填充
+    struct KtlsSecrets
+    {
+        std::string client;
+        std::string server;
+    };
+
+    static void FreeSecrets(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+    {
+        delete static_cast<KtlsSecrets*>(ptr);
+    }
+
+    static int SecretsIndex()
+    {
+        static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, &FreeSecrets);
+        return index;
+    }
+
+    static std::string FromHex(const char* hex, std::size_t len)
+    {
+        std::string out;
+        out.reserve(len / 2);
+        for (std::size_t i = 0; i + 1 < len; i += 2) {
+            char buf[3] = { hex[i], hex[i + 1], 0 };
+            out += (char)strtol(buf, nullptr, 16);
+        }
+        return out;
+    }
+
+    // line: "<LABEL> <client_random> <secret>"
+    static void OnKeylog(const SSL* ssl, const char* line)
+    {
+        KtlsSecrets* secrets = static_cast<KtlsSecrets*>(SSL_get_ex_data(ssl, SecretsIndex()));
+        if (!secrets) return ;
+
+        const char* random = strchr(line, ' ');
+        if (!random) return ;
+        const char* secret = strchr(random + 1, ' ');
+        if (!secret) return ;
+        ++secret;
+
+        std::string label(line, random - line);
+        if (label == "CLIENT_TRAFFIC_SECRET_0")
+            secrets->client = FromHex(secret, strlen(secret));
+        else if (label == "SERVER_TRAFFIC_SECRET_0")
+            secrets->server = FromHex(secret, strlen(secret));
+    }
+
+    void Ktls::EnableOn(SSL_CTX* ctx)
+    {
+        SSL_CTX_set_keylog_callback(ctx, &OnKeylog);
+        SSL_CTX_set_num_tickets(ctx, 0);
+    }
+
+    void Ktls::Prepare(SSL* ssl)
+    {
+        SSL_set_ex_data(ssl, SecretsIndex(), new KtlsSecrets);
+    }
+
+#if defined(__linux__) && defined(TLS_TX) && OPENSSL_VERSION_NUMBER >= 0x30000000L
+    namespace {
+
+    // 一个方向的密钥
+    struct KeyMaterial
+    {
+        std::string key;
+        std::string salt;   // 隐式IV (4字节)
+        std::string iv;     // 显式nonce初值 (8字节)
+        uint64_t seq = 0;
+    };
+
+    bool Kdf(const char* name, OSSL_PARAM* params, unsigned char* out, std::size_t len)
+    {
+        EVP_KDF* kdf = EVP_KDF_fetch(nullptr, name, nullptr);
+        if (!kdf) return false;
+        EVP_KDF_CTX* kctx = EVP_KDF_CTX_new(kdf);
+        EVP_KDF_free(kdf);
+        if (!kctx) return false;
+        bool ok = EVP_KDF_derive(kctx, out, len, params) > 0;
+        EVP_KDF_CTX_free(kctx);
+        return ok;
+    }
+
+    // RFC8446 7.1 HKDF-Expand-Label(secret, label, "", len)
+    bool ExpandLabel(const EVP_MD* md, std::string const& secret, std::string const& label,
+            std::size_t len, std::string & out)
+    {
+        std::string full = "tls13 " + label;
+        std::string info;
+        info += (char)(len >> 8);
+        info += (char)(len & 0xff);
+        info += (char)full.size();
+        info += full;
+        info += (char)0;
+
+        int mode = EVP_KDF_HKDF_MODE_EXPAND_ONLY;
+        OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_int(OSSL_KDF_PARAM_MODE, &mode),
+            OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, (char*)EVP_MD_get0_name(md), 0),
+            OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_KEY, (void*)secret.data(), secret.size()),
+            OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_INFO, (void*)info.data(), info.size()),
+            OSSL_PARAM_construct_end(),
+        };
+        out.resize(len);
+        return Kdf("HKDF", params, (unsigned char*)&out[0], len);
+    }
+
+    bool Tls13Keys(SSL* ssl, const EVP_MD* md, std::size_t key_len, bool is_server,
+            KeyMaterial & tx, KeyMaterial & rx)
+    {
+        KtlsSecrets* secrets = static_cast<KtlsSecrets*>(SSL_get_ex_data(ssl, SecretsIndex()));
+        if (!secrets || secrets->client.empty() || secrets->server.empty())
+            return false;
+
+        std::string const& tx_secret = is_server ? secrets->server : secrets->client;
+        std::string const& rx_secret = is_server ? secrets->client : secrets->server;
+        std::string tx_iv, rx_iv;
+        if (!ExpandLabel(md, tx_secret, "key", key_len, tx.key) ||
+                !ExpandLabel(md, tx_secret, "iv", 12, tx_iv) ||
+                !ExpandLabel(md, rx_secret, "key", key_len, rx.key) ||
+                !ExpandLabel(md, rx_secret, "iv", 12, rx_iv))
+            return false;
+
+        tx.salt = tx_iv.substr(0, 4);
+        tx.iv = tx_iv.substr(4);
+        rx.salt = rx_iv.substr(0, 4);
+        rx.iv = rx_iv.substr(4);
+        // 握手后还未发送过应用数据记录, 也没有ticket.
+        tx.seq = rx.seq = 0;
+        return true;
+    }
+
+    // RFC5246 6.3 key_block = PRF(master, "key expansion", server_random + client_random)
+    bool Tls12Keys(SSL* ssl, const EVP_MD* md, std::size_t key_len, bool is_server,
+            KeyMaterial & tx, KeyMaterial & rx)
+    {
+        unsigned char master[SSL_MAX_MASTER_KEY_LENGTH];
+        std::size_t master_len = SSL_SESSION_get_master_key(SSL_get_session(ssl), master, sizeof(master));
+        unsigned char randoms[SSL3_RANDOM_SIZE * 2];
+        SSL_get_server_random(ssl, randoms, SSL3_RANDOM_SIZE);
+        SSL_get_client_random(ssl, randoms + SSL3_RANDOM_SIZE, SSL3_RANDOM_SIZE);
+
+        const char* label = "key expansion";
+        OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, (char*)EVP_MD_get0_name(md), 0),
+            OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SECRET, master, master_len),
+            OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SEED, (void*)label, strlen(label)),
+            OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SEED, randoms, sizeof(randoms)),
+            OSSL_PARAM_construct_end(),
+        };
+
+        // AEAD没有MAC密钥: client_key | server_key | client_iv(4) | server_iv(4)
+        std::string block(key_len * 2 + 8, '\0');
+        bool ok = Kdf("TLS1-PRF", params, (unsigned char*)&block[0], block.size());
+        OPENSSL_cleanse(master, sizeof(master));
+        if (!ok) return false;
+
+        std::string client_key = block.substr(0, key_len);
+        std::string server_key = block.substr(key_len, key_len);
+        std::string client_salt = block.substr(key_len * 2, 4);
+        std::string server_salt = block.substr(key_len * 2 + 4, 4);
+        OPENSSL_cleanse(&block[0], block.size());
+
+        tx.key = is_server ? server_key : client_key;
+        tx.salt = is_server ? server_salt : client_salt;
+        rx.key = is_server ? client_key : server_key;
+        rx.salt = is_server ? client_salt : server_salt;
+        // Finished是各自方向上的第0条加密记录
+        tx.seq = rx.seq = 1;
+        // TLS1.2的显式nonce只需不重复, 发送方向以记录序号为初值.
+        tx.iv.assign(8, '\0');
+        tx.iv[7] = 1;
+        rx.iv.assign(8, '\0');
+        return true;
+    }
+
+    template <typename Info>
+    bool SetCryptoInfo(int fd, int direction, unsigned short version, unsigned short cipher,
+            KeyMaterial const& km)
+    {
+        Info info;
+        memset(&info, 0, sizeof(info));
+        info.info.version = version;
+        info.info.cipher_type = cipher;
+        if (km.key.size() != sizeof(info.key) || km.salt.size() != sizeof(info.salt)
+                || km.iv.size() != sizeof(info.iv))
+            return false;
+
+        memcpy(info.key, km.key.data(), sizeof(info.key));
+        memcpy(info.salt, km.salt.data(), sizeof(info.salt));
+        memcpy(info.iv, km.iv.data(), sizeof(info.iv));
+        for (int i = 0; i < 8; ++i)
+            info.rec_seq[i] = (unsigned char)(km.seq >> (8 * (7 - i)));
+        bool ok = setsockopt(fd, SOL_TLS, direction, &info, sizeof(info)) == 0;
+        OPENSSL_cleanse(&info, sizeof(info));
+        return ok;
+    }
+
+    } //namespace
+
+    bool Ktls::Install(SSL* ssl, int fd, bool is_server)
+    {
+        // ssl层还有未处理的数据时, 这些数据已经不在socket上, 不能切换.
+        if (SSL_pending(ssl) > 0 || BIO_ctrl_pending(SSL_get_rbio(ssl)) > 0)
+            return false;
+
+        const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl);
+        if (!cipher) return false;
+
+        int nid = SSL_CIPHER_get_cipher_nid(cipher);
+        std::size_t key_len = 0;
+        unsigned short cipher_type = 0;
+        if (nid == NID_aes_128_gcm) {
+            key_len = 16;
+            cipher_type = TLS_CIPHER_AES_GCM_128;
+        } else if (nid == NID_aes_256_gcm) {
+            key_len = 32;
+            cipher_type = TLS_CIPHER_AES_GCM_256;
+        } else {
+            return false;
+        }
+
+        const EVP_MD* md = SSL_CIPHER_get_handshake_digest(cipher);
+        if (!md) return false;
+
+        KeyMaterial tx, rx;
+        unsigned short version = 0;
+        int ssl_version = SSL_version(ssl);
+        if (ssl_version == TLS1_3_VERSION) {
+            if (!is_server) return false;
+            version = TLS_1_3_VERSION;
+            if (!Tls13Keys(ssl, md, key_len, is_server, tx, rx))
+                return false;
+        } else if (ssl_version == TLS1_2_VERSION) {
+            version = TLS_1_2_VERSION;
+            if (!Tls12Keys(ssl, md, key_len, is_server, tx, rx))
+                return false;
+        } else {
+            return false;
+        }
+
+        // 内核未加载tls模块时失败, 此时socket未发生变化, 可以继续使用用户态ssl.
+        if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0)
+            return false;
+
+        // 设置了ULP之后任何一步失败都无法回退到用户态ssl, 直接关闭读写, 连接随后以错误结束.
+        bool ok = false;
+        if (cipher_type == TLS_CIPHER_AES_GCM_128) {
+            ok = SetCryptoInfo<tls12_crypto_info_aes_gcm_128>(fd, TLS_TX, version, cipher_type, tx)
+                && SetCryptoInfo<tls12_crypto_info_aes_gcm_128>(fd, TLS_RX, version, cipher_type, rx);
+        } else {
+            ok = SetCryptoInfo<tls12_crypto_info_aes_gcm_256>(fd, TLS_TX, version, cipher_type, tx)
+                && SetCryptoInfo<tls12_crypto_info_aes_gcm_256>(fd, TLS_RX, version, cipher_type, rx);
+        }
+
+        if (!ok)
+            ::shutdown(fd, SHUT_RDWR);
+        return ok;
+    }
+#else
+    bool Ktls::Install(SSL*, int, bool)
+    {
+        return false;
+    }
+#endif
+
+} //namespace network
+#endif
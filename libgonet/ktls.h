@@ -0,0 +1,31 @@
+#pragma once
+#include "config.h"
+
+#if ENABLE_SSL
+namespace network {
+
+// 内核TLS(kTLS)卸载.
+// asio的ssl::stream通过BIO pair收发数据, 无法使用OpenSSL内置的kTLS支持,
+// 因此在握手完成后手动导出密钥, 通过setsockopt(SOL_TLS)交给内核,
+// 此后socket上直接读写明文, 由内核完成记录层的加解密.
+//
+// 支持AES-128/256-GCM:
+//   TLS1.2: 服务端、客户端
+//   TLS1.3: 仅服务端, 且不发送会话票据(ticket会打乱记录序号).
+//           客户端在握手后还会收到服务端的ticket等握手消息, 内核无法处理, 不卸载.
+// 不满足条件(加密套件、内核不支持tls模块、ssl层还有未处理的数据等)时返回false,
+// 连接继续使用用户态的ssl.
+struct Ktls
+{
+    // 在SSL_CTX上开启: 安装keylog回调以获取TLS1.3的流量密钥, 并关闭TLS1.3的ticket.
+    static void EnableOn(SSL_CTX* ctx);
+
+    // 握手前调用, 为该连接记录密钥.
+    static void Prepare(SSL* ssl);
+
+    // 握手完成后调用, 成功时返回true.
+    static bool Install(SSL* ssl, int fd, bool is_server);
+};
+
+} //namespace network
+#endif
@@ -17,10 +17,15 @@ namespace network {
         *local_addr_ = endpoint::from_string(url, ec);
         if (ec) return ec;
 
-        if (local_addr_->proto() == proto_type::tcp || local_addr_->proto() == proto_type::ssl) {
+        if (local_addr_->proto() == proto_type::tcp || local_addr_->proto() == proto_type::ssl
+                || local_addr_->proto() == proto_type::uds) {
             protocol_ = tcp::instance();
         } else if (local_addr_->proto() == proto_type::udp) {
             protocol_ = udp::instance();
+        } else if (local_addr_->proto() == proto_type::http || local_addr_->proto() == proto_type::https) {
+            protocol_ = http::instance();
+        } else if (local_addr_->proto() == proto_type::ws || local_addr_->proto() == proto_type::wss) {
+            protocol_ = ws::instance();
         } else {
             return MakeNetworkErrorCode(eNetworkErrorCode::ec_unsupport_protocol);
         }
@@ -41,10 +46,15 @@ namespace network {
         *local_addr_ = endpoint::from_string(url, ec);
         if (ec) return ec;
 
-        if (local_addr_->proto() == proto_type::tcp || local_addr_->proto() == proto_type::ssl) {
+        if (local_addr_->proto() == proto_type::tcp || local_addr_->proto() == proto_type::ssl
+                || local_addr_->proto() == proto_type::uds) {
             protocol_ = tcp::instance();
         } else if (local_addr_->proto() == proto_type::udp) {
             protocol_ = udp::instance();
+        } else if (local_addr_->proto() == proto_type::http || local_addr_->proto() == proto_type::https) {
+            protocol_ = http::instance();
+        } else if (local_addr_->proto() == proto_type::ws || local_addr_->proto() == proto_type::wss) {
+            protocol_ = ws::instance();
         } else {
             return MakeNetworkErrorCode(eNetworkErrorCode::ec_unsupport_protocol);
         }
@@ -69,6 +79,40 @@ namespace network {
     {
         return *protocol_;
     }
+    SessionEntry Server::Lookup(SessionId id)
+    {
+        return impl_ ? impl_->Lookup(id) : SessionEntry();
+    }
+    HandshakeStats Server::GetHandshakeStats()
+    {
+        return impl_ ? impl_->GetHandshakeStats() : HandshakeStats();
+    }
+    boost_ec Server::ReloadSSL(OptionSSL const& opt)
+    {
+        if (impl_) {
+            boost_ec ec = impl_->ReloadSSL(opt);
+            if (ec) return ec;
+        }
+
+        SetSSLOption(opt);
+        return boost_ec();
+    }
+    void Server::Send(SessionId id, Buffer && buf, SndCb const& cb)
+    {
+        if (id != kInvalidSessionId && impl_ && impl_->Send(id, std::move(buf), cb))
+            return ;
+
+        if (cb)
+            cb(MakeNetworkErrorCode(eNetworkErrorCode::ec_session_not_found));
+    }
+    void Server::Send(SessionId id, const void* data, size_t bytes, SndCb const& cb)
+    {
+        if (id != kInvalidSessionId && impl_ && impl_->Send(id, data, bytes, cb))
+            return ;
+
+        if (cb)
+            cb(MakeNetworkErrorCode(eNetworkErrorCode::ec_session_not_found));
+    }
 
     Client::Client()
         : connect_mtx_(new co_mutex), remote_addr_(new endpoint)
@@ -88,10 +132,13 @@ namespace network {
         *remote_addr_ = endpoint::from_string(url, ec);
         if (ec) return ec;
 
-        if (remote_addr_->proto() == proto_type::tcp || remote_addr_->proto() == proto_type::ssl) {
+        if (remote_addr_->proto() == proto_type::tcp || remote_addr_->proto() == proto_type::ssl
+                || remote_addr_->proto() == proto_type::uds) {
             protocol_ = tcp::instance();
         } else if (remote_addr_->proto() == proto_type::udp) {
             protocol_ = udp::instance();
+        } else if (remote_addr_->proto() == proto_type::ws || remote_addr_->proto() == proto_type::wss) {
+            protocol_ = ws::instance();
         } else {
             return MakeNetworkErrorCode(eNetworkErrorCode::ec_unsupport_protocol);
         }
@@ -4,6 +4,8 @@
 #include "error.h"
 #include "tcp.h"
 #include "udp.h"
+#include "http.h"
+#include "ws.h"
 
 namespace network
 {
@@ -16,11 +18,32 @@ namespace network
         // @url:
         //    tcp://127.0.0.1:3030
         //    udp://127.0.0.1:3030
+        //    http://127.0.0.1:8080     请求交给HttpCb处理, 见http.h
+        //    https://127.0.0.1:8443
+        //    ws://127.0.0.1:8080       消息交给WsMessageCb处理, 见ws.h
+        //    wss://127.0.0.1:8443
+        //    unix:///var/run/app.sock  unix域stream socket, 收发与tcp://相同; unix://@app为抽象命名空间
+        // http(s)://和ws(s)://的接收回调由协议层占用, 这两种协议下SetReceiveCb/SetReceiveRefCb不生效.
         boost_ec goStart(std::string const& url);
         endpoint LocalAddr();
         void Shutdown(bool immediately = true);
         Protocol const& GetProtocol();
 
+        // 通过SessionId访问session, id已失效时返回空的SessionEntry,
+        // Send则以ec_session_not_found回调.
+        SessionEntry Lookup(SessionId id);
+        void Send(SessionId id, Buffer && buf, SndCb const& cb = NULL);
+        void Send(SessionId id, const void* data, size_t bytes, SndCb const& cb = NULL);
+
+        // ssl握手线程池的统计, 未开启握手线程池时全为0.
+        HandshakeStats GetHandshakeStats();
+
+        // 替换ssl证书等配置. 之后的新连接使用新的配置握手, 已建立的连接不受影响.
+        // 新配置加载失败时返回错误, 继续使用原来的配置.
+        // 新的context有独立的会话缓存和票据密钥, 之前的会话无法复用.
+        // SNI主机名的配置(SetSSLHostOptions)同时重新加载.
+        boost_ec ReloadSSL(OptionSSL const& opt);
+
         boost_ec goStartBeforeFork(std::string const& url);
         void goStartAfterFork();
 
@@ -39,6 +62,9 @@ namespace network
         // @url:
         //    tcp://127.0.0.1:3030
         //    udp://127.0.0.1:3030
+        //    ws://127.0.0.1:8080/chat  完成websocket握手后返回, 见ws.h
+        //    unix:///var/run/app.sock
+        // ws(s)://的接收回调由协议层占用, SetReceiveCb/SetReceiveRefCb不生效.
         boost_ec Connect(std::string const& url);
         void SendNoDelay(Buffer && buf, SndCb const& cb = NULL);
         void SendNoDelay(const void* data, size_t bytes, SndCb const& cb = NULL);
@@ -1,6 +1,8 @@
 #pragma once
 #include "config.h"
 #include "abstract.h"
+#include <mutex>
+#include <map>
 
 namespace network {
 
@@ -32,9 +34,29 @@ struct OptionSSL
     std::string private_key_file;
     std::string tmp_dh_file;
     std::string verify_file;
+
+    // 会话复用.
+    // 服务端: session_cache_size > 0时开启会话缓存(session id复用), 0表示关闭;
+    //         session_tickets开启TLS会话票据. 同一个Server的所有监听socket共享缓存和票据密钥.
+    // 客户端: session_resume开启时按服务端地址保存会话, 重连时复用.
+    long session_cache_size = 20480;
+    long session_timeout = 300;     // 秒
+    bool session_tickets = true;
+    bool session_resume = true;
+    std::string session_id_context = "libgonet";
+
+    // 握手后把记录层加解密交给内核(kTLS), 条件不满足时自动退回用户态ssl. 见ktls.h.
+    // 开启后服务端不再发送TLS1.3会话票据.
+    bool ktls = false;
+
+    // 客户端: 握手时通过SNI发送的主机名, 为空时不发送.
+    std::string server_name;
 #endif
 };
 
+// 服务端按SNI主机名选择的ssl配置, 见sni.h.
+typedef std::map<std::string, OptionSSL> OptionSSLHosts;
+
 // AOP @ accept before and after.
 struct OptionsAcceptAspect
 {
@@ -45,12 +67,58 @@ struct OptionsAcceptAspect
 struct OptionsUser
 {
     int listen_backlog_ = ::boost::asio::ip::tcp::socket::max_connections;
+    // >0时使用SO_REUSEPORT开启多个监听socket, 每个监听socket一个accept协程,
+    // 其上accept的连接固定在accept协程所在的线程上处理.
+    int accept_shards_ = 0;
     int sndtimeo_ = 0;
     uint32_t max_pack_size_ = 64 * 1024;
     uint32_t max_pack_size_shrink_ = 1024 * 1024;
     uint32_t max_pack_size_hard_ = 4 * 1024 * 1024;
     uint32_t max_connection_ = std::numeric_limits<uint32_t>::max();
+    // 连接数达到max_connection_时暂停accept, 新连接留在内核的积压队列中;
+    // 否则accept后立即关闭.
+    bool accept_pause_on_full_ = false;
+
+    // >0时ssl握手在独立的握手线程池中执行, 不占用协程工作线程.
+    // handshake_queue_limit_: 排队数上限, 超过时直接关闭新连接.
+    // handshake_timeout_: 握手超时(ms), <=0表示不限制.
+    int handshake_threads_ = 0;
+    uint32_t handshake_queue_limit_ = 1024;
+    int handshake_timeout_ = 10000;
+
+    // HttpClient:
+    // http_max_conns_per_host_: 每个host(协议+地址+端口)的连接数上限.
+    // http_max_pipeline_: 每个连接上已发出未应答的请求数上限, 1表示不使用pipelining.
+    // http_request_timeout_: 请求超时(ms), <=0表示不限制. 超时的请求所在的连接会被关闭.
+    // http_keepalive_timeout_: 连接空闲超过此时间(ms)后不再复用.
+    int http_max_conns_per_host_ = 8;
+    int http_max_pipeline_ = 1;
+    int http_request_timeout_ = 30000;
+    int http_keepalive_timeout_ = 60000;
+
+    // HttpServer的h2c(明文HTTP/2, prior knowledge): 开启后以HTTP/2连接前言开头的http://连接按HTTP/2处理.
+    // http2_max_concurrent_streams_: 每个连接上同时打开的流数上限.
+    // http2_window_size_: 接收方向的连接级和流级流控窗口.
+    bool http2_ = false;
+    uint32_t http2_max_concurrent_streams_ = 100;
+    uint32_t http2_window_size_ = 1024 * 1024;
+
+    // websocket: 一条消息(合并分片后)的大小上限, 超过时以1009关闭连接.
+    size_t ws_max_message_size_ = 16 * 1024 * 1024;
+
+    // 空闲检测(ms), 0表示不检测. 精度为IdleWheel::kPrecision.
+    // read_idle: 超时未收到数据时关闭连接(ec_recv_timeout).
+    // write_idle: 超时未发送数据时, 设置了心跳回调则发送心跳包, 否则关闭连接(ec_send_timeout).
+    // all_idle: 超时既未收到也未发送数据时关闭连接(ec_recv_timeout).
+    int read_idle_timeout_ = 0;
+    int write_idle_timeout_ = 0;
+    int all_idle_timeout_ = 0;
+
+    // true时发送协程只在发送队列非空时存在, 队列发送完毕即退出.
+    // 空闲连接只保留接收协程, 适合大量长连接、请求应答式的场景.
+    bool send_on_demand_ = false;
     OptionSSL ssl_option_;
+    OptionSSLHosts ssl_host_options_;
     OptionsAcceptAspect accept_aspect_;
 };
 
@@ -58,7 +126,12 @@ struct OptionsData : public OptionsUser
 {
     ConnectedCb connect_cb_;
     ReceiveCb receive_cb_;
+    ReceiveRefCb receive_ref_cb_;
     DisconnectedCb disconnect_cb_;
+    HeartbeatCb heartbeat_cb_;
+    HttpCb http_cb_;
+    WsMessageCb ws_message_cb_;
+    WsHandshakeCb ws_handshake_cb_;
 
     static OptionsData& DefaultOption()
     {
@@ -73,6 +146,12 @@ struct OptionsBase
     std::vector<OptionsBase*> lnks_;
     OptionsBase* parent_ = nullptr;
 
+    // 配置版本号, 每次修改配置时递增, 用于判断快照是否过期.
+    co::atomic_t<uint64_t> version_{1};
+    uint64_t snapshot_version_ = 0;
+    boost::shared_ptr<const OptionsData> snapshot_;
+    co::LFLock snapshot_mtx_;
+
     virtual ~OptionsBase()
     {
         if (parent_)
@@ -85,6 +164,7 @@ struct OptionsBase
     void Link(OptionsBase & other)
     {
         other.opt_ = this->opt_;
+        ++other.version_;
         lnks_.push_back(&other);
         assert(nullptr == other.parent_);
         other.parent_ = this;
@@ -100,10 +180,24 @@ struct OptionsBase
             lnks_.erase(it);
     }
 
+    // 当前配置的只读快照.
+    // 配置未修改时所有调用者共享同一份数据, 修改后在下一次调用时重建.
+    boost::shared_ptr<const OptionsData> GetSnapshot()
+    {
+        std::unique_lock<co::LFLock> lock(snapshot_mtx_);
+        uint64_t version = version_;
+        if (!snapshot_ || snapshot_version_ != version) {
+            snapshot_ = boost::make_shared<const OptionsData>(opt_);
+            snapshot_version_ = version;
+        }
+        return snapshot_;
+    }
+
     void OnLink()
     {
         for (auto o:lnks_) {
             o->opt_ = this->opt_;
+            ++o->version_;
             o->OnLink();
         }
     }
@@ -111,6 +205,7 @@ struct OptionsBase
     void SetConnectedCb(ConnectedCb cb)
     {
         opt_.connect_cb_ = cb;
+        ++version_;
         OnSetConnectedCb();
         for (auto o:lnks_)
             o->SetConnectedCb(cb);
@@ -118,34 +213,95 @@ struct OptionsBase
     void SetReceiveCb(ReceiveCb cb)
     {
         opt_.receive_cb_ = cb;
+        ++version_;
         OnSetReceiveCb();
         for (auto o:lnks_)
             o->SetReceiveCb(cb);
     }
+    void SetReceiveRefCb(ReceiveRefCb cb)
+    {
+        opt_.receive_ref_cb_ = cb;
+        ++version_;
+        OnSetReceiveRefCb();
+        for (auto o:lnks_)
+            o->SetReceiveRefCb(cb);
+    }
     void SetDisconnectedCb(DisconnectedCb cb)
     {
         opt_.disconnect_cb_ = cb;
+        ++version_;
         OnSetDisconnectedCb();
         for (auto o:lnks_)
             o->SetDisconnectedCb(cb);
     }
+    void SetHeartbeatCb(HeartbeatCb cb)
+    {
+        opt_.heartbeat_cb_ = cb;
+        ++version_;
+        OnSetHeartbeatCb();
+        for (auto o:lnks_)
+            o->SetHeartbeatCb(cb);
+    }
+    void SetHttpCb(HttpCb cb)
+    {
+        opt_.http_cb_ = cb;
+        ++version_;
+        OnSetHttpCb();
+        for (auto o:lnks_)
+            o->SetHttpCb(cb);
+    }
+    void SetWsMessageCb(WsMessageCb cb)
+    {
+        opt_.ws_message_cb_ = cb;
+        ++version_;
+        OnSetWsMessageCb();
+        for (auto o:lnks_)
+            o->SetWsMessageCb(cb);
+    }
+    void SetWsHandshakeCb(WsHandshakeCb cb)
+    {
+        opt_.ws_handshake_cb_ = cb;
+        ++version_;
+        OnSetWsHandshakeCb();
+        for (auto o:lnks_)
+            o->SetWsHandshakeCb(cb);
+    }
     void SetListenBacklog(int listen_backlog)
     {
         opt_.listen_backlog_ = listen_backlog;
+        ++version_;
         OnSetListenBacklog();
         for (auto o:lnks_)
             o->SetListenBacklog(listen_backlog);
     }
+    void SetAcceptShards(int accept_shards)
+    {
+        opt_.accept_shards_ = accept_shards;
+        ++version_;
+        OnSetAcceptShards();
+        for (auto o:lnks_)
+            o->SetAcceptShards(accept_shards);
+    }
     void SetSndTimeout(int sndtimeo)
     {
         opt_.sndtimeo_ = sndtimeo;
+        ++version_;
         OnSetSndTimeout();
         for (auto o:lnks_)
             o->SetSndTimeout(sndtimeo);
     }
+    void SetSendOnDemand(bool send_on_demand)
+    {
+        opt_.send_on_demand_ = send_on_demand;
+        ++version_;
+        OnSetSendOnDemand();
+        for (auto o:lnks_)
+            o->SetSendOnDemand(send_on_demand);
+    }
     void SetMaxPackSize(uint32_t max_pack_size)
     {
         opt_.max_pack_size_ = max_pack_size;
+        ++version_;
         OnSetMaxPackSize();
         for (auto o:lnks_)
             o->SetMaxPackSize(max_pack_size);
@@ -153,6 +309,7 @@ struct OptionsBase
     void SetMaxPackSizeShrink(uint32_t max_pack_size_shrink)
     {
         opt_.max_pack_size_shrink_ = max_pack_size_shrink;
+        ++version_;
         OnSetMaxPackSizeShrink();
         for (auto o:lnks_)
             o->SetMaxPackSizeShrink(max_pack_size_shrink);
@@ -160,6 +317,7 @@ struct OptionsBase
     void SetMaxPackSizeHard(uint32_t max_pack_size_hard)
     {
         opt_.max_pack_size_hard_ = max_pack_size_hard;
+        ++version_;
         OnSetMaxPackSizeHard();
         for (auto o:lnks_)
             o->SetMaxPackSizeHard(max_pack_size_hard);
@@ -167,34 +325,188 @@ struct OptionsBase
     void SetMaxConnection(uint32_t max_connection)
     {
         opt_.max_connection_ = max_connection;
+        ++version_;
         OnSetMaxConnection();
         for (auto o:lnks_)
             o->SetMaxConnection(max_connection);
     }
+    void SetAcceptPauseOnFull(bool accept_pause_on_full)
+    {
+        opt_.accept_pause_on_full_ = accept_pause_on_full;
+        ++version_;
+        OnSetAcceptPauseOnFull();
+        for (auto o:lnks_)
+            o->SetAcceptPauseOnFull(accept_pause_on_full);
+    }
+    void SetHandshakeThreads(int handshake_threads)
+    {
+        opt_.handshake_threads_ = handshake_threads;
+        ++version_;
+        OnSetHandshakeThreads();
+        for (auto o:lnks_)
+            o->SetHandshakeThreads(handshake_threads);
+    }
+    void SetHandshakeQueueLimit(uint32_t handshake_queue_limit)
+    {
+        opt_.handshake_queue_limit_ = handshake_queue_limit;
+        ++version_;
+        OnSetHandshakeQueueLimit();
+        for (auto o:lnks_)
+            o->SetHandshakeQueueLimit(handshake_queue_limit);
+    }
+    void SetHandshakeTimeout(int handshake_timeout)
+    {
+        opt_.handshake_timeout_ = handshake_timeout;
+        ++version_;
+        OnSetHandshakeTimeout();
+        for (auto o:lnks_)
+            o->SetHandshakeTimeout(handshake_timeout);
+    }
+    void SetHttpMaxConnsPerHost(int max_conns)
+    {
+        opt_.http_max_conns_per_host_ = max_conns;
+        ++version_;
+        OnSetHttpMaxConnsPerHost();
+        for (auto o:lnks_)
+            o->SetHttpMaxConnsPerHost(max_conns);
+    }
+    void SetHttpMaxPipeline(int max_pipeline)
+    {
+        opt_.http_max_pipeline_ = max_pipeline;
+        ++version_;
+        OnSetHttpMaxPipeline();
+        for (auto o:lnks_)
+            o->SetHttpMaxPipeline(max_pipeline);
+    }
+    void SetHttpRequestTimeout(int timeout)
+    {
+        opt_.http_request_timeout_ = timeout;
+        ++version_;
+        OnSetHttpRequestTimeout();
+        for (auto o:lnks_)
+            o->SetHttpRequestTimeout(timeout);
+    }
+    void SetHttpKeepAliveTimeout(int timeout)
+    {
+        opt_.http_keepalive_timeout_ = timeout;
+        ++version_;
+        OnSetHttpKeepAliveTimeout();
+        for (auto o:lnks_)
+            o->SetHttpKeepAliveTimeout(timeout);
+    }
+    void SetHttp2(bool enable)
+    {
+        opt_.http2_ = enable;
+        ++version_;
+        OnSetHttp2();
+        for (auto o:lnks_)
+            o->SetHttp2(enable);
+    }
+    void SetHttp2MaxConcurrentStreams(uint32_t streams)
+    {
+        opt_.http2_max_concurrent_streams_ = streams;
+        ++version_;
+        OnSetHttp2MaxConcurrentStreams();
+        for (auto o:lnks_)
+            o->SetHttp2MaxConcurrentStreams(streams);
+    }
+    void SetHttp2WindowSize(uint32_t size)
+    {
+        opt_.http2_window_size_ = size;
+        ++version_;
+        OnSetHttp2WindowSize();
+        for (auto o:lnks_)
+            o->SetHttp2WindowSize(size);
+    }
+    void SetWsMaxMessageSize(size_t size)
+    {
+        opt_.ws_max_message_size_ = size;
+        ++version_;
+        OnSetWsMaxMessageSize();
+        for (auto o:lnks_)
+            o->SetWsMaxMessageSize(size);
+    }
+    void SetReadIdleTimeout(int read_idle_timeout)
+    {
+        opt_.read_idle_timeout_ = read_idle_timeout;
+        ++version_;
+        OnSetReadIdleTimeout();
+        for (auto o:lnks_)
+            o->SetReadIdleTimeout(read_idle_timeout);
+    }
+    void SetWriteIdleTimeout(int write_idle_timeout)
+    {
+        opt_.write_idle_timeout_ = write_idle_timeout;
+        ++version_;
+        OnSetWriteIdleTimeout();
+        for (auto o:lnks_)
+            o->SetWriteIdleTimeout(write_idle_timeout);
+    }
+    void SetAllIdleTimeout(int all_idle_timeout)
+    {
+        opt_.all_idle_timeout_ = all_idle_timeout;
+        ++version_;
+        OnSetAllIdleTimeout();
+        for (auto o:lnks_)
+            o->SetAllIdleTimeout(all_idle_timeout);
+    }
     void SetSSLOption(OptionSSL const& opt)
     {
         opt_.ssl_option_ = opt;
+        ++version_;
         OnSetSSLOption();
         for (auto o:lnks_)
             o->SetSSLOption(opt);
     }
+    void SetSSLHostOptions(OptionSSLHosts const& opts)
+    {
+        opt_.ssl_host_options_ = opts;
+        ++version_;
+        OnSetSSLHostOptions();
+        for (auto o:lnks_)
+            o->SetSSLHostOptions(opts);
+    }
     void SetAcceptAspect(OptionsAcceptAspect const& accept_aspect)
     {
         opt_.accept_aspect_ = accept_aspect;
+        ++version_;
         OnSetAcceptAspect();
         for (auto o:lnks_)
             o->SetAcceptAspect(accept_aspect);
     }
     virtual void OnSetConnectedCb() {}
     virtual void OnSetReceiveCb() {}
+    virtual void OnSetReceiveRefCb() {}
     virtual void OnSetDisconnectedCb() {}
+    virtual void OnSetHeartbeatCb() {}
+    virtual void OnSetHttpCb() {}
+    virtual void OnSetWsMessageCb() {}
+    virtual void OnSetWsHandshakeCb() {}
     virtual void OnSetListenBacklog() {}
+    virtual void OnSetAcceptShards() {}
     virtual void OnSetSndTimeout() {}
+    virtual void OnSetSendOnDemand() {}
     virtual void OnSetMaxPackSize() {}
     virtual void OnSetMaxPackSizeHard() {}
     virtual void OnSetMaxPackSizeShrink() {}
     virtual void OnSetMaxConnection() {}
+    virtual void OnSetAcceptPauseOnFull() {}
+    virtual void OnSetHandshakeThreads() {}
+    virtual void OnSetHandshakeQueueLimit() {}
+    virtual void OnSetHandshakeTimeout() {}
+    virtual void OnSetHttpMaxConnsPerHost() {}
+    virtual void OnSetHttpMaxPipeline() {}
+    virtual void OnSetHttpRequestTimeout() {}
+    virtual void OnSetHttpKeepAliveTimeout() {}
+    virtual void OnSetHttp2() {}
+    virtual void OnSetHttp2MaxConcurrentStreams() {}
+    virtual void OnSetHttp2WindowSize() {}
+    virtual void OnSetWsMaxMessageSize() {}
+    virtual void OnSetReadIdleTimeout() {}
+    virtual void OnSetWriteIdleTimeout() {}
+    virtual void OnSetAllIdleTimeout() {}
     virtual void OnSetSSLOption() {}
+    virtual void OnSetSSLHostOptions() {}
     virtual void OnSetAcceptAspect() {}
 };
 
@@ -216,21 +528,56 @@ struct Options : public OptionsBase
         OptionsBase::SetReceiveCb(cb);
         return GetThisDrived();
     }
+    Drived& SetReceiveRefCb(ReceiveRefCb cb)
+    {
+        OptionsBase::SetReceiveRefCb(cb);
+        return GetThisDrived();
+    }
     Drived& SetDisconnectedCb(DisconnectedCb cb)
     {
         OptionsBase::SetDisconnectedCb(cb);
         return GetThisDrived();
     }
+    Drived& SetHeartbeatCb(HeartbeatCb cb)
+    {
+        OptionsBase::SetHeartbeatCb(cb);
+        return GetThisDrived();
+    }
+    Drived& SetHttpCb(HttpCb cb)
+    {
+        OptionsBase::SetHttpCb(cb);
+        return GetThisDrived();
+    }
+    Drived& SetWsMessageCb(WsMessageCb cb)
+    {
+        OptionsBase::SetWsMessageCb(cb);
+        return GetThisDrived();
+    }
+    Drived& SetWsHandshakeCb(WsHandshakeCb cb)
+    {
+        OptionsBase::SetWsHandshakeCb(cb);
+        return GetThisDrived();
+    }
     Drived& SetListenBacklog(int listen_backlog)
     {
         OptionsBase::SetListenBacklog(listen_backlog);
         return GetThisDrived();
     }
+    Drived& SetAcceptShards(int accept_shards)
+    {
+        OptionsBase::SetAcceptShards(accept_shards);
+        return GetThisDrived();
+    }
     Drived& SetSndTimeout(int sndtimeo)
     {
         OptionsBase::SetSndTimeout(sndtimeo);
         return GetThisDrived();
     }
+    Drived& SetSendOnDemand(bool send_on_demand)
+    {
+        OptionsBase::SetSendOnDemand(send_on_demand);
+        return GetThisDrived();
+    }
     Drived& SetMaxPackSize(uint32_t max_pack_size)
     {
         OptionsBase::SetMaxPackSize(max_pack_size);
@@ -251,11 +598,91 @@ struct Options : public OptionsBase
         OptionsBase::SetMaxConnection(max_connection);
         return GetThisDrived();
     }
+    Drived& SetAcceptPauseOnFull(bool accept_pause_on_full)
+    {
+        OptionsBase::SetAcceptPauseOnFull(accept_pause_on_full);
+        return GetThisDrived();
+    }
+    Drived& SetHandshakeThreads(int handshake_threads)
+    {
+        OptionsBase::SetHandshakeThreads(handshake_threads);
+        return GetThisDrived();
+    }
+    Drived& SetHandshakeQueueLimit(uint32_t handshake_queue_limit)
+    {
+        OptionsBase::SetHandshakeQueueLimit(handshake_queue_limit);
+        return GetThisDrived();
+    }
+    Drived& SetHandshakeTimeout(int handshake_timeout)
+    {
+        OptionsBase::SetHandshakeTimeout(handshake_timeout);
+        return GetThisDrived();
+    }
+    Drived& SetHttpMaxConnsPerHost(int max_conns)
+    {
+        OptionsBase::SetHttpMaxConnsPerHost(max_conns);
+        return GetThisDrived();
+    }
+    Drived& SetHttpMaxPipeline(int max_pipeline)
+    {
+        OptionsBase::SetHttpMaxPipeline(max_pipeline);
+        return GetThisDrived();
+    }
+    Drived& SetHttpRequestTimeout(int timeout)
+    {
+        OptionsBase::SetHttpRequestTimeout(timeout);
+        return GetThisDrived();
+    }
+    Drived& SetHttpKeepAliveTimeout(int timeout)
+    {
+        OptionsBase::SetHttpKeepAliveTimeout(timeout);
+        return GetThisDrived();
+    }
+    Drived& SetHttp2(bool enable)
+    {
+        OptionsBase::SetHttp2(enable);
+        return GetThisDrived();
+    }
+    Drived& SetHttp2MaxConcurrentStreams(uint32_t streams)
+    {
+        OptionsBase::SetHttp2MaxConcurrentStreams(streams);
+        return GetThisDrived();
+    }
+    Drived& SetHttp2WindowSize(uint32_t size)
+    {
+        OptionsBase::SetHttp2WindowSize(size);
+        return GetThisDrived();
+    }
+    Drived& SetWsMaxMessageSize(size_t size)
+    {
+        OptionsBase::SetWsMaxMessageSize(size);
+        return GetThisDrived();
+    }
+    Drived& SetReadIdleTimeout(int read_idle_timeout)
+    {
+        OptionsBase::SetReadIdleTimeout(read_idle_timeout);
+        return GetThisDrived();
+    }
+    Drived& SetWriteIdleTimeout(int write_idle_timeout)
+    {
+        OptionsBase::SetWriteIdleTimeout(write_idle_timeout);
+        return GetThisDrived();
+    }
+    Drived& SetAllIdleTimeout(int all_idle_timeout)
+    {
+        OptionsBase::SetAllIdleTimeout(all_idle_timeout);
+        return GetThisDrived();
+    }
     Drived& SetSSLOption(OptionSSL const& opt)
     {
         OptionsBase::SetSSLOption(opt);
         return GetThisDrived();
     }
+    Drived& SetSSLHostOptions(OptionSSLHosts const& opts)
+    {
+        OptionsBase::SetSSLHostOptions(opts);
+        return GetThisDrived();
+    }
     Drived& SetAcceptAspect(OptionsAcceptAspect const& accept_aspect)
     {
         OptionsBase::SetAcceptAspect(accept_aspect);
@@ -0,0 +1,140 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+
+namespace network {
+
+// 分片的session表.
+// 每个分片一把LFLock和一个slab(数组 + 空闲链表), 插入和删除都是O(1);
+// 线程首次使用时绑定一个分片, 不同线程之间基本没有锁竞争. Size()无锁.
+//
+// Insert返回64位的SessionId: 高32位是槽位的代数, 低32位是槽位索引(低位是分片号).
+// 槽位每次释放时代数加一, 因此已经失效的id查找时直接失败, 不会访问到已释放的session.
+template <typename T>
+class SessionRegistry
+{
+public:
+    typedef boost::shared_ptr<T> value_type;
+
+    static const uint32_t kShards = 16;
+
+    SessionRegistry() {}
+    SessionRegistry(SessionRegistry const&) = delete;
+    SessionRegistry& operator=(SessionRegistry const&) = delete;
+
+    SessionId Insert(value_type const& value)
+    {
+        uint32_t shard_index = ThreadShard();
+        Shard & shard = shards_[shard_index];
+        std::unique_lock<co::LFLock> lock(shard.lock);
+        uint32_t slot;
+        if (shard.free.empty()) {
+            slot = (uint32_t)shard.slots.size();
+            shard.slots.push_back(Slot());
+        } else {
+            slot = shard.free.back();
+            shard.free.pop_back();
+        }
+        shard.slots[slot].value = value;
+        ++size_;
+        return MakeId(shard.slots[slot].generation, slot * kShards + shard_index);
+    }
+
+    bool Erase(SessionId id)
+    {
+        value_type removed;     // 在锁外析构
+        Shard & shard = shards_[Index(id) % kShards];
+        std::unique_lock<co::LFLock> lock(shard.lock);
+        Slot* slot = Find(shard, id);
+        if (!slot) return false;
+
+        removed.swap(slot->value);
+        if (++slot->generation == 0)
+            slot->generation = 1;
+        shard.free.push_back(Index(id) / kShards);
+        --size_;
+        return true;
+    }
+
+    value_type Lookup(SessionId id)
+    {
+        Shard & shard = shards_[Index(id) % kShards];
+        std::unique_lock<co::LFLock> lock(shard.lock);
+        Slot* slot = Find(shard, id);
+        return slot ? slot->value : value_type();
+    }
+
+    std::size_t Size() const
+    {
+        return size_;
+    }
+
+    // 逐个分片复制出来后在锁外回调, 回调中可以Erase.
+    template <typename F>
+    void ForEach(F const& f)
+    {
+        std::vector<value_type> values;
+        for (auto & shard : shards_) {
+            values.clear();
+            {
+                std::unique_lock<co::LFLock> lock(shard.lock);
+                for (auto & slot : shard.slots)
+                    if (slot.value) values.push_back(slot.value);
+            }
+
+            for (auto & v : values)
+                f(v);
+        }
+    }
+
+private:
+    struct Slot
+    {
+        value_type value;
+        uint32_t generation = 1;
+    };
+
+    struct Shard
+    {
+        co::LFLock lock;
+        std::vector<Slot> slots;
+        std::vector<uint32_t> free;
+        char pad_[64];  // 避免相邻分片的锁伪共享
+    };
+
+    static SessionId MakeId(uint32_t generation, uint32_t index)
+    {
+        return ((SessionId)generation << 32) | index;
+    }
+
+    static uint32_t Index(SessionId id)
+    {
+        return (uint32_t)id;
+    }
+
+    static uint32_t Generation(SessionId id)
+    {
+        return (uint32_t)(id >> 32);
+    }
+
+    static Slot* Find(Shard & shard, SessionId id)
+    {
+        uint32_t slot = Index(id) / kShards;
+        if (slot >= shard.slots.size()) return nullptr;
+        Slot & s = shard.slots[slot];
+        if (s.generation != Generation(id) || !s.value) return nullptr;
+        return &s;
+    }
+
+    static uint32_t ThreadShard()
+    {
+        static std::atomic<uint32_t> s_next{0};
+        static thread_local uint32_t shard = s_next++ % kShards;
+        return shard;
+    }
+
+    Shard shards_[kShards];
+    co::atomic_t<std::size_t> size_{0};
+};
+
+} //namespace network
@@ -0,0 +1,88 @@
+#include "sni.h"
+
+#if ENABLE_SSL
+#include <ctype.h>
+
+namespace network {
+
+    struct SniTable
+    {
+        tcp_context default_ctx;
+        std::map<std::string, tcp_context> hosts;   // 小写主机名 -> context
+
+        SSL_CTX* Find(std::string const& name) const
+        {
+            auto it = hosts.find(name);
+            if (it != hosts.end())
+                return it->second->native_handle();
+
+            // www.example.com -> *.example.com
+            std::size_t pos = name.find('.');
+            if (pos == std::string::npos)
+                return nullptr;
+            it = hosts.find("*" + name.substr(pos));
+            return it != hosts.end() ? it->second->native_handle() : nullptr;
+        }
+    };
+
+    static std::string ToLower(std::string s)
+    {
+        for (char & c : s)
+            c = (char)tolower((unsigned char)c);
+        return s;
+    }
+
+    static int OnServerName(SSL* ssl, int*, void* arg)
+    {
+        const char* name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+        if (!name)
+            return SSL_TLSEXT_ERR_NOACK;
+
+        SSL_CTX* ctx = static_cast<SniTable*>(arg)->Find(ToLower(name));
+        if (!ctx)
+            return SSL_TLSEXT_ERR_NOACK;    // use default certificate
+
+        if (ctx != SSL_get_SSL_CTX(ssl))
+            SSL_set_SSL_CTX(ssl, ctx);
+        return SSL_TLSEXT_ERR_OK;
+    }
+
+    tcp_context SslSni::CreateContext(OptionSSL const& def, OptionSSLHosts const& hosts)
+    {
+        if (hosts.empty())
+            return tcp_socket::create_tcp_context(def);
+
+        std::shared_ptr<SniTable> table = std::make_shared<SniTable>();
+        table->default_ctx = tcp_socket::create_tcp_context(def);
+
+        // 配置相同的主机名共用一个context, 证书只加载一次.
+        // 设置了pwd_callback的配置无法比较, 单独创建.
+        std::map<std::string, tcp_context> loaded;
+        if (!def.pwd_callback)
+            loaded[tcp_socket::context_key(def)] = table->default_ctx;
+        for (auto const& kv : hosts) {
+            OptionSSL opt = kv.second;
+            opt.ktls = def.ktls;
+
+            tcp_context ctx;
+            if (opt.pwd_callback) {
+                ctx = tcp_socket::create_tcp_context(opt);
+            } else {
+                tcp_context & slot = loaded[tcp_socket::context_key(opt)];
+                if (!slot)
+                    slot = tcp_socket::create_tcp_context(opt);
+                ctx = slot;
+            }
+            table->hosts[ToLower(kv.first)] = ctx;
+        }
+
+        SSL_CTX* native = table->default_ctx->native_handle();
+        SSL_CTX_set_tlsext_servername_callback(native, &OnServerName);
+        SSL_CTX_set_tlsext_servername_arg(native, table.get());
+
+        // 与table共享引用计数, 使用默认context的连接都存在时table不会析构.
+        return tcp_context(table, table->default_ctx.get());
+    }
+
+} //namespace network
+#endif
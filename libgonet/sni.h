@@ -0,0 +1,24 @@
+#pragma once
+#include "config.h"
+#include "tcp_socket.h"
+
+#if ENABLE_SSL
+namespace network {
+
+// 按SNI(Server Name Indication)选择证书, 一个监听端口服务多个主机名.
+// 默认配置创建监听用的ssl::context, 每个主机名的配置各创建一个ssl::context(配置相同的主机名共用一个),
+// 握手时在servername回调中按客户端请求的主机名切换到对应的context.
+//
+// 主机名不区分大小写, 支持"*.example.com"形式的通配符(只匹配一级);
+// 客户端未发送SNI或未匹配时使用默认配置.
+// 切换context只替换证书链和私钥, 校验方式、会话缓存和票据密钥仍使用默认配置的context,
+// kTLS开关也以默认配置为准.
+struct SslSni
+{
+    // hosts为空时等同于tcp_socket::create_tcp_context.
+    // 返回的context同时持有所有主机名的context; 加载失败时抛出system_error.
+    static tcp_context CreateContext(OptionSSL const& def, OptionSSLHosts const& hosts);
+};
+
+} //namespace network
+#endif
@@ -0,0 +1,94 @@
+#include "ssl_session.h"
+
+#if ENABLE_SSL
+namespace network {
+
+    SslSessionStore& SslSessionStore::Instance()
+    {
+        static SslSessionStore obj;
+        return obj;
+    }
+
+    SslSessionStore::~SslSessionStore()
+    {
+        for (auto & kv : sessions_)
+            SSL_SESSION_free(kv.second);
+    }
+
+    static void FreeKey(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+    {
+        delete static_cast<std::string*>(ptr);
+    }
+
+    int SslSessionStore::KeyIndex()
+    {
+        static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, &FreeKey);
+        return index;
+    }
+
+    void SslSessionStore::EnableOn(SSL_CTX* ctx)
+    {
+        // context在Client之间共享, 只需设置一次.
+        if (SSL_CTX_sess_get_new_cb(ctx) == &SslSessionStore::OnNewSession)
+            return ;
+
+        // 只使用外部缓存, 会话由new_session回调交给SslSessionStore管理.
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx, &SslSessionStore::OnNewSession);
+    }
+
+    void SslSessionStore::Attach(SSL* ssl, std::string const& key)
+    {
+        SSL_set_ex_data(ssl, KeyIndex(), new std::string(key));
+
+        std::unique_lock<co::LFLock> lock(mtx_);
+        auto it = sessions_.find(key);
+        if (it != sessions_.end())
+            SSL_set_session(ssl, it->second);
+    }
+
+    int SslSessionStore::OnNewSession(SSL* ssl, SSL_SESSION* sess)
+    {
+        std::string* key = static_cast<std::string*>(SSL_get_ex_data(ssl, KeyIndex()));
+        if (!key) return 0;
+
+        // 返回1表示接管了sess的引用计数
+        Instance().Put(*key, sess);
+        return 1;
+    }
+
+    void SslSessionStore::Put(std::string const& key, SSL_SESSION* sess)
+    {
+        std::unique_lock<co::LFLock> lock(mtx_);
+        auto it = sessions_.find(key);
+        if (it != sessions_.end()) {
+            SSL_SESSION_free(it->second);
+            it->second = sess;
+            return ;
+        }
+
+        if (sessions_.size() >= kMaxEntries) {
+            SSL_SESSION_free(sessions_.begin()->second);
+            sessions_.erase(sessions_.begin());
+        }
+        sessions_[key] = sess;
+    }
+
+    void SslSessionStore::Remove(std::string const& key)
+    {
+        std::unique_lock<co::LFLock> lock(mtx_);
+        auto it = sessions_.find(key);
+        if (it != sessions_.end()) {
+            SSL_SESSION_free(it->second);
+            sessions_.erase(it);
+        }
+    }
+
+    std::size_t SslSessionStore::Size()
+    {
+        std::unique_lock<co::LFLock> lock(mtx_);
+        return sessions_.size();
+    }
+
+} //namespace network
+#endif
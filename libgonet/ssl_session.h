@@ -0,0 +1,45 @@
+#pragma once
+#include "config.h"
+#include <map>
+#include <mutex>
+
+#if ENABLE_SSL
+namespace network {
+
+// 客户端的TLS会话缓存, 按服务端地址及客户端的ssl配置保存最近一次可复用的会话,
+// 下次以相同配置Connect同一地址时用于会话复用(session id或session ticket), 跳过完整握手.
+// TLS1.3的ticket在握手完成后才由服务端发送, 因此通过new_session回调保存.
+class SslSessionStore
+{
+public:
+    static const std::size_t kMaxEntries = 4096;
+
+    static SslSessionStore& Instance();
+
+    // 在客户端的SSL_CTX上开启会话回调.
+    static void EnableOn(SSL_CTX* ctx);
+
+    // 握手前调用: 设置该地址上次保存的会话, 并记录地址以便收到新会话时保存.
+    void Attach(SSL* ssl, std::string const& key);
+
+    void Remove(std::string const& key);
+    std::size_t Size();
+
+    ~SslSessionStore();
+
+private:
+    SslSessionStore() = default;
+    SslSessionStore(SslSessionStore const&) = delete;
+    SslSessionStore& operator=(SslSessionStore const&) = delete;
+
+    static int KeyIndex();
+    static int OnNewSession(SSL* ssl, SSL_SESSION* sess);
+    void Put(std::string const& key, SSL_SESSION* sess);
+
+private:
+    co::LFLock mtx_;
+    std::map<std::string, SSL_SESSION*> sessions_;
+};
+
+} //namespace network
+#endif
@@ -5,7 +5,8 @@
 */
 #include "tcp_detail.h"
 #include <chrono>
-#include <boost/bind.hpp>
+#include <sys/sendfile.h>
+#include <fcntl.h>
 
 namespace network {
 namespace tcp_detail {
@@ -16,6 +17,13 @@ namespace tcp_detail {
         return ios;
     }
 
+    // 以tcp为传输层的协议中, 需要ssl的: ssl, https, wss
+    static tcp_socket_type_t SocketType(proto_type proto)
+    {
+        return (proto == proto_type::ssl || proto == proto_type::https || proto == proto_type::wss)
+            ? tcp_socket_type_t::ssl : tcp_socket_type_t::tcp;
+    }
+
     void TcpSession::Msg::Done(boost_ec const& ec)
     {
         if (tid) {
@@ -31,18 +39,21 @@ namespace tcp_detail {
         }
     }
 
-    TcpSession::TcpSession(shared_ptr<tcp_socket> s,
-            shared_ptr<LifeHolder> holder, OptionsData & opt,
-            endpoint::ext_t const& endpoint_ext)
-        : socket_(s), holder_(holder), recv_buf_(opt.max_pack_size_),
-        max_pack_size_shrink_((std::max)(opt.max_pack_size_shrink_, opt.max_pack_size_)),
-        max_pack_size_hard_((std::max)(opt.max_pack_size_hard_, opt.max_pack_size_)),
-        msg_chan_((std::size_t)-1)
+    TcpSession::TcpSession(tcp_socket && s,
+            shared_ptr<LifeHolder> holder, OptionsPtr opt)
+        : socket_(std::move(s)), holder_(holder), opt_(opt), ext_(holder->GetEndpointExt()),
+        msg_chan_((std::size_t)-1),
+        max_pack_size_shrink_((std::max)(opt->max_pack_size_shrink_, opt->max_pack_size_)),
+        max_pack_size_hard_((std::max)(opt->max_pack_size_hard_, opt->max_pack_size_)),
+        read_idle_timeout_((std::max)(opt->read_idle_timeout_, 0)),
+        write_idle_timeout_((std::max)(opt->write_idle_timeout_, 0)),
+        all_idle_timeout_((std::max)(opt->all_idle_timeout_, 0))
     {
+        // 只保存对端地址(断开后仍用于日志), 本地地址在LocalAddr中按需获取, 关闭时再保存.
+        // unix域socket没有ip地址, 地址只由扩展信息中的path表示.
         boost_ec ignore_ec;
-        local_addr_ = endpoint(s->native_socket().local_endpoint(ignore_ec), endpoint_ext);
-        remote_addr_ = endpoint(s->native_socket().remote_endpoint(ignore_ec), endpoint_ext);
-        sending_ = false;
+        if (!IsUnix())
+            remote_addr_ = socket_.native_socket().remote_endpoint(ignore_ec);
 
         DebugPrint(dbg_session_alive, "TcpSession construct %s:%d",
                 remote_addr_.address().to_string().c_str(), remote_addr_.port());
@@ -54,15 +65,121 @@ namespace tcp_detail {
                 remote_addr_.address().to_string().c_str(), remote_addr_.port());
     }
 
-    void TcpSession::goStart()
+    void TcpSession::goStart(bool local_thread)
+    {
+        co::initialize_socket_async_methods(socket_.native_handle());
+        co::set_et_mode(socket_.native_handle());
+        holder_->OnSessionStart(SessionRef(this));
+        if (opt_->connect_cb_)
+            opt_->connect_cb_(GetSession());
+
+        // 接收协程按local_thread派发, 发送协程和空闲检测由接收协程在同一个线程上创建.
+        auto this_ptr = this->shared_from_this();
+        auto run = [this_ptr]{
+            this_ptr->StartIdleCheck();
+            if (!this_ptr->opt_->send_on_demand_)
+                this_ptr->WakeupSend();
+            this_ptr->DoReceive();
+        };
+        if (local_thread)
+            go_dispatch(egod_local_thread) run;
+        else
+            go_dispatch(egod_robin) run;
+    }
+
+    uint8_t TcpSession::SetState(uint8_t bits)
     {
-        co::initialize_socket_async_methods(socket_->native_handle());
-        co::set_et_mode(socket_->native_handle());
-        if (opt_.connect_cb_)
-            opt_.connect_cb_(GetSession());
+        return state_.fetch_or(bits);
+    }
 
-        goReceive();
-        goSend();
+    void TcpSession::ClearState(uint8_t bits)
+    {
+        state_.fetch_and((uint8_t)~bits);
+    }
+
+    bool TcpSession::TestState(uint8_t bits) const
+    {
+        return (state_.load(std::memory_order_relaxed) & bits) != 0;
+    }
+
+    void TcpSession::StartIdleCheck()
+    {
+        if (!IdleEnabled()) return ;
+
+        uint64_t now = IdleWheel::Now();
+        last_recv_ts_ = now;
+        last_send_ts_ = now;
+        boost::shared_ptr<IdleObserver> observer(this->shared_from_this());
+        IdleWheel::ThreadLocal().Add(observer, OnIdleCheck(now));
+    }
+
+    bool TcpSession::IdleEnabled() const
+    {
+        return read_idle_timeout_ || write_idle_timeout_ || all_idle_timeout_;
+    }
+
+    void TcpSession::UpdateRecvTime()
+    {
+        if (IdleEnabled())
+            last_recv_ts_.store(IdleWheel::Now(), std::memory_order_relaxed);
+    }
+
+    void TcpSession::UpdateSendTime()
+    {
+        if (IdleEnabled())
+            last_send_ts_.store(IdleWheel::Now(), std::memory_order_relaxed);
+    }
+
+    uint64_t TcpSession::OnIdleCheck(uint64_t now)
+    {
+        if (TestState(st_any_shutdown))
+            return 0;
+
+        uint64_t last_recv = last_recv_ts_.load(std::memory_order_relaxed);
+        uint64_t last_send = last_send_ts_.load(std::memory_order_relaxed);
+        uint64_t deadline = std::numeric_limits<uint64_t>::max();
+        boost_ec ec;
+
+        if (read_idle_timeout_) {
+            if (now >= last_recv + read_idle_timeout_)
+                ec = MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_timeout);
+            else
+                deadline = (std::min)(deadline, last_recv + read_idle_timeout_);
+        }
+
+        if (all_idle_timeout_) {
+            uint64_t last_active = (std::max)(last_recv, last_send);
+            if (now >= last_active + all_idle_timeout_)
+                ec = MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_timeout);
+            else
+                deadline = (std::min)(deadline, last_active + all_idle_timeout_);
+        }
+
+        if (!ec && write_idle_timeout_) {
+            if (now >= last_send + write_idle_timeout_) {
+                if (opt_->heartbeat_cb_) {
+                    // 真正写出时还会再更新一次, 这里先更新以免重复生成心跳包.
+                    last_send_ts_.store(now, std::memory_order_relaxed);
+                    deadline = (std::min)(deadline, now + write_idle_timeout_);
+                    Send(opt_->heartbeat_cb_(GetSession()));
+                } else {
+                    ec = MakeNetworkErrorCode(eNetworkErrorCode::ec_send_timeout);
+                }
+            } else {
+                deadline = (std::min)(deadline, last_send + write_idle_timeout_);
+            }
+        }
+
+        if (ec) {
+            DebugPrint(dbg_session_alive, "TcpSession idle timeout %s:%d. error %d:%s",
+                    remote_addr_.address().to_string().c_str(), remote_addr_.port(),
+                    ec.value(), ec.message().c_str());
+            SetCloseEc(ec);
+            Shutdown(true);
+            return 0;
+        }
+
+        return deadline;
     }
 
 //    static std::string to_hex(const char* data, size_t len)                     
@@ -77,64 +194,76 @@ namespace tcp_detail {
 //        return str;                                                                
 //    }                                                                              
 
-    void TcpSession::goReceive()
+    void TcpSession::WaitReadable()
     {
-        auto this_ptr = this->shared_from_this();
-        go_dispatch(egod_local_thread) [=]{
-            auto holder = this_ptr;
-            size_t pos = 0;
-            for (;;)
-            {
-                boost_ec ec;
-                std::size_t n = 0;
-                if (pos >= recv_buf_.size()) {
-                    if (recv_buf_.size() >= max_pack_size_hard_)
-                        ec = MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_overflow);
-                    else {
-                        // extand capacity
-                        recv_buf_.resize((std::min<uint32_t>)(recv_buf_.size() * 2, max_pack_size_hard_));
-                    }
+        // hook后的poll只挂起当前协程
+        pollfd pfd = { socket_.native_handle(), POLLIN, 0 };
+        while (::poll(&pfd, 1, -1) < 0 && errno == EINTR) ;
+    }
+
+    void TcpSession::DoReceive()
+    {
+        size_t pos = 0;
+        for (;;)
+        {
+            boost_ec ec;
+            std::size_t n = 0;
+            if (recv_buf_.empty()) {
+                // 空闲连接不占用接收缓冲区, 可读时再分配.
+                // ssl连接的数据可能已经缓存在ssl层, 不能以socket可读为准.
+                if (!socket_.user_space_tls())
+                    WaitReadable();
+                recv_buf_.resize(opt_->max_pack_size_);
+            } else if (pos >= recv_buf_.size()) {
+                if (recv_buf_.size() >= max_pack_size_hard_)
+                    ec = MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_overflow);
+                else {
+                    // extand capacity
+                    recv_buf_.resize((std::min<uint32_t>)(recv_buf_.size() * 2, max_pack_size_hard_));
                 }
+            }
 
-                if (!ec)
-                    n = socket_->read_some(buffer(&recv_buf_[pos], recv_buf_.size() - pos), ec);
+            if (!ec)
+                n = socket_.read_some(buffer(&recv_buf_[pos], recv_buf_.size() - pos), ec);
 
-                if (!ec) {
-                    if(n > 0) {
+            if (!ec) {
+                if(n > 0) {
+                    UpdateRecvTime();
 //                        printf("receive %u bytes: %s\n", (unsigned)n, to_hex(&recv_buf_[pos], n).c_str());
-                        if (this->opt_.receive_cb_) {
-                            size_t consume = this->opt_.receive_cb_(GetSession(), recv_buf_.data(), n + pos);
-                            if (consume == (size_t)-1)
-                                ec = MakeNetworkErrorCode(eNetworkErrorCode::ec_data_parse_error);
-                            else {
-                                assert(consume <= n + pos);
-                                pos = n + pos - consume;
-                                if (pos > 0)
-                                    memcpy(&recv_buf_[0], &recv_buf_[consume], pos);
-
-                                if (recv_buf_.size() >= max_pack_size_shrink_ + max_pack_size_shrink_ / 2 &&
-                                        pos <= max_pack_size_shrink_ / 2) {
-                                    // shrink capacity
-                                    recv_buf_.resize(max_pack_size_shrink_);
-                                    recv_buf_.shrink_to_fit();
-                                }
+                    if (opt_->receive_ref_cb_ || opt_->receive_cb_) {
+                        size_t consume = opt_->receive_ref_cb_
+                            ? opt_->receive_ref_cb_(SessionRef(this), recv_buf_.data(), n + pos)
+                            : opt_->receive_cb_(GetSession(), recv_buf_.data(), n + pos);
+                        if (consume == (size_t)-1)
+                            ec = MakeNetworkErrorCode(eNetworkErrorCode::ec_data_parse_error);
+                        else {
+                            assert(consume <= n + pos);
+                            pos = n + pos - consume;
+                            if (pos > 0)
+                                memmove(&recv_buf_[0], &recv_buf_[consume], pos);
+
+                            if (recv_buf_.size() >= max_pack_size_shrink_ + max_pack_size_shrink_ / 2 &&
+                                    pos <= max_pack_size_shrink_ / 2) {
+                                // shrink capacity
+                                recv_buf_.resize(max_pack_size_shrink_);
+                                recv_buf_.shrink_to_fit();
                             }
-                        } else {
-                            pos += n;
                         }
+                    } else {
+                        pos += n;
                     }
                 }
+            }
 
-                if (ec) {
-                    SetCloseEc(ec);
-                    DebugPrint(dbg_session_alive, "TcpSession receive shutdown %s:%d",
-                            remote_addr_.address().to_string().c_str(), remote_addr_.port());
+            if (ec) {
+                SetCloseEc(ec);
+                DebugPrint(dbg_session_alive, "TcpSession receive shutdown %s:%d",
+                        remote_addr_.address().to_string().c_str(), remote_addr_.port());
 
-                    ShutdownRecv();
-                    return ;
-                } 
-            }
-        };
+                ShutdownRecv();
+                return ;
+            } 
+        }
     }
 
     void TcpSession::Shutdown(bool immediately)
@@ -143,31 +272,50 @@ namespace tcp_detail {
         DebugPrint(dbg_session_alive, "TcpSession initiative shutdown. is immediately:%s, remote addr %s:%d",
                 immediately ? "true" : "false",
                 remote_addr_.address().to_string().c_str(), remote_addr_.port());
-        initiative_shutdown_ = true;
+        SetState(st_initiative_shutdown);
 
         if (immediately)
-            socket_->shutdown(socket_base::shutdown_both);
-        msg_chan_.TryPush(boost::make_shared<Msg>(Msg::shutdown_msg_t{}));
+            socket_.shutdown(socket_base::shutdown_both);
+        PushMsg(boost::make_shared<Msg>(Msg::shutdown_msg_t{}));
     }
 
     void TcpSession::ShutdownSend()
     {
-        socket_->shutdown(socket_base::shutdown_send);
-        send_shutdown_ = true;
-        if (recv_shutdown_)
+        socket_.shutdown(socket_base::shutdown_send);
+        if (SetState(st_send_shutdown) & st_recv_shutdown)
             OnClose();
     }
 
     void TcpSession::ShutdownRecv()
     {
-        socket_->shutdown(socket_base::shutdown_receive);
-        recv_shutdown_ = true;
-        if (send_shutdown_)
+        socket_.shutdown(socket_base::shutdown_receive);
+        if (SetState(st_recv_shutdown) & st_send_shutdown)
             OnClose();
         else {
-            msg_chan_.TryPush(boost::make_shared<Msg>(Msg::shutdown_msg_t{}));
-            socket_->shutdown(socket_base::shutdown_send);
+            PushMsg(boost::make_shared<Msg>(Msg::shutdown_msg_t{}));
+            socket_.shutdown(socket_base::shutdown_send);
+        }
+    }
+
+    void TcpSession::WakeupSend()
+    {
+        if (!(SetState(st_send_running) & st_send_running))
+            goSend();
+    }
+
+    bool TcpSession::PushMsg(boost::shared_ptr<Msg> const& msg)
+    {
+        // 先计数再入队, 发送协程取出并放入msg_send_list_后才减少,
+        // TryWriteInline据此判断是否有尚未写出的数据.
+        ++queued_;
+        if (!msg_chan_.TryPush(msg)) {
+            --queued_;
+            return false;
         }
+
+        if (opt_->send_on_demand_)
+            WakeupSend();
+        return true;
     }
 
     void TcpSession::goSend()
@@ -177,6 +325,7 @@ namespace tcp_detail {
             auto holder = this_ptr;
             const int c_multi = std::min<int>(64, boost::asio::detail::max_iov_len);
             std::vector<const_buffer> buffers;
+            Buffer ssl_stage;   // ssl连接合并小消息用
             bool msg_shutdown = false;
             for (;;)
             {
@@ -195,27 +344,41 @@ namespace tcp_detail {
                     boost::shared_ptr<Msg> msg;
                     if (!msg_chan_.TryPop(msg)) {
                         if (msg_send_list_.empty()) {
-                            if (initiative_shutdown_) {
+                            if (TestState(st_initiative_shutdown)) {
                                 DebugPrint(dbg_session_alive, "TcpSession send shutdown with initiative_shutdown flag. %s:%d.",
                                         remote_addr_.address().to_string().c_str(), remote_addr_.port());
                                 ShutdownSend();
                                 return ;
+                            } else if (opt_->send_on_demand_) {
+                                // 队列已发送完毕, 退出发送协程.
+                                // 持锁清除标记, TryWriteInline之后的WakeupSend一定能创建新的协程;
+                                // 解锁后再检查一次队列, 避免与PushMsg之间丢失唤醒.
+                                ClearState(st_send_running);
+                                send_token.unlock();
+                                if (queued_ == 0 || (SetState(st_send_running) & st_send_running))
+                                    return ;
+                                send_token.lock();
+                                continue;
                             } else {
-                                sending_ = false;
+                                SetState(st_send_parked);
                                 send_token.unlock();
                                 msg_chan_ >> msg;
                                 send_token.lock();
+                                ClearState(st_send_parked);
                             }
                         } else {
                             break;
                         }
                     }
+                    if (!msg)
+                        continue;   // TryWriteInline的唤醒标记, 数据已在msg_send_list_队首
+                    --queued_;
 
                     if (msg->shutdown) {    // shutdown notify
                         msg_shutdown = true;
                         DebugPrint(dbg_session_alive, "goSend get shutdown msg.");
                         break;
-                    } else if (msg->timeout) {
+                    } else if (msg->timeout && !msg->send_half) {
                         msg->Done(MakeNetworkErrorCode(eNetworkErrorCode::ec_send_timeout));
                     } else {
                         ++ insert_c;
@@ -229,6 +392,7 @@ namespace tcp_detail {
 
                 std::size_t write_bytes = 0;
                 int buffer_size = 0;
+                bool file = false;  // 队首是文件消息, 单独发送
                 auto it = msg_send_list_.begin();
                 while (it != msg_send_list_.end())
                 {
@@ -239,57 +403,69 @@ namespace tcp_detail {
                         continue;
                     }
 
+                    if (msg->IsFile()) {
+                        // 文件之前的数据先写出, 保证顺序.
+                        file = buffer_size == 0;
+                        break;
+                    }
+
                     if (buffer_size >= c_multi) break;
-                    buffers[buffer_size] = buffer(&msg->buf[msg->pos], msg->buf.size() - msg->pos);
-                    write_bytes += msg->buf.size() - msg->pos;
+                    buffers[buffer_size] = buffer(msg->Data() + msg->pos, msg->Size() - msg->pos);
+                    write_bytes += msg->Size() - msg->pos;
                     DebugPrint(dbg_no_delay, "write buffer (pos=%lu, capacity=%lu)",
-                            msg->pos, msg->buf.size());
+                            msg->pos, msg->Size());
 
                     ++it;
                     ++buffer_size;
                 }
                 buffers.resize(buffer_size);
-                if (buffers.empty()) {
+                if (buffers.empty() && !file) {
                     continue;
                 }
 
                 // Send Once
                 boost_ec ec;
                 std::size_t n = 0;
-                pollfd pfd = { socket_->native_handle(), POLLOUT, 0 };
-                int timeo = opt_.sndtimeo_ > 0 ? std::max(opt_.sndtimeo_ / 2, 1) : -1;
+                if (socket_.user_space_tls()) {
+                    n = file ? WriteFileSsl(*msg_send_list_.front(), ssl_stage, ec)
+                        : WriteSsl(buffers, ssl_stage, ec);
+                } else {
+                    pollfd pfd = { socket_.native_handle(), POLLOUT, 0 };
+                    int timeo = opt_->sndtimeo_ > 0 ? std::max(opt_->sndtimeo_ / 2, 1) : -1;
 
-                ::boost::asio::detail::buffer_sequence_adapter<
-                    ::boost::asio::const_buffer,
-                    std::vector<const_buffer>> bufs(buffers);
+                    ::boost::asio::detail::buffer_sequence_adapter<
+                        ::boost::asio::const_buffer,
+                        std::vector<const_buffer>> bufs(buffers);
 retry_write:
-                ssize_t nbytes = ::writev_f(socket_->native_handle(), bufs.buffers(), bufs.count());
-                if (nbytes < 0) {
-                    if (errno == EINTR) {
-                        goto retry_write;
-                    } else if (errno == EAGAIN) {
+                    ssize_t nbytes = file ? WriteFile(*msg_send_list_.front())
+                        : ::writev_f(socket_.native_handle(), bufs.buffers(), bufs.count());
+                    if (nbytes < 0) {
+                        if (errno == EINTR) {
+                            goto retry_write;
+                        } else if (errno == EAGAIN) {
 retry_poll:
-                        if (!msg_shutdown) {
-                            pfd.revents = 0;
-                            co::reset_writable(socket_->native_handle());
-                            DebugPrint(dbg_session_alive, "goSend enter poll(timeout=%d)", timeo);
-                            int res = ::poll(&pfd, 1, timeo);
-                            DebugPrint(dbg_session_alive, "goSend exit poll(timeout=%d)", timeo);
-                            if (res < 0) {
-                                if (errno == EINTR) goto retry_poll;
-                                ec = boost_ec(errno, boost::system::system_category());
-                            } else if (pfd.revents == POLLOUT) {
-                                goto retry_write;
+                            if (!msg_shutdown) {
+                                pfd.revents = 0;
+                                co::reset_writable(socket_.native_handle());
+                                DebugPrint(dbg_session_alive, "goSend enter poll(timeout=%d)", timeo);
+                                int res = ::poll(&pfd, 1, timeo);
+                                DebugPrint(dbg_session_alive, "goSend exit poll(timeout=%d)", timeo);
+                                if (res < 0) {
+                                    if (errno == EINTR) goto retry_poll;
+                                    ec = boost_ec(errno, boost::system::system_category());
+                                } else if (pfd.revents == POLLOUT) {
+                                    goto retry_write;
+                                }
                             }
+                        } else {
+                            ec = boost_ec(errno, boost::system::system_category());
                         }
                     } else {
-                        ec = boost_ec(errno, boost::system::system_category());
+                        n = (std::size_t)nbytes;
+                        UpdateSendTime();
                     }
-                } else {
-                    n = (std::size_t)nbytes;
                 }
 
-//                std::size_t n = socket_->write_some(buffers, ec);
                 DebugPrint(dbg_no_delay, "write_some (bytes=%lu) returns %lu. is_error:%d",
                         write_bytes, n, !!ec);
                 if (ec) {
@@ -305,7 +481,7 @@ retry_poll:
                 it = msg_send_list_.begin();
                 while (it != msg_send_list_.end() && n > 0) {
                     auto &msg = *it;
-                    std::size_t msg_capa = msg->buf.size() - msg->pos;
+                    std::size_t msg_capa = msg->Size() - msg->pos;
                     if (msg_capa <= n) {
                         msg->Done(boost_ec());
                         it = msg_send_list_.erase(it);
@@ -320,24 +496,88 @@ retry_poll:
         };
     }
 
+    std::size_t TcpSession::WriteSsl(std::vector<const_buffer> const& buffers,
+            Buffer & stage, boost_ec & ec)
+    {
+        // TLS记录最大16KB. 多条小消息先合并到stage中, 以整条记录写出,
+        // 大消息直接从原buffer写, 不拷贝.
+        // ssl::stream只会写buffer序列中的第一段, 因此必须合并后再写.
+        static const std::size_t c_tls_record = 16 * 1024;
+        std::size_t first = buffer_size(buffers[0]);
+        std::size_t n = 0;
+        if (buffers.size() == 1 || first >= c_tls_record) {
+            n = socket_.write_some(buffer(buffers[0]), ec);
+        } else {
+            stage.resize(c_tls_record);
+            std::size_t bytes = 0;
+            for (auto const& buf : buffers) {
+                std::size_t len = (std::min)(buffer_size(buf), c_tls_record - bytes);
+                memcpy(&stage[bytes], buffer_cast<const char*>(buf), len);
+                bytes += len;
+                if (bytes >= c_tls_record) break;
+            }
+            n = socket_.write_some(buffer(stage.data(), bytes), ec);
+        }
+
+        if (n > 0)
+            UpdateSendTime();
+        return n;
+    }
+
+    ssize_t TcpSession::WriteFile(Msg & msg)
+    {
+        off_t offset = msg.file_offset + msg.pos;
+        ssize_t n = ::sendfile(socket_.native_handle(), msg.file_fd, &offset, msg.file_bytes - msg.pos);
+        if (n == 0) {
+            // 文件在发送过程中被截断
+            errno = EIO;
+            return -1;
+        }
+        return n;
+    }
+
+    std::size_t TcpSession::WriteFileSsl(Msg & msg, Buffer & stage, boost_ec & ec)
+    {
+        // 用户态tls无法sendfile, 每次读出一条tls记录大小的数据再写.
+        static const std::size_t c_tls_record = 16 * 1024;
+        std::size_t bytes = (std::min)(c_tls_record, msg.file_bytes - msg.pos);
+        stage.resize(c_tls_record);
+        ssize_t n = ::pread(msg.file_fd, stage.data(), bytes, msg.file_offset + msg.pos);
+        if (n <= 0) {
+            ec = boost_ec(n < 0 ? errno : EIO, boost::system::system_category());
+            return 0;
+        }
+
+        std::size_t written = socket_.write_some(buffer(stage.data(), n), ec);
+        if (written > 0)
+            UpdateSendTime();
+        return written;
+    }
+
     void TcpSession::SetCloseEc(boost_ec const& ec)
     {
-        if (close_ec_mutex_.try_lock() && !close_ec_)
+        if (!(SetState(st_close_ec) & st_close_ec))
             close_ec_ = ec;
     }
 
     void TcpSession::OnClose()
     {
-        if (!closed_.try_lock()) return ;
+        if (SetState(st_closed) & st_closed) return ;
 
         DebugPrint(dbg_session_alive, "TcpSession close %s:%d",
                 remote_addr_.address().to_string().c_str(), remote_addr_.port());
-        socket_->close();
+        // DisconnectedCb中LocalAddr仍然可用
+        if (!IsUnix()) {
+            boost_ec ignore_ec;
+            local_addr_ = socket_.native_socket().local_endpoint(ignore_ec);
+        }
+        socket_.close();
 
         for (;;) {
             boost::shared_ptr<Msg> msg;
             if (!msg_chan_.TryPop(msg)) break;
-            msg->Done(MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
+            if (msg)
+                msg->Done(MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
         }
 
         for (auto &msg : msg_send_list_)
@@ -346,174 +586,197 @@ retry_poll:
 
         // 这个回调会减少TcpSession的引用计数, 进入析构. 因此一定要放在函数尾部。
         // 并且前面不能用Guard类操作.
-        if (this->opt_.disconnect_cb_)
-            this->opt_.disconnect_cb_(GetSession(), close_ec_);
+        holder_->OnSessionClose(GetSession(), close_ec_);
     }
 
-    void TcpSession::SendNoDelay(Buffer && buf, SndCb const& cb)
+    boost::shared_ptr<TcpSession::Msg> TcpSession::NewMsg(SndCb const& cb)
     {
-        if (buf.empty()) {
-            if (cb)
-                cb(boost_ec());
-            return ;
-        }
-
-        if (recv_shutdown_ || send_shutdown_ || initiative_shutdown_) {
-            if (cb)
-                cb(MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
-            return ;
+        auto msg = boost::make_shared<Msg>(++msg_id_, cb);
+        if (opt_->sndtimeo_) {
+            msg->tid = co_timer_add(std::chrono::milliseconds(opt_->sndtimeo_),
+                    [=]{
+                        msg->timeout = true;
+                    });
         }
+        return msg;
+    }
 
-        if (socket_->type() == tcp_socket_type_t::ssl) {
-            Send(std::move(buf), cb);
-            return ;
-        }
+    bool TcpSession::TryWriteInline(const char* data, size_t bytes, Buffer* buf, SndCb const& cb,
+            SharedBuffer const* shared)
+    {
+        if (socket_.user_space_tls())
+            return false;
 
+        // 发送协程正在写或队列中有未发送的数据时不能插队, 以保证发送顺序.
         std::unique_lock<co::LFLock> send_token(send_mtx_, std::defer_lock);
         if (!send_token.try_lock()) {
-            Send(std::move(buf), cb);
-            return ;
+            DebugPrint(dbg_no_delay, "Send token try_lock failed.");
+            return false;
         }
 
-        if (sending_) {
-            Send(std::move(buf), cb);
-            return ;
+        if (queued_ || !msg_send_list_.empty()) {
+            DebugPrint(dbg_no_delay, "in sending.");
+            return false;
         }
 
-        ssize_t written = ::write_f(socket_->native_handle(), buf.data(), buf.size());
+        ssize_t written = ::write_f(socket_.native_handle(), data, bytes);
+        DebugPrint(dbg_no_delay, "Send inline(bytes=%lu) returns %ld.",
+                bytes, written);
         if (written <= 0) {
-            // send error.
-            send_token.unlock();
-            Send(std::move(buf), cb);
-            return ;
-        } else if (written >= (ssize_t)buf.size()) {
+            // EAGAIN或出错, 交给发送协程处理.
+            return false;
+        }
+
+        UpdateSendTime();
+        if (written >= (ssize_t)bytes) {
             // all bytes sended.
             send_token.unlock();
             if (cb)
                 cb(boost_ec());
-            return ;
-        } else {
-            // half sended, locked still.
-            auto msg = boost::make_shared<Msg>(++msg_id_, cb);
-            msg->buf.swap(buf);
+            return true;
+        }
+
+        // half sended. 仍持有send_mtx_, 剩余部分直接放到msg_send_list_队首,
+        // 之后其他线程的消息只能经msg_chan_排在它后面.
+        auto msg = NewMsg(cb);
+        if (buf) {
+            msg->buf.swap(*buf);
             msg->pos = written;
-            msg->send_half = true;
-            if (opt_.sndtimeo_) {
-                msg->tid = co_timer_add(std::chrono::milliseconds(opt_.sndtimeo_),
-                        [=]{
-                            msg->timeout = true;
-                        });
-            }
-            // 放到队列头
-            msg_send_list_.push_front(msg);
-            sending_ = true;
+        } else if (shared) {
+            msg->shared = *shared;
+            msg->pos = written;
+        } else {
+            msg->buf.assign(data + written, data + bytes);
         }
+        msg->send_half = true;
+        msg_send_list_.push_front(msg);
+
+        // 唤醒发送协程: 按需模式下协程已退出(标记在持锁时清除), 重新创建;
+        // 常驻协程阻塞在msg_chan_上时, 放入一个不带数据的空标记.
+        if (opt_->send_on_demand_)
+            WakeupSend();
+        else if (TestState(st_send_parked))
+            msg_chan_.TryPush(boost::shared_ptr<Msg>());
+        return true;
+    }
+
+    // Send在队列空闲时已经会直接写socket, SendNoDelay保留为同义接口.
+    void TcpSession::SendNoDelay(Buffer && buf, SndCb const& cb)
+    {
+        Send(std::move(buf), cb);
     }
     void TcpSession::SendNoDelay(const void* data, size_t bytes, SndCb const& cb)
     {
-        if (!data || !bytes) {
+        Send(data, bytes, cb);
+    }
+
+    void TcpSession::Send(Buffer && buf, SndCb const& cb)
+    {
+        if (buf.empty()) {
             if (cb)
                 cb(boost_ec());
             return ;
         }
 
-        if (recv_shutdown_ || send_shutdown_ || initiative_shutdown_) {
+        if (TestState(st_any_shutdown)) {
             if (cb)
                 cb(MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
             return ;
         }
 
-        if (socket_->type() == tcp_socket_type_t::ssl) {
-            Send(data, bytes, cb);
+        if (TryWriteInline(buf.data(), buf.size(), &buf, cb))
             return ;
-        }
 
-        std::unique_lock<co::LFLock> send_token(send_mtx_, std::defer_lock);
-        if (!send_token.try_lock()) {
-            DebugPrint(dbg_no_delay, "Send token try_lock failed.");
-            Send(data, bytes, cb);
+        auto msg = NewMsg(cb);
+        msg->buf.swap(buf);
+        if (!PushMsg(msg)) {
+            msg->Done(MakeNetworkErrorCode(eNetworkErrorCode::ec_send_overflow));
+            return ;
+        }
+    }
+    void TcpSession::Send(const void* data, size_t bytes, SndCb const& cb)
+    {
+        if (!data || !bytes) {
+            if (cb)
+                cb(boost_ec());
             return ;
         }
 
-        if (sending_) {
-            DebugPrint(dbg_no_delay, "in sending.");
-            Send(data, bytes, cb);
+        if (TestState(st_any_shutdown)) {
+            if (cb)
+                cb(MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
             return ;
         }
 
-        ssize_t written = ::write_f(socket_->native_handle(), data, bytes);
-        DebugPrint(dbg_no_delay, "Send no delay(bytes=%lu) returns %ld.",
-                bytes, written);
-        if (written <= 0) {
-            // send error.
-            send_token.unlock();
-            Send(data, bytes, cb);
+        if (TryWriteInline((const char*)data, bytes, nullptr, cb))
             return ;
-        } else if (written >= (ssize_t)bytes) {
-            // all bytes sended.
-            send_token.unlock();
-            if (cb)
-                cb(boost_ec());
+
+        auto msg = NewMsg(cb);
+        msg->buf.assign((const char*)data, (const char*)data + bytes);
+        if (!PushMsg(msg)) {
+            msg->Done(MakeNetworkErrorCode(eNetworkErrorCode::ec_send_overflow));
             return ;
-        } else {
-            // half sended, locked still.
-            Buffer buf((char*)data + written, (char*)data + bytes);
-            auto msg = boost::make_shared<Msg>(++msg_id_, cb);
-            msg->buf.swap(buf);
-            msg->pos = 0;
-            msg->send_half = true;
-            if (opt_.sndtimeo_) {
-                msg->tid = co_timer_add(std::chrono::milliseconds(opt_.sndtimeo_),
-                        [=]{
-                            msg->timeout = true;
-                        });
-            }
-            // 放到队列头
-            msg_send_list_.push_front(msg);
-            sending_ = true;
         }
     }
 
-    void TcpSession::Send(Buffer && buf, SndCb const& cb)
+    void TcpSession::SendShared(SharedBuffer const& buf, SndCb const& cb)
     {
-        if (buf.empty()) {
+        if (!buf || buf->empty()) {
             if (cb)
                 cb(boost_ec());
             return ;
         }
 
-        if (recv_shutdown_ || send_shutdown_ || initiative_shutdown_) {
+        if (TestState(st_any_shutdown)) {
             if (cb)
                 cb(MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
             return ;
         }
 
-        auto msg = boost::make_shared<Msg>(++msg_id_, cb);
-        msg->buf.swap(buf);
-        if (opt_.sndtimeo_) {
-            msg->tid = co_timer_add(std::chrono::milliseconds(opt_.sndtimeo_),
-                    [=]{
-                        msg->timeout = true;
-                    });
-        }
+        if (TryWriteInline(buf->data(), buf->size(), nullptr, cb, &buf))
+            return ;
 
-        if (!msg_chan_.TryPush(msg)) {
+        auto msg = NewMsg(cb);
+        msg->shared = buf;
+        if (!PushMsg(msg)) {
             msg->Done(MakeNetworkErrorCode(eNetworkErrorCode::ec_send_overflow));
             return ;
         }
     }
-    void TcpSession::Send(const void* data, size_t bytes, SndCb const& cb)
+
+    void TcpSession::SendFile(int fd, off_t offset, size_t bytes, SndCb const& cb)
     {
-        Buffer buf(bytes);
-        memcpy(&buf[0], data, bytes);
-        Send(std::move(buf), cb);
+        if (!bytes) {
+            if (cb)
+                cb(boost_ec());
+            return ;
+        }
+
+        if (TestState(st_any_shutdown)) {
+            if (cb)
+                cb(MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
+            return ;
+        }
+
+        // 文件总是由发送协程写出, 不在调用者的协程中阻塞读盘.
+        auto msg = NewMsg(cb);
+        msg->file_fd = fd;
+        msg->file_offset = offset;
+        msg->file_bytes = bytes;
+        if (!PushMsg(msg)) {
+            msg->Done(MakeNetworkErrorCode(eNetworkErrorCode::ec_send_overflow));
+            return ;
+        }
     }
 
     boost_ec TcpSession::SetSocketOptNoDelay(bool is_nodelay)
     {
         boost_ec ec;
+        if (IsUnix())
+            return ec;  // 没有Nagle算法
+
         boost::asio::ip::tcp::no_delay opt_delay(is_nodelay);
-        socket_->native_socket().set_option(opt_delay, ec);
+        socket_.native_socket().set_option(opt_delay, ec);
         return ec;
     }
 
@@ -524,11 +787,24 @@ retry_poll:
 
     endpoint TcpSession::LocalAddr()
     {
-        return local_addr_;
+        if (IsUnix())
+            return endpoint(tcp::endpoint(), *ext_);
+        if (TestState(st_closed))
+            return endpoint(local_addr_, *ext_);
+        boost_ec ignore_ec;
+        return endpoint(socket_.native_socket().local_endpoint(ignore_ec), *ext_);
     }
     endpoint TcpSession::RemoteAddr()
     {
-        return remote_addr_;
+        return endpoint(remote_addr_, *ext_);
+    }
+    bool TcpSession::IsUnix()
+    {
+        return ext_->proto_ == proto_type::uds;
+    }
+    SessionId TcpSession::GetId()
+    {
+        return id_;
     }
     std::size_t TcpSession::GetSendQueueSize()
     {
@@ -542,24 +818,87 @@ retry_poll:
 
     boost_ec TcpServer::goStartBeforeFork(endpoint addr)
     {
+        typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+        int shards = (std::max)(opt_.accept_shards_, 1);
         try {
-            acceptor_.reset(new tcp::acceptor(GetTcpIoService()));
-            acceptor_->open(tcp::endpoint(addr).protocol());
-            acceptor_->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
-            acceptor_->bind(addr);
-            acceptor_->listen(opt_.listen_backlog_);
-            local_addr_ = endpoint(acceptor_->local_endpoint(), addr.ext());
+            // 所有监听socket共用一个ssl::context, 共享会话缓存和票据密钥.
+            if (SocketType(addr.proto()) == tcp_socket_type_t::ssl)
+                ctx_ = CreateContext(opt_.ssl_option_);
+
+            if (addr.proto() == proto_type::uds)
+                return ListenUnix(addr, shards);
+
+            tcp::endpoint bind_addr(addr);
+            for (int i = 0; i < shards; ++i) {
+                shared_ptr<tcp::acceptor> acceptor(new tcp::acceptor(GetTcpIoService()));
+                acceptor->open(bind_addr.protocol());
+                acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+                if (opt_.accept_shards_ > 0)
+                    acceptor->set_option(reuse_port(true));
+                acceptor->bind(bind_addr);
+                acceptor->listen(opt_.listen_backlog_);
+
+                // 随机端口时, 后续的监听socket绑定到第一个分配到的端口上.
+                if (i == 0)
+                    bind_addr = acceptor->local_endpoint();
+                acceptors_.push_back(acceptor);
+            }
+            local_addr_ = endpoint(acceptors_.front()->local_endpoint(), addr.ext());
+            ext_ = boost::make_shared<endpoint::ext_t>(addr.ext());
         } catch (boost::system::system_error& e) {
+            acceptors_.clear();
             return e.code();
         }
         return boost_ec();
     }
+    boost_ec TcpServer::ListenUnix(endpoint const& addr, int shards)
+    {
+        boost_ec ec;
+        int fd = UnixSocket::Listen(addr.path(), opt_.listen_backlog_, ec);
+        if (fd < 0) return ec;
+
+        // unix域socket不支持SO_REUSEPORT分流, 各分片的accept协程在同一个监听队列的副本上accept.
+        for (int i = 0; i < shards; ++i) {
+            int shard_fd = i == 0 ? fd : ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+            if (shard_fd < 0)
+                ec = boost_ec(errno, boost::system::system_category());
+            shared_ptr<tcp::acceptor> acceptor(new tcp::acceptor(GetTcpIoService()));
+            if (!ec)
+                acceptor->assign(tcp::v4(), shard_fd, ec);
+            if (ec) {
+                if (shard_fd >= 0) ::close(shard_fd);
+                acceptors_.clear();
+                UnixSocket::Unlink(addr.path());
+                return ec;
+            }
+            acceptors_.push_back(acceptor);
+        }
+        local_addr_ = addr;
+        ext_ = boost::make_shared<endpoint::ext_t>(addr.ext());
+        unix_owner_ = ::getpid();
+        return ec;
+    }
     void TcpServer::goStartAfterFork()
     {
         auto this_ptr = this->shared_from_this();
-        go_dispatch(egod_robin) [this_ptr] {
-            this_ptr->Accept();
-        };
+        bool pinned = opt_.accept_shards_ > 0;
+
+        // 握手线程在fork之后创建
+        if (SocketType(local_addr_.proto()) == tcp_socket_type_t::ssl && opt_.handshake_threads_ > 0)
+            handshake_pool_.reset(new HandshakePool(opt_.handshake_threads_,
+                        opt_.handshake_queue_limit_, opt_.handshake_timeout_));
+
+        for (auto & acceptor : acceptors_) {
+            shared_ptr<HandoffChan> handoff;
+            if (handshake_pool_) {
+                handoff.reset(new HandoffChan((std::size_t)-1));
+                handoffs_.push_back(handoff);
+            }
+
+            go_dispatch(egod_robin) [this_ptr, acceptor, pinned, handoff] {
+                this_ptr->Accept(acceptor, pinned, handoff);
+            };
+        }
     }
 
     boost_ec TcpServer::goStart(endpoint addr)
@@ -572,84 +911,232 @@ retry_poll:
     }
     void TcpServer::Shutdown(bool immediately)
     {
-        shutdown_ = true;
-        if (acceptor_)
-            shutdown(acceptor_->native_handle(), socket_base::shutdown_both);
+        // fork出的子进程共享同一个socket文件, 其中一个退出时不能删除, 否则其他进程无法再被连接.
+        bool first = !shutdown_.exchange(true);
+        if (first && local_addr_.proto() == proto_type::uds && !acceptors_.empty()
+                && unix_owner_ == ::getpid())
+            UnixSocket::Unlink(local_addr_.path());
+        for (auto & acceptor : acceptors_) {
+            shutdown(acceptor->native_handle(), socket_base::shutdown_both);
+            resume_accept_.TryPush(true);
+        }
+
+        for (auto & handoff : handoffs_)
+            handoff->TryPush(Handoff());
 
-        std::lock_guard<co_mutex> lock(sessions_mutex_);
-        for (auto &v : sessions_)
-            v.second->Shutdown(immediately);
+        sessions_.ForEach([=](shared_ptr<TcpSession> const& sess) {
+                sess->Shutdown(immediately);
+            });
     }
-    void TcpServer::Accept()
+    void TcpServer::Accept(shared_ptr<tcp::acceptor> acceptor, bool pinned,
+            shared_ptr<HandoffChan> handoff)
     {
-        auto this_ptr = this->shared_from_this();
-        tcp_context ctx(tcp_socket::create_tcp_context(opt_.ssl_option_));
+        if (handoff) {
+            auto this_ptr = this->shared_from_this();
+            go_dispatch(egod_local_thread) [this_ptr, handoff, pinned] {
+                this_ptr->DoHandoff(handoff, pinned);
+            };
+        }
+
+        tcp_socket_type_t type = SocketType(local_addr_.proto());
+
+        boost_ec ec;
+        tcp protocol = acceptor->local_endpoint(ec).protocol();
+        int listen_fd = acceptor->native_handle();
+
+        // 监听socket设为非阻塞, 每次唤醒后用accept4一直取到EAGAIN, 一次清空积压的连接.
+        acceptor->non_blocking(true, ec);
+        ec.clear();
 
         for (;;)
         {
-            shared_ptr<tcp_socket> s(new tcp_socket(GetTcpIoService(),
-                        local_addr_.proto() == proto_type::tcp ? tcp_socket_type_t::tcp : tcp_socket_type_t::ssl,
-                        ctx));
-
             // aspect before accept
             if (opt_.accept_aspect_.before_aspect)
                 opt_.accept_aspect_.before_aspect();
 
-            boost_ec ec;
-            acceptor_->accept(s->native_socket(), ec);
+            int accepted = 0;
+            bool full = false;
+            for (;;)
+            {
+                if (opt_.accept_pause_on_full_ && IsFull()) {
+                    full = true;
+                    break;
+                }
+
+                int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd >= 0) {
+                    ++accepted;
+                    OnAccept(fd, protocol, type, pinned, handoff);
+                    continue;
+                }
+
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    ec = boost_ec(errno, boost::system::system_category());
+                    break;
+                }
+
+                if (accepted || shutdown_) break;
+
+                // 积压队列已空, 等待新的连接.
+                pollfd pfd = { listen_fd, POLLIN, 0 };
+                if (::poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+                    ec = boost_ec(errno, boost::system::system_category());
+                    break;
+                }
+            }
 
             // aspect after accept
             if (opt_.accept_aspect_.after_aspect)
                 opt_.accept_aspect_.after_aspect();
 
-            if (ec) {
-                if (shutdown_) {
-                    boost_ec ignore_ec;
-                    acceptor_->close(ignore_ec);
-                    DebugPrint(dbg_accept_debug, "accept end");
-                    return ;
-                }
+            if (shutdown_) {
+                boost_ec ignore_ec;
+                acceptor->close(ignore_ec);
+                DebugPrint(dbg_accept_debug, "accept end");
+                return ;
+            }
 
+            if (ec) {
                 DebugPrint(dbg_accept_error, "accept error %d:%s",
                         ec.value(), ec.message().c_str());
+                ec.clear();
                 co_yield;
-                continue;
             }
 
+            if (full)
+                WaitForCapacity();
+        }
+    }
+
+    void TcpServer::OnAccept(int fd, tcp const& protocol, tcp_socket_type_t type,
+            bool pinned, shared_ptr<HandoffChan> const& handoff)
+    {
+        if (!AcquireConnection()) {
+            // 已达到连接数上限, 直接关闭, 不再握手和分配session.
+            ::close(fd);
+            DebugPrint(dbg_accept_debug, "accept reject: max_connection(%u) reached",
+                    (unsigned)opt_.max_connection_);
+            return ;
+        }
+
+        tcp_context ctx = GetContext();
+        tcp_socket s(GetTcpIoService(), type, ctx);
+        boost_ec ec;
+        s.native_socket().assign(protocol, fd, ec);
+        if (ec) {
+            ReleaseConnection();
+            ::close(fd);
+            DebugPrint(dbg_accept_error, "assign accepted socket error %d:%s",
+                    ec.value(), ec.message().c_str());
+            return ;
+        }
+
+        // unix域socket的对端没有ip地址
+        boost_ec ignore_ec;
+        if (local_addr_.proto() == proto_type::uds)
+            DebugPrint(dbg_accept_debug, "accept from unix:%s", local_addr_.path().c_str());
+        else
             DebugPrint(dbg_accept_debug, "accept from %s:%d",
-                    s->native_socket().remote_endpoint().address().to_string().c_str(),
-                    s->native_socket().remote_endpoint().port());
+                    s.native_socket().remote_endpoint(ignore_ec).address().to_string().c_str(),
+                    s.native_socket().remote_endpoint(ignore_ec).port());
 
-            go_dispatch(egod_robin) [s, this_ptr, this] {
-                boost_ec ec = s->handshake(handshake_type_t::server);
-                if (ec) return ;
+        if (type == tcp_socket_type_t::tcp) {
+            // 明文连接无需握手, 直接在accept协程中建立session, 不再为每个连接创建协程.
+            StartSession(std::move(s), pinned);
+            return ;
+        }
 
-                shared_ptr<TcpSession> sess(new TcpSession(s, this->shared_from_this(), opt_, local_addr_.ext()));
+#if ENABLE_SSL
+        s.set_ktls(opt_.ssl_option_.ktls);
+#endif
+
+        // 握手期间socket暂存在堆上, 握手成功后再移入session.
+        auto hs = boost::make_shared<tcp_socket>(std::move(s));
+        if (handshake_pool_) {
+            // 在握手线程池中握手, 完成后交还给交接协程.
+            // 先计数再检查shutdown_, 与DoHandoff中的先看到关闭再检查计数配合, 交还的结果不会无人接收.
+            ++handshaking_;
+            bool ok = !shutdown_ && handshake_pool_->Submit(hs,
+                    [handoff](shared_ptr<tcp_socket> s, boost_ec const& ec) {
+                        handoff->TryPush(Handoff(s, ec));
+                    });
+            if (!ok) {
+                --handshaking_;
+                ReleaseConnection();
+                DebugPrint(dbg_accept_debug, "accept reject: handshake queue full or shutdown");
+            }
+            return ;
+        }
 
-                {
-                    std::unique_lock<co_mutex> lock(sessions_mutex_);
-                    if (shutdown_) {
-                        lock.unlock();
-                        sess->Shutdown();
-                        return;
-                    } else if (sessions_.size() >= opt_.max_connection_) {
-                        lock.unlock();
-                        sess->Shutdown();
-                        return;
-                    } else {
-                        sessions_[sess->GetSession()] = sess;
-                    }
+        auto this_ptr = this->shared_from_this();
+        auto handshake = [hs, this_ptr] {
+            boost_ec ec = hs->handshake(handshake_type_t::server);
+            if (ec) {
+                this_ptr->ReleaseConnection();
+                return ;
+            }
+
+            this_ptr->StartSession(std::move(*hs), true);
+        };
+
+        // 分片模式下session固定在accept协程所在的线程上
+        if (pinned)
+            go_dispatch(egod_local_thread) handshake;
+        else
+            go_dispatch(egod_robin) handshake;
+    }
+
+    void TcpServer::DoHandoff(shared_ptr<HandoffChan> handoff, bool pinned)
+    {
+        bool stopping = false;
+        for (;;)
+        {
+            Handoff h;
+            if (!stopping) {
+                *handoff >> h;
+                if (!h.first) {
+                    stopping = true;
+                    continue;
                 }
+            } else {
+                // Shutdown之后仍要收回握手中的连接, 否则它们的socket和连接计数都会泄漏.
+                // 结果可能交给其他分片的交接协程, 所以按总数判断, 而不是等本队列为空.
+                if (!handshaking_) return ;
+                if (!handoff->TimedPop(h, std::chrono::milliseconds(100)) || !h.first)
+                    continue;
+            }
+            --handshaking_;
 
-                sess->SetSndTimeout(opt_.sndtimeo_)
-                    .SetConnectedCb(opt_.connect_cb_)
-                    .SetReceiveCb(opt_.receive_cb_)
-                    .SetDisconnectedCb(boost::bind(&TcpServer::OnSessionClose, this, _1, _2))
-                    .goStart();
-            };
+            if (h.second) {
+                DebugPrint(dbg_accept_debug, "handshake error %d:%s",
+                        h.second.value(), h.second.message().c_str());
+                ReleaseConnection();
+                continue;
+            }
+
+            // 分片模式下session固定在当前线程, 否则轮询派发. 已经Shutdown时由StartSession关闭.
+            StartSession(std::move(*h.first), pinned);
         }
     }
 
+    void TcpServer::StartSession(tcp_socket && s, bool local_thread)
+    {
+        shared_ptr<TcpSession> sess(new TcpSession(std::move(s), this->shared_from_this(),
+                    GetSnapshot()));
+
+        // 先登记再检查shutdown_, 与Shutdown中的先设置标记再遍历配合, 不会漏掉session.
+        sess->id_ = sessions_.Insert(sess);
+        if (shutdown_) {
+            sessions_.Erase(sess->id_);
+            sess->Shutdown();
+            ReleaseConnection();
+            return;
+        }
+
+        sess->goStart(local_thread);
+    }
+
     void TcpServer::OnSessionClose(::network::SessionEntry id, boost_ec const& ec)
     {
         // 后面的erase会导致TcpServer引用计数减少, 可能进入析构函数.
@@ -659,8 +1146,42 @@ retry_poll:
         if (opt_.disconnect_cb_)
             opt_.disconnect_cb_(id, ec);
 
-        std::lock_guard<co_mutex> lock(sessions_mutex_);
-        sessions_.erase(id);
+        TcpSession* sess = static_cast<TcpSession*>(id.operator->());
+        if (sessions_.Erase(sess->id_))
+            ReleaseConnection();
+    }
+
+    bool TcpServer::AcquireConnection()
+    {
+        uint32_t n = conn_count_;
+        while (n < opt_.max_connection_) {
+            if (conn_count_.compare_exchange_weak(n, n + 1))
+                return true;
+        }
+        return false;
+    }
+
+    void TcpServer::ReleaseConnection()
+    {
+        --conn_count_;
+        if (accept_paused_)
+            resume_accept_.TryPush(true);
+    }
+
+    bool TcpServer::IsFull()
+    {
+        return conn_count_ >= opt_.max_connection_;
+    }
+
+    void TcpServer::WaitForCapacity()
+    {
+        // 先登记再检查, 保证与ReleaseConnection之间不会丢失唤醒.
+        ++accept_paused_;
+        while (!shutdown_ && IsFull()) {
+            bool token;
+            resume_accept_ >> token;
+        }
+        --accept_paused_;
     }
 
     endpoint TcpServer::LocalAddr()
@@ -668,9 +1189,79 @@ retry_poll:
         return local_addr_;
     }
 
+    shared_ptr<const endpoint::ext_t> TcpServer::GetEndpointExt()
+    {
+        return ext_;
+    }
+
+    tcp_context TcpServer::CreateContext(OptionSSL const& opt)
+    {
+#if ENABLE_SSL
+        return SslSni::CreateContext(opt, opt_.ssl_host_options_);
+#else
+        return tcp_socket::create_tcp_context(opt);
+#endif
+    }
+
+    tcp_context TcpServer::GetContext()
+    {
+        std::unique_lock<co::LFLock> lock(ctx_mtx_);
+        return ctx_;
+    }
+
+    boost_ec TcpServer::ReloadSSL(OptionSSL const& opt)
+    {
+        if (SocketType(local_addr_.proto()) != tcp_socket_type_t::ssl)
+            return boost::asio::error::operation_not_supported;
+
+        tcp_context ctx;
+        try {
+            ctx = CreateContext(opt);
+        } catch (boost::system::system_error& e) {
+            return e.code();
+        }
+
+        // 正在握手和已建立的连接持有旧context的引用, 不受影响;
+        // 旧context在锁外随局部变量析构.
+        {
+            std::unique_lock<co::LFLock> lock(ctx_mtx_);
+            std::swap(ctx_, ctx);
+        }
+        return boost_ec();
+    }
+
+    HandshakeStats TcpServer::GetHandshakeStats()
+    {
+        return handshake_pool_ ? handshake_pool_->Stats() : HandshakeStats();
+    }
+
+    SessionEntry TcpServer::Lookup(SessionId id)
+    {
+        shared_ptr<TcpSession> sess = sessions_.Lookup(id);
+        return sess ? sess->GetSession() : SessionEntry();
+    }
+
+    // 直接通过表中的引用发送, 不经过SessionEntry(shared_from_this).
+    // 不在分片锁内发送: Send可能直接写socket, 回调也可能同步执行并再次访问sessions_.
+    bool TcpServer::Send(SessionId id, Buffer && buf, SndCb const& cb)
+    {
+        shared_ptr<TcpSession> sess = sessions_.Lookup(id);
+        if (!sess) return false;
+        sess->Send(std::move(buf), cb);
+        return true;
+    }
+
+    bool TcpServer::Send(SessionId id, const void* data, size_t bytes, SndCb const& cb)
+    {
+        shared_ptr<TcpSession> sess = sessions_.Lookup(id);
+        if (!sess) return false;
+        sess->Send(data, bytes, cb);
+        return true;
+    }
+
     std::size_t TcpServer::SessionCount()
     {
-        return sessions_.size();
+        return sessions_.Size();
     }
 
     boost_ec TcpClient::Connect(endpoint addr)
@@ -679,22 +1270,44 @@ retry_poll:
         std::unique_lock<co_mutex> lock(connect_mtx_, std::defer_lock);
         if (!lock.try_lock()) return MakeNetworkErrorCode(eNetworkErrorCode::ec_connecting);
 
-        tcp_context ctx(tcp_socket::create_tcp_context(opt_.ssl_option_));
-        shared_ptr<tcp_socket> s(new tcp_socket(GetTcpIoService(),
-                    addr.proto() == proto_type::tcp ? tcp_socket_type_t::tcp : tcp_socket_type_t::ssl,
-                    ctx));
+        tcp_socket_type_t type = SocketType(addr.proto());
+        if (type == tcp_socket_type_t::ssl)
+            ctx_ = tcp_socket::shared_tcp_context(opt_.ssl_option_);
+        tcp_socket s(GetTcpIoService(), type, ctx_);
         boost_ec ec;
-        s->native_socket().connect(addr, ec);
-        if (ec) return ec;
+        if (addr.proto() == proto_type::uds) {
+            int fd = UnixSocket::Connect(addr.path(), ec);
+            if (fd < 0) return ec;
+            s.native_socket().assign(tcp::v4(), fd, ec);
+            if (ec) {
+                ::close(fd);
+                return ec;
+            }
+        } else {
+            s.native_socket().connect(addr, ec);
+            if (ec) return ec;
+        }
 
-        ec = s->handshake(handshake_type_t::client);
+#if ENABLE_SSL
+        s.set_ktls(opt_.ssl_option_.ktls);
+        std::string const& server_name = opt_.ssl_option_.server_name;
+        if (s.type() == tcp_socket_type_t::ssl && server_name.size())
+            SSL_set_tlsext_host_name(s.native_ssl(), server_name.c_str());
+        if (s.type() == tcp_socket_type_t::ssl && opt_.ssl_option_.session_resume) {
+            // 复用上次以相同ssl配置连接同一地址(及同一SNI主机名)时的会话.
+            // 复用会跳过证书校验, 因此校验方式、CA和客户端证书不同的配置不能共用会话.
+            SslSessionStore::EnableOn(ctx_->native_handle());
+            SslSessionStore::Instance().Attach(s.native_ssl(),
+                    addr.address().to_string() + ":" + std::to_string(addr.port()) + "/" + server_name
+                    + "/" + tcp_socket::context_key(opt_.ssl_option_));
+        }
+#endif
+
+        ec = s.handshake(handshake_type_t::client);
         if (ec) return ec;
 
-        sess_.reset(new TcpSession(s, this->shared_from_this(), opt_, addr.ext()));
-        sess_->SetSndTimeout(opt_.sndtimeo_)
-            .SetConnectedCb(opt_.connect_cb_)
-            .SetReceiveCb(opt_.receive_cb_)
-            .SetDisconnectedCb(boost::bind(&TcpClient::OnSessionClose, this, _1, _2));
+        ext_ = boost::make_shared<endpoint::ext_t>(addr.ext());
+        sess_.reset(new TcpSession(std::move(s), this->shared_from_this(), GetSnapshot()));
 
         auto sess = sess_;
         go_dispatch(egod_robin) [sess] {
@@ -718,6 +1331,11 @@ retry_poll:
         sess_.reset();
     }
 
+    shared_ptr<const endpoint::ext_t> TcpClient::GetEndpointExt()
+    {
+        return ext_;
+    }
+
 } //namespace tcp_detail
 } //namespace network
 
@@ -5,6 +5,12 @@
 #include "abstract.h"
 #include "option.h"
 #include "tcp_socket.h"
+#include "idle_wheel.h"
+#include "session_registry.h"
+#include "ssl_session.h"
+#include "sni.h"
+#include "handshake_pool.h"
+#include "unix_socket.h"
 
 namespace network {
 namespace tcp_detail {
@@ -14,15 +20,30 @@ using namespace boost::asio::ip;
 using boost_ec = boost::system::error_code;
 using boost::shared_ptr;
 
-class LifeHolder {};
+// TcpSession的持有者(TcpServer/TcpClient).
+// session断开时通过OnSessionClose通知持有者, 不再为每个session单独设置断开回调.
+class LifeHolder
+{
+public:
+    virtual ~LifeHolder() {}
+    virtual void OnSessionClose(::network::SessionEntry id, boost_ec const& ec) = 0;
+
+    // session开始收发之前, 先于ConnectedCb调用. 协议引擎在此设置ProtoStorage,
+    // 之后接收协程和空闲检测才会启动, 因此不会与它们并发.
+    virtual void OnSessionStart(SessionRef sess) {}
+
+    // session的地址只在需要时才构造, 扩展信息(协议/path)由持有者创建, 同一持有者的session共享一份.
+    // session构造时取得并持有, 持有者之后重新Connect也不会改变已有session看到的值.
+    virtual shared_ptr<const endpoint::ext_t> GetEndpointExt() = 0;
+};
 
 io_service& GetTcpIoService();
 
 class TcpServer;
 class TcpSession
-    : public Options<TcpSession>,
-    public boost::enable_shared_from_this<TcpSession>,
-    public SessionBase
+    : public boost::enable_shared_from_this<TcpSession>,
+    public SessionBase,
+    public IdleObserver
 {
 public:
     struct Msg
@@ -37,60 +58,121 @@ public:
         SndCb cb;
         co_timer_id tid;
         Buffer buf;
+        SharedBuffer shared;    // 非空时发送它而不是buf
+        int file_fd = -1;       // >=0时发送文件的[file_offset, file_offset + file_bytes)
+        off_t file_offset = 0;
+        std::size_t file_bytes = 0;
 
         Msg(uint64_t uid, SndCb ocb) : id(uid), cb(ocb) {}
         explicit Msg(shutdown_msg_t) : shutdown(true) {}
         void Done(boost_ec const& ec);
+
+        bool IsFile() const { return file_fd >= 0; }
+        const char* Data() const { return shared ? shared->data() : buf.data(); }
+        std::size_t Size() const { return IsFile() ? file_bytes : shared ? shared->size() : buf.size(); }
     };
     typedef co::co_chan<boost::shared_ptr<Msg>> MsgChan;
     typedef std::list<boost::shared_ptr<Msg>> MsgList;
+    typedef shared_ptr<const OptionsData> OptionsPtr;
 
-    explicit TcpSession(shared_ptr<tcp_socket> s, shared_ptr<LifeHolder> holder,
-            OptionsData & opt, endpoint::ext_t const& endpoint_ext);
+    // @s: socket内嵌在session中, 构造时移入.
+    // @opt: 持有者的配置快照, 同一版本的配置由所有session共享, 只读.
+    explicit TcpSession(tcp_socket && s, shared_ptr<LifeHolder> holder, OptionsPtr opt);
     ~TcpSession();
-    void goStart();
-    SessionEntry GetSession();
+    // @local_thread: true时收发协程运行在当前线程上, 否则轮询派发到各个线程.
+    void goStart(bool local_thread = true);
+    virtual SessionEntry GetSession() override;
 
     virtual void SendNoDelay(Buffer && buf, SndCb const& cb = NULL) override;
     virtual void SendNoDelay(const void* data, size_t bytes, SndCb const& cb = NULL) override;
     virtual void Send(Buffer && buf, SndCb const& cb = NULL) override;
     virtual void Send(const void* data, size_t bytes, SndCb const& cb = NULL) override;
+    virtual void SendShared(SharedBuffer const& buf, SndCb const& cb = NULL) override;
+    virtual void SendFile(int fd, off_t offset, size_t bytes, SndCb const& cb = NULL) override;
     virtual void Shutdown(bool immediately = true) override;
     virtual boost_ec SetSocketOptNoDelay(bool is_nodelay) override;
     virtual bool IsEstab() override;
     virtual endpoint LocalAddr() override;
     virtual endpoint RemoteAddr() override;
+    virtual SessionId GetId() override;
     virtual std::size_t GetSendQueueSize() override;
 
+    virtual uint64_t OnIdleCheck(uint64_t now) override;
+
 private:
-    void goReceive();
+    void DoReceive();
     void goSend();
+    // ssl连接的写操作, 返回写出的明文字节数.
+    std::size_t WriteSsl(std::vector<const_buffer> const& buffers, Buffer & stage, boost_ec & ec);
+    // 文件消息的一次写操作, 返回写出的字节数; 明文连接返回-1/errno同write.
+    ssize_t WriteFile(Msg & msg);
+    std::size_t WriteFileSsl(Msg & msg, Buffer & stage, boost_ec & ec);
+    // 发送协程未运行时创建发送协程
+    void WakeupSend();
+    bool PushMsg(boost::shared_ptr<Msg> const& msg);
+    boost::shared_ptr<Msg> NewMsg(SndCb const& cb);
+    // 队列空闲时直接写socket, 返回false表示未处理, 由调用者入队.
+    // @buf/@shared: 非空时data指向其中的数据, 部分写出时剩余数据直接从中接管.
+    bool TryWriteInline(const char* data, size_t bytes, Buffer* buf, SndCb const& cb,
+            SharedBuffer const* shared = nullptr);
+    void StartIdleCheck();
+    bool IdleEnabled() const;
+    void UpdateRecvTime();
+    void UpdateSendTime();
     void SetCloseEc(boost_ec const& ec);
     void OnClose();
     void ShutdownSend();
     void ShutdownRecv();
+    void WaitReadable();
+    // unix://的连接, 没有ip地址和tcp选项
+    bool IsUnix();
+
+    // 连接状态位, 合并在一个原子变量中.
+    enum state_bits : uint8_t
+    {
+        st_initiative_shutdown = 0x1,
+        st_send_shutdown = 0x2,
+        st_recv_shutdown = 0x4,
+        st_closed = 0x8,
+        st_close_ec = 0x10,
+        st_send_running = 0x20,
+        st_send_parked = 0x40,     // 常驻发送协程阻塞在msg_chan_上等待消息
+        st_any_shutdown = st_initiative_shutdown | st_send_shutdown | st_recv_shutdown,
+    };
+    // 置位并返回置位前的状态
+    uint8_t SetState(uint8_t bits);
+    void ClearState(uint8_t bits);
+    bool TestState(uint8_t bits) const;
 
 private:
-    shared_ptr<tcp_socket> socket_;
+    // 按大小排列, 减少对齐空洞.
+    tcp_socket socket_;
     shared_ptr<LifeHolder> holder_;
-    Buffer recv_buf_;
-    uint32_t max_pack_size_shrink_;
-    uint32_t max_pack_size_hard_;
-    uint64_t msg_id_;
+    OptionsPtr opt_;
+    shared_ptr<const endpoint::ext_t> ext_;
+    Buffer recv_buf_;       // 首次可读时才分配
     MsgChan msg_chan_;
     MsgList msg_send_list_;
-    co::LFLock send_mtx_;
-    bool sending_;
-    co_mutex close_ec_mutex_;
     boost_ec close_ec_;
+    tcp::endpoint remote_addr_;
+    tcp::endpoint local_addr_;      // 关闭socket前保存, 之后LocalAddr返回它
+    uint64_t msg_id_ = 0;
+    co::atomic_t<uint64_t> last_recv_ts_{0};
+    co::atomic_t<uint64_t> last_send_ts_{0};
+    co::atomic_t<uint32_t> queued_{0};  // msg_chan_中及发送协程手中尚未放入msg_send_list_的消息数
 
-    co::atomic_t<bool> initiative_shutdown_{false};
-    co::atomic_t<bool> send_shutdown_{false};
-    co::atomic_t<bool> recv_shutdown_{false};
-    co_mutex closed_;
+    uint32_t max_pack_size_shrink_;
+    uint32_t max_pack_size_hard_;
+    uint32_t read_idle_timeout_;
+    uint32_t write_idle_timeout_;
+    uint32_t all_idle_timeout_;
 
-    endpoint local_addr_;
-    endpoint remote_addr_;
+    co::atomic_t<uint8_t> state_{0};
+    co::LFLock send_mtx_;
+
+    // 在TcpServer::sessions_中的id
+    SessionId id_ = kInvalidSessionId;
+    friend class TcpServer;
 };
 
 class TcpServer
@@ -98,7 +180,7 @@ class TcpServer
     public boost::enable_shared_from_this<TcpServer>
 {
 public:
-    typedef std::map<::network::SessionEntry, shared_ptr<TcpSession>> Sessions;
+    typedef SessionRegistry<TcpSession> Sessions;
 
     boost_ec goStartBeforeFork(endpoint addr) override;
     void goStartAfterFork() override;
@@ -107,19 +189,53 @@ public:
     void Shutdown(bool immediately = true) override;
     endpoint LocalAddr() override;
     OptionsBase* GetOptions() override { return this; }
+    SessionEntry Lookup(SessionId id) override;
+    bool Send(SessionId id, Buffer && buf, SndCb const& cb) override;
+    bool Send(SessionId id, const void* data, size_t bytes, SndCb const& cb) override;
+    HandshakeStats GetHandshakeStats() override;
+    boost_ec ReloadSSL(OptionSSL const& opt) override;
 
     std::size_t SessionCount();
 
 private:
-    void Accept();
-    void OnSessionClose(::network::SessionEntry id, boost_ec const& ec);
+    // 握手线程池完成握手后, 经由HandoffChan把socket交还给accept协程所在线程上的交接协程.
+    // socket为空表示Shutdown, 交接协程收完仍在握手中的连接后结束.
+    typedef std::pair<shared_ptr<tcp_socket>, boost_ec> Handoff;
+    typedef co::co_chan<Handoff> HandoffChan;
+
+    void Accept(shared_ptr<tcp::acceptor> acceptor, bool pinned,
+            shared_ptr<HandoffChan> handoff);
+    void OnAccept(int fd, tcp const& protocol, tcp_socket_type_t type,
+            bool pinned, shared_ptr<HandoffChan> const& handoff);
+    void DoHandoff(shared_ptr<HandoffChan> handoff, bool pinned);
+    boost_ec ListenUnix(endpoint const& addr, int shards);
+    tcp_context CreateContext(OptionSSL const& opt);
+    tcp_context GetContext();
+    void StartSession(tcp_socket && s, bool local_thread);
+    void OnSessionClose(::network::SessionEntry id, boost_ec const& ec) override;
+    shared_ptr<const endpoint::ext_t> GetEndpointExt() override;
+
+    // 连接数限制在accept之后立即检查, 早于握手和创建TcpSession.
+    bool AcquireConnection();
+    void ReleaseConnection();
+    bool IsFull();
+    void WaitForCapacity();
 
 private:
-    shared_ptr<tcp::acceptor> acceptor_;
+    std::vector<shared_ptr<tcp::acceptor>> acceptors_;
+    tcp_context ctx_;               // ReloadSSL时替换, 由ctx_mtx_保护
+    co::LFLock ctx_mtx_;
+    shared_ptr<HandshakePool> handshake_pool_;
+    std::vector<shared_ptr<HandoffChan>> handoffs_;
     endpoint local_addr_;
-    co_mutex sessions_mutex_;
+    shared_ptr<const endpoint::ext_t> ext_;
     Sessions sessions_;
     co::atomic_t<bool> shutdown_{false};
+    pid_t unix_owner_ = 0;          // 绑定unix socket文件的进程, 只由它在Shutdown时删除文件
+    co::atomic_t<uint32_t> conn_count_{0};
+    co::atomic_t<uint32_t> accept_paused_{0};
+    co::atomic_t<uint32_t> handshaking_{0};     // 已交给握手线程池, 尚未交还的连接数
+    co::co_chan<bool> resume_accept_{64};
     friend TcpSession;
 };
 
@@ -137,11 +253,14 @@ public:
 
     OptionsBase* GetOptions() override { return this; }
 
-private:
-    void OnSessionClose(::network::SessionEntry id, boost_ec const& ec);
+protected:
+    void OnSessionClose(::network::SessionEntry id, boost_ec const& ec) override;
+    shared_ptr<const endpoint::ext_t> GetEndpointExt() override;
 
 private:
     shared_ptr<TcpSession> sess_;
+    shared_ptr<const endpoint::ext_t> ext_;    // 每次Connect新建, 由connect_mtx_保护
+    tcp_context ctx_;   // 同配置的Client共享
     co_mutex connect_mtx_;
     friend TcpSession;
 };
@@ -1,6 +1,9 @@
 #pragma once
 #include "config.h"
 #include "option.h"
+#include "ktls.h"
+#include <map>
+#include <memory>
 
 namespace network {
 
@@ -20,7 +23,7 @@ namespace network {
     };
 
 #if ENABLE_SSL
-    typedef std::unique_ptr<ssl::context> tcp_context;
+    typedef std::shared_ptr<ssl::context> tcp_context;
 #else
     struct tcp_context {};
 #endif
@@ -28,13 +31,13 @@ namespace network {
     class tcp_socket
     {
     public:
+        // 明文socket直接内嵌, 只有ssl连接才额外分配ssl::stream.
         tcp_socket(io_service& ios, tcp_socket_type_t type, tcp_context & ctx)
-            : type_(type)
+            : type_(type), tcp_socket_(ios)
         {
-            if (type_ == tcp_socket_type_t::tcp)
-                tcp_socket_.reset(new tcp::socket(ios));
-            else {
+            if (type_ == tcp_socket_type_t::ssl) {
 #if ENABLE_SSL
+                ctx_ = ctx;
                 tcp_ssl_socket_.reset(new ssl::stream<tcp::socket>(ios, *ctx));
 #else
                 throw std::invalid_argument("Not support ssl, please rebuild libgonet with cmake option: -DENABLE_SSL=ON");
@@ -42,10 +45,12 @@ namespace network {
             }
         }
 
+        tcp_socket(tcp_socket && other) = default;
+
 #if ENABLE_SSL
         static tcp_context create_tcp_context(OptionSSL const& ssl_opt)
         {
-            std::unique_ptr<ssl::context> ctx(new ssl::context((ssl::context::method)ssl_opt.ssl_version));
+            tcp_context ctx(new ssl::context((ssl::context::method)ssl_opt.ssl_version));
 
             // options
             ssl::context::options opt = ssl::context::default_workarounds
@@ -75,13 +80,97 @@ namespace network {
                 ctx->use_private_key_file(ssl_opt.private_key_file, ssl::context::pem);
             if (ssl_opt.tmp_dh_file.size())
                 ctx->use_tmp_dh_file(ssl_opt.tmp_dh_file);
-            return std::move(ctx);
+
+            // session cache & tickets
+            SSL_CTX* native = ctx->native_handle();
+            if (ssl_opt.session_cache_size > 0) {
+                SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_SERVER);
+                SSL_CTX_sess_set_cache_size(native, ssl_opt.session_cache_size);
+            } else {
+                SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_OFF);
+            }
+            if (ssl_opt.session_timeout > 0)
+                SSL_CTX_set_timeout(native, ssl_opt.session_timeout);
+            if (ssl_opt.session_id_context.size()) {
+                std::size_t len = (std::min<std::size_t>)(ssl_opt.session_id_context.size(),
+                        SSL_MAX_SID_CTX_LENGTH);
+                SSL_CTX_set_session_id_context(native,
+                        (const unsigned char*)ssl_opt.session_id_context.data(), len);
+            }
+            if (!ssl_opt.session_tickets)
+                SSL_CTX_set_options(native, SSL_OP_NO_TICKET);
+
+            if (ssl_opt.ktls)
+                Ktls::EnableOn(native);
+            return ctx;
+        }
+
+        // 按OptionSSL的内容共享ssl::context, 相同配置只加载一次证书等文件.
+        // 缓存中只保存weak_ptr, 所有使用者都释放后context随之析构.
+        // 设置了pwd_callback的配置无法比较, 不参与共享.
+        static tcp_context shared_tcp_context(OptionSSL const& ssl_opt)
+        {
+            if (ssl_opt.pwd_callback)
+                return create_tcp_context(ssl_opt);
+
+            typedef std::map<std::string, std::weak_ptr<ssl::context>> Cache;
+            static co::LFLock mtx;
+            static Cache cache;
+
+            std::string key = context_key(ssl_opt);
+            {
+                std::unique_lock<co::LFLock> lock(mtx);
+                auto it = cache.find(key);
+                if (it != cache.end()) {
+                    tcp_context ctx = it->second.lock();
+                    if (ctx) return ctx;
+                }
+            }
+
+            // 加载文件较慢, 不持锁; 并发创建时以先放入缓存的为准.
+            tcp_context ctx = create_tcp_context(ssl_opt);
+            std::unique_lock<co::LFLock> lock(mtx);
+            for (auto it = cache.begin(); it != cache.end();) {
+                if (it->second.expired())
+                    it = cache.erase(it);
+                else
+                    ++it;
+            }
+
+            std::weak_ptr<ssl::context> & slot = cache[key];
+            tcp_context exists = slot.lock();
+            if (exists) return exists;
+            slot = ctx;
+            return ctx;
+        }
+
+        static std::string context_key(OptionSSL const& ssl_opt)
+        {
+            std::string key;
+            key += std::to_string((int)ssl_opt.ssl_version) + "|";
+            key += std::to_string((int)ssl_opt.verify_mode) + "|";
+            key += std::to_string((int)ssl_opt.disable_compression) + "|";
+            key += ssl_opt.certificate_chain_file + "|";
+            key += ssl_opt.private_key_file + "|";
+            key += ssl_opt.tmp_dh_file + "|";
+            key += ssl_opt.verify_file + "|";
+            key += std::to_string(ssl_opt.session_cache_size) + "|";
+            key += std::to_string(ssl_opt.session_timeout) + "|";
+            key += std::to_string((int)ssl_opt.session_tickets) + "|";
+            key += ssl_opt.session_id_context + "|";
+            key += std::to_string((int)ssl_opt.ktls);
+            return key;
         }
 #else
         static tcp_context create_tcp_context(OptionSSL const&)
         {
             return tcp_context();
         }
+
+        static tcp_context shared_tcp_context(OptionSSL const&)
+        {
+            return tcp_context();
+        }
 #endif
 
         tcp_socket_type_t type() const
@@ -89,13 +178,30 @@ namespace network {
             return type_;
         }
 
+        // 握手成功后尝试开启kTLS
+        void set_ktls(bool ktls)
+        {
+            ktls_wanted_ = ktls;
+        }
+
+        bool is_ktls() const
+        {
+            return ktls_;
+        }
+
+        // ssl连接且未卸载到内核, 读写必须经过ssl::stream.
+        bool user_space_tls() const
+        {
+            return type_ == tcp_socket_type_t::ssl && !ktls_;
+        }
+
         tcp::socket& native_socket()
         {
 #if ENABLE_SSL
             if (type_ == tcp_socket_type_t::ssl)
                 return tcp_ssl_socket_->next_layer();
 #endif
-            return *tcp_socket_;
+            return tcp_socket_;
         }
 
         tcp::socket::native_handle_type native_handle()
@@ -103,14 +209,28 @@ namespace network {
             return native_socket().native_handle();
         }
 
+#if ENABLE_SSL
+        // 明文socket返回nullptr
+        SSL* native_ssl()
+        {
+            return tcp_ssl_socket_ ? tcp_ssl_socket_->native_handle() : nullptr;
+        }
+#endif
+
         boost::system::error_code handshake(handshake_type_t type)
         {
             boost::system::error_code ec;
 #if ENABLE_SSL
             if (type_ == tcp_socket_type_t::ssl) {
-                return tcp_ssl_socket_->handshake(
+                if (ktls_wanted_)
+                    Ktls::Prepare(native_ssl());
+
+                tcp_ssl_socket_->handshake(
                         type == handshake_type_t::client ? ssl::stream_base::client : ssl::stream_base::server,
                         ec);
+                if (!ec && ktls_wanted_)
+                    ktls_ = Ktls::Install(native_ssl(), native_handle(), type == handshake_type_t::server);
+                return ec;
             }
 #endif
             return ec;
@@ -120,17 +240,17 @@ namespace network {
         {
             boost::system::error_code ec;
 #if ENABLE_SSL
-            if (type_ == tcp_socket_type_t::ssl)
+            if (user_space_tls())
                 return tcp_ssl_socket_->shutdown(ec);
 #endif
-            return tcp_socket_->shutdown(type, ec);
+            return native_socket().shutdown(type, ec);
         }
 
         boost::system::error_code close()
         {
             boost::system::error_code ec;
 #if ENABLE_SSL
-            if (type_ == tcp_socket_type_t::ssl)
+            if (user_space_tls())
                 tcp_ssl_socket_->shutdown(ec);
 #endif
 
@@ -142,11 +262,11 @@ namespace network {
                     boost::system::error_code& ec)
             {
 #if ENABLE_SSL
-                if (type_ == tcp_socket_type_t::ssl)
+                if (user_space_tls())
                     return tcp_ssl_socket_->read_some(buffers, ec);
 #endif
 
-                return tcp_socket_->read_some(buffers, ec);
+                return native_socket().read_some(buffers, ec);
             }
 
         template <typename ConstBufferSequence>
@@ -154,17 +274,20 @@ namespace network {
                     boost::system::error_code& ec)
             {
 #if ENABLE_SSL
-                if (type_ == tcp_socket_type_t::ssl)
+                if (user_space_tls())
                     return tcp_ssl_socket_->write_some(buffers, ec);
 #endif
 
-                return tcp_socket_->write_some(buffers, ec);
+                return native_socket().write_some(buffers, ec);
             }
 
     private:
         tcp_socket_type_t type_;
-        std::unique_ptr<tcp::socket> tcp_socket_;
+        bool ktls_wanted_ = false;
+        bool ktls_ = false;
+        tcp::socket tcp_socket_;
 #if ENABLE_SSL
+        tcp_context ctx_;   // 连接存在期间保持context(及SNI的主机名context)有效
         std::unique_ptr<ssl::stream<tcp::socket>> tcp_ssl_socket_;
 #endif
     };
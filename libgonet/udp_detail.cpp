@@ -51,6 +51,10 @@ namespace udp_detail {
     {
         return endpoint(remote_addr, proto_type::udp);
     }
+    SessionEntry _udp_sess_id_t::GetSession()
+    {
+        return this->shared_from_this();
+    }
     std::size_t _udp_sess_id_t::GetSendQueueSize()
     {
         return 0;
@@ -121,10 +125,13 @@ namespace udp_detail {
             if (!ec && n > 0) {
                 from_addr.resize(addrlen);
 
-                if (opt_.receive_cb_) {
+                if (opt_.receive_ref_cb_ || opt_.receive_cb_) {
                     udp_sess_id_t sess_id = boost::make_shared<_udp_sess_id_t>(
                             this->shared_from_this(), endpoint(from_addr, local_addr_.ext()));
-                    opt_.receive_cb_(sess_id, &recv_buf_[0], n);
+                    if (opt_.receive_ref_cb_)
+                        opt_.receive_ref_cb_(SessionRef(sess_id.get()), &recv_buf_[0], n);
+                    else
+                        opt_.receive_cb_(sess_id, &recv_buf_[0], n);
                 }
             }
 
@@ -14,7 +14,8 @@ using boost_ec = boost::system::error_code;
 using boost::shared_ptr;
 
 class UdpPoint;
-struct _udp_sess_id_t : public ::network::SessionBase
+struct _udp_sess_id_t : public ::network::SessionBase,
+    public boost::enable_shared_from_this<_udp_sess_id_t>
 {
     shared_ptr<UdpPoint> udp_point;
     endpoint remote_addr;
@@ -32,6 +33,7 @@ struct _udp_sess_id_t : public ::network::SessionBase
     virtual void Shutdown(bool immediately = true) override;
     virtual endpoint LocalAddr() override;
     virtual endpoint RemoteAddr() override;
+    virtual SessionEntry GetSession() override;
     virtual std::size_t GetSendQueueSize() override;
 };
 typedef boost::shared_ptr<_udp_sess_id_t> udp_sess_id_t;
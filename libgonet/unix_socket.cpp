@@ -0,0 +1,95 @@
+#include "unix_socket.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace network {
+
+    static boost_ec ErrnoEc()
+    {
+        return boost_ec(errno, boost::system::system_category());
+    }
+
+    // 抽象命名空间的地址以'\0'开头, 长度不包含结尾, 否则多出的'\0'也是名称的一部分.
+    static socklen_t MakeAddr(std::string const& path, sockaddr_un & addr)
+    {
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        size_t n = (std::min)(path.size(), sizeof(addr.sun_path) - 1);
+        memcpy(addr.sun_path, path.data(), n);
+        if (UnixSocket::IsAbstract(path)) {
+            addr.sun_path[0] = '\0';
+            return offsetof(sockaddr_un, sun_path) + n;
+        }
+        return sizeof(addr);
+    }
+
+    // 文件系统上的socket文件是否还有进程在监听
+    static bool IsStale(std::string const& path)
+    {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode))
+            return false;
+
+        sockaddr_un addr;
+        socklen_t len = MakeAddr(path, addr);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        bool stale = ::connect(fd, (sockaddr*)&addr, len) != 0 && errno == ECONNREFUSED;
+        ::close(fd);
+        return stale;
+    }
+
+    int UnixSocket::Listen(std::string const& path, int backlog, boost_ec & ec)
+    {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            ec = ErrnoEc();
+            return -1;
+        }
+
+        sockaddr_un addr;
+        socklen_t len = MakeAddr(path, addr);
+        int r = ::bind(fd, (sockaddr*)&addr, len);
+        if (r != 0 && errno == EADDRINUSE && !IsAbstract(path) && IsStale(path)) {
+            ::unlink(path.c_str());
+            r = ::bind(fd, (sockaddr*)&addr, len);
+        }
+
+        if (r != 0 || ::listen(fd, backlog) != 0) {
+            ec = ErrnoEc();
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    int UnixSocket::Connect(std::string const& path, boost_ec & ec)
+    {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            ec = ErrnoEc();
+            return -1;
+        }
+
+        sockaddr_un addr;
+        socklen_t len = MakeAddr(path, addr);
+        if (::connect(fd, (sockaddr*)&addr, len) != 0) {
+            ec = ErrnoEc();
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    void UnixSocket::Unlink(std::string const& path)
+    {
+        if (!IsAbstract(path))
+            ::unlink(path.c_str());
+    }
+
+} //namespace network
@@ -0,0 +1,27 @@
+#pragma once
+#include "config.h"
+#include "error.h"
+
+namespace network {
+
+// unix域stream socket(unix://)的创建.
+// 建立的fd直接放入tcp_socket/tcp::acceptor中使用: TcpSession的收发都是对fd的
+// read/writev/sendfile, 与地址族无关, 因此发送队列、空闲检测等与tcp连接完全相同.
+// path以'/'开头为文件系统路径, 以'@'开头为Linux的抽象命名空间(名称中不含'@').
+struct UnixSocket
+{
+    static bool IsAbstract(std::string const& path) { return !path.empty() && path[0] == '@'; }
+
+    // 创建监听socket, 失败时返回-1并设置ec.
+    // 文件系统路径上已存在的socket文件若无人监听(上次进程未清理)则删除后重新绑定,
+    // 仍有进程在监听时返回address_in_use.
+    static int Listen(std::string const& path, int backlog, boost_ec & ec);
+
+    // 连接到path, 失败时返回-1并设置ec.
+    static int Connect(std::string const& path, boost_ec & ec);
+
+    // 监听结束时删除socket文件, 抽象命名空间无需处理.
+    static void Unlink(std::string const& path);
+};
+
+} //namespace network
@@ -0,0 +1,65 @@
+#include "ws.h"
+#include <boost/make_shared.hpp>
+
+namespace network {
+
+    ws::ws()
+        : Protocol(::boost::asio::ip::tcp::v4().family(), proto_type::ws)
+    {}
+
+    boost::shared_ptr<ServerBase> ws::CreateServer()
+    {
+        return boost::make_shared<server>();
+    }
+    boost::shared_ptr<ClientBase> ws::CreateClient()
+    {
+        return boost::make_shared<client>();
+    }
+
+    ws* ws::instance()
+    {
+        static ws obj;
+        return &obj;
+    }
+
+    void WebSocket::Send(SessionRef sess, ws_opcode op, const void* data, size_t bytes,
+            SndCb const& cb)
+    {
+        ws_detail::WsConnection* conn = ws_detail::WsConnection::Get(sess);
+        if (!conn || !conn->IsOpen() || conn->close_sent) {
+            if (cb)
+                cb(MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
+            return ;
+        }
+
+        conn->SendFrame(sess, op, data, bytes, cb);
+    }
+
+    SharedBuffer WebSocket::Frame(ws_opcode op, const void* data, size_t bytes)
+    {
+        boost::shared_ptr<Buffer> buf = boost::make_shared<Buffer>();
+        buf->reserve(WsFrame::kMaxHeaderSize + bytes);
+        WsFrame::Append(*buf, op, data, bytes, false);
+        return buf;
+    }
+
+    void WebSocket::Broadcast(std::vector<SessionEntry> const& sessions, SharedBuffer const& frame)
+    {
+        for (auto const& sess : sessions) {
+            ws_detail::WsConnection* conn = ws_detail::WsConnection::Get(SessionRef(sess.operator->()));
+            if (!conn || conn->is_client || !conn->IsOpen() || conn->close_sent)
+                continue;
+            sess->SendShared(frame);
+        }
+    }
+
+    void WebSocket::Close(SessionRef sess, uint16_t code, string_view reason)
+    {
+        ws_detail::WsConnection* conn = ws_detail::WsConnection::Get(sess);
+        if (!conn || !conn->IsOpen())
+            return ;
+
+        conn->SendClose(sess, code, reason);
+    }
+
+} //namespace network
@@ -0,0 +1,56 @@
+#pragma once
+#include "config.h"
+#include "ws_frame.h"
+#include "ws_detail.h"
+#include "abstract.h"
+
+namespace network {
+
+// ws/wss: 以tcp/ssl为传输层的websocket(RFC 6455), 不支持扩展(permessage-deflate等).
+// 服务端: Server::SetWsMessageCb/SetWsHandshakeCb, 然后goStart("ws://0.0.0.0:8080").
+// 客户端: Client::SetWsMessageCb, 然后Connect("ws://127.0.0.1:8080/chat"), 握手完成后才返回.
+// 发送使用WebSocket的静态函数, 而不是Send(后者不会组帧).
+//
+// 心跳: 未设置HeartbeatCb时, 写空闲(SetWriteIdleTimeout)时发送ping, 对端回应的pong
+// 会刷新读空闲时间, 因此同时设置SetReadIdleTimeout即可检测失去响应的连接.
+class ws : public Protocol
+{
+public:
+    typedef Protocol::endpoint endpoint;
+    typedef ws_detail::WsServer server;
+    typedef ws_detail::WsClient client;
+
+    ws();
+    virtual boost::shared_ptr<ServerBase> CreateServer();
+    virtual boost::shared_ptr<ClientBase> CreateClient();
+
+    static ws* instance();
+};
+
+// 发送工具. sess须为ws/wss连接且已完成握手; 客户端的帧自动加掩码.
+struct WebSocket
+{
+    static void Send(SessionRef sess, ws_opcode op, const void* data, size_t bytes,
+            SndCb const& cb = NULL);
+
+    static void SendText(SessionRef sess, string_view text, SndCb const& cb = NULL)
+    {
+        Send(sess, ws_opcode::text, text.data(), text.size(), cb);
+    }
+
+    static void SendBinary(SessionRef sess, const void* data, size_t bytes, SndCb const& cb = NULL)
+    {
+        Send(sess, ws_opcode::binary, data, bytes, cb);
+    }
+
+    // 预先组好的服务端帧(不带掩码), 可以发给多个连接, 只组帧一次、不复制.
+    static SharedBuffer Frame(ws_opcode op, const void* data, size_t bytes);
+
+    // 把Frame的结果发给所有服务端连接, 客户端连接和未完成握手的连接被跳过.
+    static void Broadcast(std::vector<SessionEntry> const& sessions, SharedBuffer const& frame);
+
+    // 发起关闭: 发送close帧, 收到对端回应的close后关闭连接.
+    static void Close(SessionRef sess, uint16_t code = 1000, string_view reason = string_view());
+};
+
+}//namespace network
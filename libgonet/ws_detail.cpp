@@ -0,0 +1,390 @@
+#include "ws_detail.h"
+#include <ctype.h>
+#include <boost/make_shared.hpp>
+
+namespace network {
+namespace ws_detail {
+
+    static bool IEquals(string_view a, string_view b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+                return false;
+        return true;
+    }
+
+    // 逗号分隔的列表中是否有token, 如Connection: keep-alive, Upgrade
+    static bool HasToken(string_view list, string_view token)
+    {
+        while (!list.empty()) {
+            size_t pos = list.find(',');
+            string_view item = list.substr(0, pos);
+            while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+                item.remove_prefix(1);
+            while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+                item.remove_suffix(1);
+            if (IEquals(item, token))
+                return true;
+            if (pos == string_view::npos)
+                break;
+            list.remove_prefix(pos + 1);
+        }
+        return false;
+    }
+
+    void WsConnection::SendFrame(SessionRef sess, ws_opcode op, const void* data, size_t bytes,
+            SndCb const& cb)
+    {
+        Buffer buf;
+        WsFrame::Append(buf, op, data, bytes, is_client);
+        sess->Send(std::move(buf), cb);
+    }
+
+    bool WsConnection::SendClose(SessionRef sess, uint16_t code, string_view reason)
+    {
+        if (close_sent.exchange(true))
+            return false;
+
+        std::string payload;
+        if (code) {
+            payload += (char)(code >> 8);
+            payload += (char)code;
+            payload.append(reason.data(), (std::min<size_t>)(reason.size(), 123));
+        }
+        SendFrame(sess, ws_opcode::close, payload.data(), payload.size());
+        return true;
+    }
+
+    size_t WsConnection::OnFrames(WsMessageCb const& cb, SessionRef sess, const char* data, size_t bytes)
+    {
+        size_t pos = 0;
+        while (state.load(std::memory_order_relaxed) == st_open) {
+            size_t consumed = 0;
+            WsMessage msg;
+            WsFrameParser::result_t r = frames.Parse(data + pos, bytes - pos, consumed, msg);
+            pos += consumed;
+            if (r == WsFrameParser::incomplete)
+                return pos;
+
+            if (r == WsFrameParser::error) {
+                SendClose(sess, frames.ErrorCode(), "");
+                break;
+            }
+
+            if (r == WsFrameParser::message) {
+                if (cb)
+                    cb(sess, msg);
+                continue;
+            }
+
+            switch (msg.opcode) {
+            case ws_opcode::ping:
+                SendFrame(sess, ws_opcode::pong, msg.data.data(), msg.data.size());
+                break;
+
+            case ws_opcode::pong:
+                // 收到数据时已刷新读空闲时间, 不需要额外处理
+                break;
+
+            default:
+                // close: 交给应用层后回应同样的状态码, 然后关闭.
+                // 由本端发起的关闭, 这里收到的是对端的回应.
+                if (msg.data.size() == 1) {
+                    SendClose(sess, 1002, "");
+                } else {
+                    if (cb)
+                        cb(sess, msg);
+                    uint16_t code = msg.data.size() >= 2
+                        ? (uint16_t)(((uint8_t)msg.data[0] << 8) | (uint8_t)msg.data[1]) : 0;
+                    SendClose(sess, code, "");
+                }
+                state = st_closed;
+                break;
+            }
+        }
+
+        state = st_closed;
+        sess->Shutdown(false);
+        return bytes;
+    }
+
+    WsConnection* WsConnection::Get(SessionRef sess)
+    {
+        boost::shared_ptr<WsConnection>* conn =
+            boost::any_cast<boost::shared_ptr<WsConnection>>(&sess->ProtoStorage());
+        return conn ? conn->get() : nullptr;
+    }
+
+    Buffer WsConnection::Heartbeat(SessionEntry sess)
+    {
+        Buffer buf;
+        WsConnection* conn = Get(SessionRef(sess.operator->()));
+        if (conn && conn->IsOpen() && !conn->close_sent)
+            WsFrame::Append(buf, ws_opcode::ping, nullptr, 0, conn->is_client);
+        return buf;
+    }
+
+    void InstallCallbacks(OptionsData & opt, bool & own_heartbeat, bool server)
+    {
+        WsMessageCb cb = opt.ws_message_cb_;
+        size_t max_message_size = opt.ws_max_message_size_;
+        if (server) {
+            WsHandshakeCb handshake_cb = opt.ws_handshake_cb_;
+            opt.receive_ref_cb_ = [cb, handshake_cb, max_message_size](SessionRef sess, const char* data, size_t bytes) {
+                return WsServer::OnReceive(cb, handshake_cb, max_message_size, sess, data, bytes);
+            };
+        } else {
+            opt.receive_ref_cb_ = [cb, max_message_size](SessionRef sess, const char* data, size_t bytes) {
+                return WsClient::OnReceive(cb, max_message_size, sess, data, bytes);
+            };
+        }
+
+        if (!opt.heartbeat_cb_ || own_heartbeat) {
+            opt.heartbeat_cb_ = &WsConnection::Heartbeat;
+            own_heartbeat = true;
+        }
+    }
+
+    // ------------------------- server -------------------------
+    static void Reject(SessionRef sess, HttpResponse & res)
+    {
+        Buffer out;
+        res.SerializeHead(out, false, 1, false);
+        out.insert(out.end(), res.body.begin(), res.body.end());
+        sess->Send(std::move(out));
+        sess->Shutdown(false);
+    }
+
+    size_t WsServer::OnReceive(WsMessageCb const& cb, WsHandshakeCb const& handshake_cb,
+            size_t max_message_size, SessionRef sess, const char* data, size_t bytes)
+    {
+        WsConnection* conn = WsConnection::Get(sess);
+        if (!conn || conn->state == WsConnection::st_closed)
+            return bytes;
+
+        size_t pos = 0;
+        if (conn->state == WsConnection::st_handshake) {
+            HttpRequestParser::result_t r = conn->req_parser.Parse(data, bytes, conn->req, pos);
+            if (r == HttpRequestParser::incomplete)
+                return 0;
+
+            conn->state = WsConnection::st_closed;
+            HttpResponse res;
+            if (r == HttpRequestParser::error) {
+                res.status = 400;
+                Reject(sess, res);
+                return bytes;
+            }
+
+            HttpRequest const& req = conn->req;
+            string_view key = req.GetHeader("Sec-WebSocket-Key");
+            if (req.method != "GET" || !HasToken(req.GetHeader("Connection"), "upgrade")
+                    || !IEquals(req.GetHeader("Upgrade"), "websocket") || key.empty()) {
+                res.status = 426;
+                res.SetHeader("Upgrade", "websocket");
+                Reject(sess, res);
+                return bytes;
+            }
+
+            if (req.GetHeader("Sec-WebSocket-Version") != "13") {
+                res.status = 426;
+                res.SetHeader("Sec-WebSocket-Version", "13");
+                Reject(sess, res);
+                return bytes;
+            }
+
+            if (handshake_cb && !handshake_cb(sess, req, res)) {
+                if (res.status == 200)
+                    res.status = 403;
+                Reject(sess, res);
+                return bytes;
+            }
+
+            res.status = 101;
+            res.body.clear();
+            res.SetHeader("Upgrade", "websocket");
+            res.SetHeader("Connection", "Upgrade");
+            res.SetHeader("Sec-WebSocket-Accept", WsFrame::AcceptKey(key));
+            Buffer out;
+            res.SerializeHead(out, true, 1, false);
+            sess->Send(std::move(out));
+            conn->state = WsConnection::st_open;
+        }
+
+        conn->frames.SetMaxMessageSize(max_message_size);
+        return pos + conn->OnFrames(cb, sess, data + pos, bytes - pos);
+    }
+
+    boost_ec WsServer::goStartBeforeFork(endpoint addr)
+    {
+        InstallCallbacks();
+        return TcpServer::goStartBeforeFork(addr);
+    }
+
+    void WsServer::OnSessionStart(SessionRef sess)
+    {
+        sess->ProtoStorage() = boost::make_shared<WsConnection>(false);
+    }
+
+    void WsServer::OnSetWsMessageCb()
+    {
+        InstallCallbacks();
+    }
+
+    void WsServer::OnSetWsHandshakeCb()
+    {
+        InstallCallbacks();
+    }
+
+    void WsServer::OnSetWsMaxMessageSize()
+    {
+        InstallCallbacks();
+    }
+
+    void WsServer::OnSetReceiveRefCb()
+    {
+        // 接收回调归协议层所有, 用户设置的回调被覆盖(见network.h).
+        InstallCallbacks();
+    }
+
+    void WsServer::OnSetHeartbeatCb()
+    {
+        own_heartbeat_ = false;
+        InstallCallbacks();
+    }
+
+    void WsServer::InstallCallbacks()
+    {
+        // 直接修改而不经过Set*, 避免再次进入OnSet*.
+        ws_detail::InstallCallbacks(opt_, own_heartbeat_, true);
+        ++version_;
+    }
+
+    // ------------------------- client -------------------------
+    size_t WsClient::OnReceive(WsMessageCb const& cb, size_t max_message_size,
+            SessionRef sess, const char* data, size_t bytes)
+    {
+        WsConnection* conn = WsConnection::Get(sess);
+        if (!conn || conn->state == WsConnection::st_closed)
+            return bytes;
+
+        size_t pos = 0;
+        if (conn->state == WsConnection::st_handshake) {
+            HttpResponseParser::result_t r = conn->res_parser.Parse(data, bytes, conn->res, pos, NULL);
+            if (r == HttpResponseParser::incomplete)
+                return pos;
+
+            HttpClientResponse const& res = conn->res;
+            if (r == HttpResponseParser::error || res.status != 101
+                    || !IEquals(res.GetHeader("Upgrade"), "websocket")
+                    || !HasToken(res.GetHeader("Connection"), "upgrade")
+                    || res.GetHeader("Sec-WebSocket-Accept") != conn->accept) {
+                conn->state = WsConnection::st_closed;
+                conn->done.TryPush(MakeNetworkErrorCode(eNetworkErrorCode::ec_handshake_rejected));
+                sess->Shutdown(false);
+                return bytes;
+            }
+
+            conn->state = WsConnection::st_open;
+            conn->done.TryPush(boost_ec());
+        }
+
+        conn->frames.SetMaxMessageSize(max_message_size);
+        return pos + conn->OnFrames(cb, sess, data + pos, bytes - pos);
+    }
+
+    boost_ec WsClient::Connect(endpoint addr)
+    {
+        std::unique_lock<co_mutex> lock(ws_connect_mtx_, std::defer_lock);
+        if (!lock.try_lock()) return MakeNetworkErrorCode(eNetworkErrorCode::ec_connecting);
+
+        InstallCallbacks();
+        boost::shared_ptr<WsConnection> conn = boost::make_shared<WsConnection>(true);
+        std::string key = WsFrame::NewKey();
+        conn->accept = WsFrame::AcceptKey(key);
+        conn->res_parser.Reset();
+        conn_ = conn;
+
+        boost_ec ec = TcpClient::Connect(addr);
+        if (ec) {
+            conn_.reset();
+            return ec;
+        }
+
+        std::string host;
+#if ENABLE_SSL
+        host = opt_.ssl_option_.server_name;
+#endif
+        if (host.empty())
+            host = addr.address().to_string() + ":" + std::to_string(addr.port());
+        std::string path = addr.path().empty() ? "/" : addr.path();
+        std::string req = "GET " + path + " HTTP/1.1\r\n"
+            "Host: " + host + "\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Key: " + key + "\r\n"
+            "Sec-WebSocket-Version: 13\r\n\r\n";
+        SessionEntry sess = GetSession();
+        sess->Send(req.data(), req.size());
+
+        int timeout = opt_.handshake_timeout_;
+        if (timeout > 0) {
+            if (!conn->done.TimedPop(ec, std::chrono::milliseconds(timeout)))
+                ec = MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_timeout);
+        } else {
+            conn->done >> ec;
+        }
+        conn_.reset();
+
+        if (ec)
+            sess->Shutdown();
+        return ec;
+    }
+
+    void WsClient::OnSessionStart(SessionRef sess)
+    {
+        sess->ProtoStorage() = conn_;
+    }
+
+    void WsClient::OnSessionClose(::network::SessionEntry id, boost_ec const& ec)
+    {
+        // 握手完成前断开, 唤醒Connect
+        WsConnection* conn = WsConnection::Get(SessionRef(id.operator->()));
+        if (conn && conn->state == WsConnection::st_handshake) {
+            conn->state = WsConnection::st_closed;
+            conn->done.TryPush(ec ? ec : MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
+        }
+        TcpClient::OnSessionClose(id, ec);
+    }
+
+    void WsClient::OnSetWsMessageCb()
+    {
+        InstallCallbacks();
+    }
+
+    void WsClient::OnSetWsMaxMessageSize()
+    {
+        InstallCallbacks();
+    }
+
+    void WsClient::OnSetReceiveRefCb()
+    {
+        // 接收回调归协议层所有, 用户设置的回调被覆盖(见network.h).
+        InstallCallbacks();
+    }
+
+    void WsClient::OnSetHeartbeatCb()
+    {
+        own_heartbeat_ = false;
+        InstallCallbacks();
+    }
+
+    void WsClient::InstallCallbacks()
+    {
+        ws_detail::InstallCallbacks(opt_, own_heartbeat_, false);
+        ++version_;
+    }
+
+} //namespace ws_detail
+} //namespace network
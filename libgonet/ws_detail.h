@@ -0,0 +1,117 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+#include "option.h"
+#include "tcp_detail.h"
+#include "http_parser.h"
+#include "http_response.h"
+#include "ws_frame.h"
+#include <atomic>
+
+namespace network {
+namespace ws_detail {
+
+// 每个websocket连接的状态, 在OnSessionStart中放入session的ProtoStorage.
+// 解析器只在接收协程中访问; state/close_sent可能被发送方和心跳读取.
+struct WsConnection
+{
+    enum state_t : uint8_t
+    {
+        st_handshake,
+        st_open,
+        st_closed,
+    };
+
+    explicit WsConnection(bool client) : is_client(client), frames(!client) {}
+
+    bool is_client;
+    std::atomic<uint8_t> state{st_handshake};
+    std::atomic<bool> close_sent{false};
+
+    // 握手
+    HttpRequestParser req_parser;       // 服务端
+    HttpRequest req;
+    HttpResponseParser res_parser;      // 客户端
+    HttpClientResponse res;
+    std::string accept;                 // 客户端期望的Sec-WebSocket-Accept
+    co::co_chan<boost_ec> done{1};      // 客户端握手结果
+
+    WsFrameParser frames;
+
+    bool IsOpen() const { return state.load(std::memory_order_acquire) == st_open; }
+
+    // 客户端发出的帧加掩码
+    void SendFrame(SessionRef sess, ws_opcode op, const void* data, size_t bytes,
+            SndCb const& cb = NULL);
+
+    // 发送close帧, 只发送一次. 返回false表示已经发送过.
+    bool SendClose(SessionRef sess, uint16_t code, string_view reason);
+
+    // 握手完成后处理帧数据, 返回消费的字节数.
+    size_t OnFrames(WsMessageCb const& cb, SessionRef sess, const char* data, size_t bytes);
+
+    // 不是websocket连接时返回nullptr
+    static WsConnection* Get(SessionRef sess);
+
+    // 连接打开后以ping作为心跳包
+    static Buffer Heartbeat(SessionEntry sess);
+};
+
+// 占用接收回调, 未设置心跳回调时以ping作为心跳. @own_heartbeat: 心跳回调是否由引擎设置.
+void InstallCallbacks(OptionsData & opt, bool & own_heartbeat, bool server);
+
+// 基于TcpServer的websocket服务端.
+// 每个连接先按http/1.1接收升级请求, 校验通过后调用WsHandshakeCb, 接受时应答101,
+// 之后按帧处理: 分片合并后交给WsMessageCb, ping自动回pong, close回应后关闭连接.
+// 不是升级请求时应答426.
+class WsServer : public tcp_detail::TcpServer
+{
+public:
+    boost_ec goStartBeforeFork(endpoint addr) override;
+
+    static size_t OnReceive(WsMessageCb const& cb, WsHandshakeCb const& handshake_cb,
+            size_t max_message_size, SessionRef sess, const char* data, size_t bytes);
+
+protected:
+    void OnSessionStart(SessionRef sess) override;
+    void OnSetWsMessageCb() override;
+    void OnSetWsHandshakeCb() override;
+    void OnSetWsMaxMessageSize() override;
+    void OnSetReceiveRefCb() override;
+    void OnSetHeartbeatCb() override;
+
+private:
+    void InstallCallbacks();
+
+    bool own_heartbeat_ = false;
+};
+
+// 基于TcpClient的websocket客户端.
+// Connect在tcp/ssl连接建立后发送升级请求, 等待101应答(最长handshake_timeout_)后才返回.
+// 请求的Host为ssl_option_.server_name或地址:端口, path取自url.
+class WsClient : public tcp_detail::TcpClient
+{
+public:
+    boost_ec Connect(endpoint addr) override;
+
+    static size_t OnReceive(WsMessageCb const& cb, size_t max_message_size,
+            SessionRef sess, const char* data, size_t bytes);
+
+protected:
+    void OnSessionStart(SessionRef sess) override;
+    void OnSessionClose(::network::SessionEntry id, boost_ec const& ec) override;
+    void OnSetWsMessageCb() override;
+    void OnSetWsMaxMessageSize() override;
+    void OnSetReceiveRefCb() override;
+    void OnSetHeartbeatCb() override;
+
+private:
+    void InstallCallbacks();
+
+    boost::shared_ptr<WsConnection> conn_;  // 正在建立的连接
+    co_mutex ws_connect_mtx_;
+    bool own_heartbeat_ = false;
+};
+
+} //namespace ws_detail
+} //namespace network
@@ -0,0 +1,377 @@
+#include "ws_frame.h"
+#include <string.h>
+#include <random>
+#if defined(__x86_64__) || defined(__i386__)
+# define WS_MASK_X86 1
+# include <immintrin.h>
+#else
+# define WS_MASK_X86 0
+#endif
+
+namespace network {
+
+    // 按offset旋转后的4字节掩码, 使每个4字节对齐的块都从key[0]开始.
+    static inline uint32_t RotateKey(const char key[4], size_t offset)
+    {
+        char k[4];
+        for (int i = 0; i < 4; ++i)
+            k[i] = key[(offset + i) & 3];
+        uint32_t k32;
+        memcpy(&k32, k, 4);
+        return k32;
+    }
+
+    static inline void MaskTail(char* dst, const char* src, size_t bytes, uint32_t k32)
+    {
+        uint64_t k64 = ((uint64_t)k32 << 32) | k32;
+        size_t i = 0;
+        for (; i + 8 <= bytes; i += 8) {
+            uint64_t v;
+            memcpy(&v, src + i, 8);
+            v ^= k64;
+            memcpy(dst + i, &v, 8);
+        }
+        const char* k = (const char*)&k32;
+        for (; i < bytes; ++i)
+            dst[i] = src[i] ^ k[i & 3];
+    }
+
+    typedef void (*MaskFn)(char* dst, const char* src, size_t bytes, uint32_t k32);
+
+    static void MaskScalar(char* dst, const char* src, size_t bytes, uint32_t k32)
+    {
+        MaskTail(dst, src, bytes, k32);
+    }
+
+#if WS_MASK_X86
+    __attribute__((target("sse2")))
+    static void MaskSse2(char* dst, const char* src, size_t bytes, uint32_t k32)
+    {
+        const __m128i k = _mm_set1_epi32((int)k32);
+        size_t i = 0;
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(b, k));
+        }
+        MaskTail(dst + i, src + i, bytes - i, k32);
+    }
+
+    __attribute__((target("avx2")))
+    static void MaskAvx2(char* dst, const char* src, size_t bytes, uint32_t k32)
+    {
+        const __m256i k = _mm256_set1_epi32((int)k32);
+        size_t i = 0;
+        for (; i + 64 <= bytes; i += 64) {
+            __m256i b0 = _mm256_loadu_si256((const __m256i*)(src + i));
+            __m256i b1 = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(b0, k));
+            _mm256_storeu_si256((__m256i*)(dst + i + 32), _mm256_xor_si256(b1, k));
+        }
+        for (; i + 32 <= bytes; i += 32) {
+            __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(b, k));
+        }
+        MaskTail(dst + i, src + i, bytes - i, k32);
+    }
+
+    static MaskFn DetectMask()
+    {
+        if (__builtin_cpu_supports("avx2"))
+            return &MaskAvx2;
+        if (__builtin_cpu_supports("sse2"))
+            return &MaskSse2;
+        return &MaskScalar;
+    }
+#else
+    static MaskFn DetectMask() { return &MaskScalar; }
+#endif
+
+    void WsFrame::Mask(char* dst, const char* src, size_t bytes, const char key[4], size_t offset)
+    {
+        static const MaskFn fn = DetectMask();
+        uint32_t k32 = RotateKey(key, offset);
+        // 短payload(多数控制帧和小消息)不值得间接调用
+        if (bytes < 16)
+            MaskTail(dst, src, bytes, k32);
+        else
+            fn(dst, src, bytes, k32);
+    }
+
+    static std::mt19937& Random()
+    {
+        static thread_local std::mt19937 rng{std::random_device{}()};
+        return rng;
+    }
+
+    void WsFrame::Append(Buffer & out, ws_opcode op, const void* data, size_t bytes,
+            bool masked, bool fin)
+    {
+        char head[kMaxHeaderSize];
+        size_t pos = 0;
+        head[pos++] = (char)((fin ? 0x80 : 0) | (uint8_t)op);
+        uint8_t mask_bit = masked ? 0x80 : 0;
+        if (bytes < 126) {
+            head[pos++] = (char)(mask_bit | bytes);
+        } else if (bytes <= 0xffff) {
+            head[pos++] = (char)(mask_bit | 126);
+            head[pos++] = (char)(bytes >> 8);
+            head[pos++] = (char)bytes;
+        } else {
+            head[pos++] = (char)(mask_bit | 127);
+            for (int i = 7; i >= 0; --i)
+                head[pos++] = (char)((uint64_t)bytes >> (i * 8));
+        }
+
+        char key[4];
+        if (masked) {
+            uint32_t r = Random()();
+            memcpy(key, &r, 4);
+            memcpy(head + pos, key, 4);
+            pos += 4;
+        }
+
+        size_t old = out.size();
+        out.resize(old + pos + bytes);
+        memcpy(&out[old], head, pos);
+        if (!bytes)
+            return ;
+        if (masked)
+            Mask(&out[old + pos], (const char*)data, bytes, key, 0);
+        else
+            memcpy(&out[old + pos], data, bytes);
+    }
+
+    static const char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    static std::string Base64(const unsigned char* data, size_t bytes)
+    {
+        std::string out;
+        out.reserve((bytes + 2) / 3 * 4);
+        size_t i = 0;
+        for (; i + 3 <= bytes; i += 3) {
+            uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+            out += kBase64[v >> 18];
+            out += kBase64[(v >> 12) & 0x3f];
+            out += kBase64[(v >> 6) & 0x3f];
+            out += kBase64[v & 0x3f];
+        }
+        if (bytes - i == 1) {
+            uint32_t v = data[i] << 16;
+            out += kBase64[v >> 18];
+            out += kBase64[(v >> 12) & 0x3f];
+            out += "==";
+        } else if (bytes - i == 2) {
+            uint32_t v = (data[i] << 16) | (data[i + 1] << 8);
+            out += kBase64[v >> 18];
+            out += kBase64[(v >> 12) & 0x3f];
+            out += kBase64[(v >> 6) & 0x3f];
+            out += '=';
+        }
+        return out;
+    }
+
+    // 握手只需要SHA-1, 不依赖openssl, ENABLE_SSL=0时也可用.
+    static void Sha1(const unsigned char* data, size_t bytes, unsigned char digest[20])
+    {
+        uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        std::string msg((const char*)data, bytes);
+        msg += (char)0x80;
+        while (msg.size() % 64 != 56)
+            msg += (char)0;
+        uint64_t bits = (uint64_t)bytes * 8;
+        for (int i = 7; i >= 0; --i)
+            msg += (char)(bits >> (i * 8));
+
+        auto rol = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+        for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+            const unsigned char* p = (const unsigned char*)msg.data() + chunk;
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i)
+                w[i] = (p[i * 4] << 24) | (p[i * 4 + 1] << 16) | (p[i * 4 + 2] << 8) | p[i * 4 + 3];
+            for (int i = 16; i < 80; ++i)
+                w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i) {
+                uint32_t f, k;
+                if (i < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                } else if (i < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                } else if (i < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                } else {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+                uint32_t t = rol(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = rol(b, 30);
+                b = a;
+                a = t;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        }
+        for (int i = 0; i < 5; ++i)
+            for (int j = 0; j < 4; ++j)
+                digest[i * 4 + j] = (unsigned char)(h[i] >> (24 - j * 8));
+    }
+
+    std::string WsFrame::NewKey()
+    {
+        unsigned char nonce[16];
+        for (int i = 0; i < 16; i += 4) {
+            uint32_t r = Random()();
+            memcpy(nonce + i, &r, 4);
+        }
+        return Base64(nonce, sizeof(nonce));
+    }
+
+    std::string WsFrame::AcceptKey(string_view key)
+    {
+        std::string s(key.data(), key.size());
+        s += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        unsigned char digest[20];
+        Sha1((const unsigned char*)s.data(), s.size(), digest);
+        return Base64(digest, sizeof(digest));
+    }
+
+    WsFrameParser::result_t WsFrameParser::Fail(uint16_t code)
+    {
+        error_code_ = code;
+        return error;
+    }
+
+    WsFrameParser::result_t WsFrameParser::Parse(const char* data, size_t bytes,
+            size_t & consumed, WsMessage & out)
+    {
+        consumed = 0;
+        if (error_code_)
+            return error;
+
+        for (;;) {
+            if (state_ == st_header) {
+                if (bytes - consumed < 2)
+                    return incomplete;
+
+                const uint8_t* p = (const uint8_t*)data + consumed;
+                if (p[0] & 0x70)    // RSV1-3, 没有协商扩展
+                    return Fail(1002);
+                bool fin = p[0] & 0x80;
+                ws_opcode op = (ws_opcode)(p[0] & 0x0f);
+                switch (op) {
+                case ws_opcode::continuation:
+                case ws_opcode::text:
+                case ws_opcode::binary:
+                case ws_opcode::close:
+                case ws_opcode::ping:
+                case ws_opcode::pong:
+                    break;
+                default:
+                    return Fail(1002);
+                }
+
+                bool masked = p[1] & 0x80;
+                if (masked != masked_)
+                    return Fail(1002);
+
+                uint64_t len = p[1] & 0x7f;
+                size_t head = 2 + (len == 126 ? 2 : len == 127 ? 8 : 0) + (masked ? 4 : 0);
+                if (bytes - consumed < head)
+                    return incomplete;
+
+                p += 2;
+                if (len == 126) {
+                    len = (p[0] << 8) | p[1];
+                    p += 2;
+                } else if (len == 127) {
+                    len = 0;
+                    for (int i = 0; i < 8; ++i)
+                        len = (len << 8) | p[i];
+                    p += 8;
+                    if (len >> 63)
+                        return Fail(1002);
+                }
+
+                bool is_control = (uint8_t)op & 0x08;
+                if (is_control) {
+                    if (!fin || len > 125)
+                        return Fail(1002);
+                } else if (op == ws_opcode::continuation) {
+                    if (!in_message_)
+                        return Fail(1002);
+                    if (msg_.size() + len > max_message_size_)
+                        return Fail(1009);
+                } else {
+                    if (in_message_)
+                        return Fail(1002);
+                    if (len > max_message_size_)
+                        return Fail(1009);
+                    msg_opcode_ = op;
+                    msg_.clear();
+                }
+
+                if (masked)
+                    memcpy(key_, p, 4);
+                consumed += head;
+
+                // 不带掩码的完整单帧直接返回, 不复制
+                if (!masked && bytes - consumed >= len && (is_control || (fin && !in_message_))) {
+                    out.opcode = op;
+                    out.data = string_view(data + consumed, len);
+                    consumed += len;
+                    return is_control ? control : message;
+                }
+
+                op_ = op;
+                fin_ = fin;
+                left_ = len;
+                offset_ = 0;
+                if (is_control)
+                    ctrl_.clear();
+                else
+                    in_message_ = true;
+                state_ = st_payload;
+            }
+
+            std::string & target = ((uint8_t)op_ & 0x08) ? ctrl_ : msg_;
+            size_t n = (size_t)(std::min<uint64_t>)(left_, bytes - consumed);
+            if (n) {
+                size_t old = target.size();
+                target.resize(old + n);
+                if (masked_)
+                    WsFrame::Mask(&target[old], data + consumed, n, key_, (size_t)offset_);
+                else
+                    memcpy(&target[old], data + consumed, n);
+                consumed += n;
+                offset_ += n;
+                left_ -= n;
+            }
+            if (left_)
+                return incomplete;
+
+            state_ = st_header;
+            if ((uint8_t)op_ & 0x08) {
+                out.opcode = op_;
+                out.data = string_view(ctrl_.data(), ctrl_.size());
+                return control;
+            }
+
+            if (fin_) {
+                in_message_ = false;
+                out.opcode = msg_opcode_;
+                out.data = string_view(msg_.data(), msg_.size());
+                return message;
+            }
+        }
+    }
+
+} //namespace network
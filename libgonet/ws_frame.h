@@ -0,0 +1,95 @@
+#pragma once
+#include "config.h"
+#include "abstract.h"
+#include "http_parser.h"
+
+namespace network {
+
+enum class ws_opcode : uint8_t
+{
+    continuation = 0x0,
+    text = 0x1,
+    binary = 0x2,
+    close = 0x8,
+    ping = 0x9,
+    pong = 0xa,
+};
+
+// 一条完整的websocket消息. data只在回调期间有效, 需要保存时请复制.
+// text消息不校验utf-8.
+struct WsMessage
+{
+    ws_opcode opcode = ws_opcode::binary;
+    string_view data;
+};
+
+// 帧的编码和掩码等无状态工具
+struct WsFrame
+{
+    // 帧头的最大长度: 2 + 8(长度) + 4(掩码)
+    static const size_t kMaxHeaderSize = 14;
+
+    // 把一个完整的帧追加到out. @masked: 客户端发出的帧必须加掩码, 掩码随机生成.
+    static void Append(Buffer & out, ws_opcode op, const void* data, size_t bytes,
+            bool masked, bool fin = true);
+
+    // 对src做掩码(异或)写入dst, dst可以等于src.
+    // @offset: src在整个payload中的偏移, 用于分段处理时对齐掩码.
+    // x86上按cpu使用avx2/sse2, 每次处理32/16字节.
+    static void Mask(char* dst, const char* src, size_t bytes, const char key[4], size_t offset);
+
+    // 握手: 客户端随机生成的Sec-WebSocket-Key, 及对应的Sec-WebSocket-Accept.
+    static std::string NewKey();
+    static std::string AcceptKey(string_view key);
+};
+
+// 增量式帧解析器, 每个连接一个, 合并分片, 控制帧可以穿插在分片之间.
+// 与HttpResponseParser一样边收边消费, 消息可以大于接收缓冲区.
+class WsFrameParser
+{
+public:
+    enum result_t
+    {
+        message,        // 收到完整的数据消息
+        control,        // 收到控制帧(close/ping/pong)
+        incomplete,
+        error,          // 协议错误, ErrorCode()为应发送的关闭码
+    };
+
+    // @masked: 对端的帧是否带掩码, 即本端是服务端.
+    explicit WsFrameParser(bool masked = true) : masked_(masked) {}
+
+    void SetMaxMessageSize(size_t size) { max_message_size_ = size; }
+
+    // @consumed: 本次消费的字节数, 返回incomplete时也可能消费了部分数据.
+    // @out: 返回message/control时有效, 直到下一次调用Parse.
+    // 不带掩码且完整在data中的单帧消息直接指向data, 不复制.
+    result_t Parse(const char* data, size_t bytes, size_t & consumed, WsMessage & out);
+
+    uint16_t ErrorCode() const { return error_code_; }
+
+private:
+    result_t Fail(uint16_t code);
+
+    enum state_t : uint8_t
+    {
+        st_header,
+        st_payload,
+    };
+
+    std::string msg_;           // 合并中的数据消息
+    std::string ctrl_;          // 控制帧payload
+    uint64_t left_ = 0;         // 当前帧剩余的payload
+    uint64_t offset_ = 0;       // 当前帧已收到的payload, 用于对齐掩码
+    size_t max_message_size_ = 16 * 1024 * 1024;
+    char key_[4] = {0, 0, 0, 0};
+    uint16_t error_code_ = 0;
+    state_t state_ = st_header;
+    ws_opcode op_ = ws_opcode::binary;
+    ws_opcode msg_opcode_ = ws_opcode::binary;
+    bool masked_;
+    bool fin_ = true;
+    bool in_message_ = false;   // 正在合并分片
+};
+
+} //namespace network
@@ -0,0 +1,232 @@
+/**************************************************
+* h2c压测: 进程内启动开启SetHttp2的http服务端, 每个连接上
+* 保持Streams个并发的流, 一个流的应答收齐后立即在新流上发出下一个请求(闭环),
+* 统计每秒完成的请求数和每个请求的平均延迟. 与httpbench对比http/1.1 pipelining.
+**************************************************/
+#include <iostream>
+#include <unistd.h>
+#include <string.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+std::string g_url = "http://127.0.0.1:9003";
+std::atomic<unsigned long long> g_requests{0};
+std::atomic<unsigned long long> g_latency_us{0};
+std::atomic<unsigned long long> g_errors{0};
+
+int g_thread_count = 1;
+int g_concurrency = 16;
+int g_streams = 16;
+
+static const uint32_t kWindowSize = 16 * 1024 * 1024;
+
+static uint64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void start_server(std::string url)
+{
+    Server s;
+    s.SetListenBacklog(4096);
+    s.SetHttp2(true).SetHttp2MaxConcurrentStreams((std::max)(g_streams, 100));
+    s.SetHttpCb([](SessionRef, HttpRequest const&, HttpResponse & res){
+                res.SetHeader("Content-Type", "text/plain");
+                res.body = "hello world!";
+            });
+    boost_ec ec = s.goStart(url);
+    if (ec) {
+        printf("server start error: %s\n", ec.message().c_str());
+        exit(1);
+    }
+
+    for (;;)
+        co_sleep(10000);
+}
+
+// 一个h2c客户端连接的状态, 只在接收回调中访问.
+struct H2Client
+{
+    Buffer request;             // 预先编码的头部块, 编码不使用动态表, 可以重复发送
+    HpackDecoder decoder;
+    std::map<uint32_t, uint64_t> streams;   // stream id -> 发出时间
+    uint32_t next_id = 1;
+    uint32_t consumed = 0;      // 尚未归还的连接级窗口
+
+    void NewStream(Buffer & out)
+    {
+        streams[next_id] = now_us();
+        Http2Frame::AppendHeaders(out, next_id, request.data(), request.size(), true,
+                Http2Frame::kDefaultMaxFrameSize);
+        next_id += 2;
+    }
+
+    void EndStream(Buffer & out, uint32_t id)
+    {
+        auto it = streams.find(id);
+        if (it == streams.end()) return ;
+        ++g_requests;
+        g_latency_us += now_us() - it->second;
+        streams.erase(it);
+        NewStream(out);
+    }
+
+    size_t OnReceive(SessionEntry sess, const char* data, size_t bytes)
+    {
+        Buffer out;
+        size_t pos = 0;
+        while (bytes - pos >= Http2Frame::kHeaderSize) {
+            Http2FrameHeader h = Http2Frame::ParseHeader(data + pos);
+            if (bytes - pos < Http2Frame::kHeaderSize + h.length)
+                break;
+            const char* payload = data + pos + Http2Frame::kHeaderSize;
+            pos += Http2Frame::kHeaderSize + h.length;
+
+            switch (h.type) {
+            case h2_frame::settings:
+                if (!(h.flags & h2_ack))
+                    Http2Frame::AppendSettingsAck(out);
+                break;
+
+            case h2_frame::headers:
+                {
+                    Hpack::Headers headers;
+                    if (!decoder.Decode((const uint8_t*)payload, h.length, headers)
+                            || headers.empty() || headers[0].second != "200")
+                        ++g_errors;
+                    if (h.flags & h2_end_stream)
+                        EndStream(out, h.stream_id);
+                }
+                break;
+
+            case h2_frame::data:
+                consumed += h.length;
+                if (h.flags & h2_end_stream)
+                    EndStream(out, h.stream_id);
+                break;
+
+            case h2_frame::rst_stream:
+            case h2_frame::goaway:
+                ++g_errors;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (consumed >= kWindowSize / 2) {
+            Http2Frame::AppendWindowUpdate(out, 0, consumed);
+            consumed = 0;
+        }
+        if (!out.empty())
+            sess->Send(std::move(out));
+        return pos;
+    }
+};
+
+void start_client(std::string url)
+{
+    endpoint addr;
+    boost_ec ec;
+    addr = endpoint::from_string(url, ec);
+    std::string tcp_url = "tcp://" + addr.address().to_string() + ":" + std::to_string(addr.port());
+
+    H2Client h2;
+    Hpack::Encode(h2.request, ":method", "GET");
+    Hpack::Encode(h2.request, ":scheme", "http");
+    Hpack::Encode(h2.request, ":path", "/");
+    Hpack::Encode(h2.request, ":authority", addr.address().to_string());
+
+    Client c;
+    c.SetReceiveCb([&](SessionEntry sess, const char* data, size_t bytes){
+                return h2.OnReceive(sess, data, bytes);
+            });
+    ec = c.Connect(tcp_url);
+    if (ec) {
+        ++g_errors;
+        printf("client connect error: %s\n", ec.message().c_str());
+        return ;
+    }
+
+    Buffer out(Http2Frame::kPreface, Http2Frame::kPreface + Http2Frame::kPrefaceSize);
+    Http2Frame::AppendSettings(out, {{h2_setting::enable_push, 0},
+            {h2_setting::initial_window_size, kWindowSize}});
+    Http2Frame::AppendWindowUpdate(out, 0, kWindowSize - Http2Frame::kDefaultWindowSize);
+    for (int i = 0; i < g_streams; ++i)
+        h2.NewStream(out);
+    c.Send(std::move(out));
+
+    while (c.IsEstab())
+        co_sleep(1000);
+    ++g_errors;
+}
+
+void show_status()
+{
+    static int s_c = 0;
+    if (s_c++ % 10 == 0) {
+        // print title
+        printf("--------------------------------------------------------------------------------------------------------\n");
+        printf("------------- start Connections=%d, Streams=%d, Threads=%d URL=%s -------------\n",
+                g_concurrency, g_streams, g_thread_count, g_url.c_str());
+        printf(" index |  requests/s  | avg latency(us) | errors\n");
+    }
+
+    static unsigned long long last_requests{0};
+    static unsigned long long last_latency_us{0};
+
+    unsigned long long requests = g_requests - last_requests;
+    unsigned long long latency = g_latency_us - last_latency_us;
+
+    printf("%6d | %12llu | %15llu | %6llu\n",
+            s_c, requests, requests ? latency / requests : 0, (unsigned long long)g_errors);
+
+    last_requests = g_requests;
+    last_latency_us = g_latency_us;
+
+    co_timer_add(std::chrono::seconds(1), [=]{ show_status(); });
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && argv[1] == std::string("-h")) {
+        printf("Usage %s [Connections] [Streams] [Threads] [URL]\n\n", argv[0]);
+        printf("Defaults [Connections=%d] [Streams=%d] [Threads=%d] [URL=%s]\n\n",
+                g_concurrency, g_streams, g_thread_count, g_url.c_str());
+        return 1;
+    }
+
+    if (argc > 1)
+        g_concurrency = atoi(argv[1]);
+
+    if (argc > 2)
+        g_streams = (std::max)(atoi(argv[2]), 1);
+
+    if (argc > 3)
+        g_thread_count = atoi(argv[3]);
+
+    if (argc > 4)
+        g_url = argv[4];
+
+    go [&]{ start_server(g_url); };
+    for (int i = 0; i < g_concurrency; ++i)
+        go [&]{
+            co_sleep(100);
+            start_client(g_url);
+        };
+
+    co_timer_add(std::chrono::milliseconds(100), [=]{ show_status(); });
+    boost::thread_group tg;
+    for (int i = 0; i < g_thread_count; ++i)
+        tg.create_thread([]{ co_sched.RunLoop(); });
+    tg.join_all();
+    return 0;
+}
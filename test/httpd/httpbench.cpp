@@ -0,0 +1,172 @@
+/**************************************************
+* http压测: 进程内启动http服务端, 每个连接循环地
+* 一次发出Pipeline个GET请求, 收齐应答后再发下一批(同wrk的闭环模型),
+* 统计每秒完成的请求数和每批请求的平均延迟.
+**************************************************/
+#include <iostream>
+#include <unistd.h>
+#include <string.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+std::string g_url = "http://127.0.0.1:9002";
+std::atomic<unsigned long long> g_requests{0};
+std::atomic<unsigned long long> g_batches{0};
+std::atomic<unsigned long long> g_latency_us{0};
+std::atomic<unsigned long long> g_errors{0};
+
+int g_thread_count = 1;
+int g_concurrency = 64;
+int g_pipeline = 1;
+
+static uint64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void start_server(std::string url)
+{
+    Server s;
+    s.SetListenBacklog(4096);
+    s.SetHttpCb([](SessionRef, HttpRequest const&, HttpResponse & res){
+                res.SetHeader("Content-Type", "text/plain");
+                res.body = "hello world!";
+            });
+    boost_ec ec = s.goStart(url);
+    if (ec) {
+        printf("server start error: %s\n", ec.message().c_str());
+        exit(1);
+    }
+
+    for (;;)
+        co_sleep(10000);
+}
+
+// 解析完整的应答, 返回消费的字节数
+static size_t count_responses(const char* data, size_t bytes, int & responses)
+{
+    size_t pos = 0;
+    for (;;) {
+        const char* begin = data + pos;
+        const char* end = (const char*)memmem(begin, bytes - pos, "\r\n\r\n", 4);
+        if (!end) break;
+        size_t head = end + 4 - begin;
+        const char* cl = (const char*)memmem(begin, head, "Content-Length: ", 16);
+        size_t length = cl ? strtoul(cl + 16, nullptr, 10) : 0;
+        if (bytes - pos < head + length) break;
+        pos += head + length;
+        ++responses;
+    }
+    return pos;
+}
+
+void start_client(std::string url)
+{
+    endpoint addr;
+    boost_ec ec;
+    addr = endpoint::from_string(url, ec);
+    std::string tcp_url = "tcp://" + addr.address().to_string() + ":" + std::to_string(addr.port());
+
+    std::string batch;
+    for (int i = 0; i < g_pipeline; ++i)
+        batch += "GET / HTTP/1.1\r\nHost: " + addr.address().to_string() + "\r\n\r\n";
+
+    int responses = 0;
+    uint64_t start = 0;
+    Client c;
+    c.SetReceiveCb([&](SessionEntry sess, const char* data, size_t bytes){
+                size_t consumed = count_responses(data, bytes, responses);
+                if (responses >= g_pipeline) {
+                    g_requests += responses;
+                    ++g_batches;
+                    g_latency_us += now_us() - start;
+                    responses = 0;
+                    start = now_us();
+                    sess->Send(batch.data(), batch.size());
+                }
+                return consumed;
+            });
+    ec = c.Connect(tcp_url);
+    if (ec) {
+        ++g_errors;
+        printf("client connect error: %s\n", ec.message().c_str());
+        return ;
+    }
+
+    start = now_us();
+    c.Send(batch.data(), batch.size());
+    while (c.IsEstab())
+        co_sleep(1000);
+    ++g_errors;
+}
+
+void show_status()
+{
+    static int s_c = 0;
+    if (s_c++ % 10 == 0) {
+        // print title
+        printf("--------------------------------------------------------------------------------------------------------\n");
+        printf("------------- start Concurrency=%d, Pipeline=%d, Threads=%d URL=%s -------------\n",
+                g_concurrency, g_pipeline, g_thread_count, g_url.c_str());
+        printf(" index |  requests/s  | avg latency(us) | errors\n");
+    }
+
+    static unsigned long long last_requests{0};
+    static unsigned long long last_batches{0};
+    static unsigned long long last_latency_us{0};
+
+    unsigned long long requests = g_requests - last_requests;
+    unsigned long long batches = g_batches - last_batches;
+    unsigned long long latency = g_latency_us - last_latency_us;
+
+    printf("%6d | %12llu | %15llu | %6llu\n",
+            s_c, requests, batches ? latency / batches : 0, (unsigned long long)g_errors);
+
+    last_requests = g_requests;
+    last_batches = g_batches;
+    last_latency_us = g_latency_us;
+
+    co_timer_add(std::chrono::seconds(1), [=]{ show_status(); });
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && argv[1] == std::string("-h")) {
+        printf("Usage %s [Concurrency] [Pipeline] [Threads] [URL]\n\n", argv[0]);
+        printf("Defaults [Concurrency=%d] [Pipeline=%d] [Threads=%d] [URL=%s]\n\n",
+                g_concurrency, g_pipeline, g_thread_count, g_url.c_str());
+        return 1;
+    }
+
+    if (argc > 1)
+        g_concurrency = atoi(argv[1]);
+
+    if (argc > 2)
+        g_pipeline = (std::max)(atoi(argv[2]), 1);
+
+    if (argc > 3)
+        g_thread_count = atoi(argv[3]);
+
+    if (argc > 4)
+        g_url = argv[4];
+
+    go [&]{ start_server(g_url); };
+    for (int i = 0; i < g_concurrency; ++i)
+        go [&]{
+            co_sleep(100);
+            start_client(g_url);
+        };
+
+    co_timer_add(std::chrono::milliseconds(100), [=]{ show_status(); });
+    boost::thread_group tg;
+    for (int i = 0; i < g_thread_count; ++i)
+        tg.create_thread([]{ co_sched.RunLoop(); });
+    tg.join_all();
+    return 0;
+}
@@ -10,19 +10,11 @@ using namespace network;
 
 int main(int argc, char** argv)
 {
-    std::string url = "tcp://127.0.0.1:9001";
+    std::string url = "http://127.0.0.1:9001";
     if (argc > 1) {
         url = argv[1];
     }
 
-    std::string html = "HTTP/1.1 200 OK\r\n\
-Date: Fri, 19 Aug 2016 16:25:26 GMT\r\n\
-Server: libgonet\r\n\
-Content-Type: text/html\r\n\
-Content-Length: 12\r\n\
-Connection: Keep-Alive\r\n\r\n\
-hello world!";
-
     Server server;
 
     int connection = 0;
@@ -40,18 +32,10 @@ hello world!";
         if (!connection)
             ProfilerStop();
 #endif
-    }).SetReceiveCb([&](SessionEntry sess, const char* data, size_t bytes){
-        // find http header split chars
-//        static const char* splits = "\r\n\r\n";
-//        for (int i = (int)bytes - 4; i >= 0; --i) {
-//            if (*(int*)(data + i) == *(const int*)(const char*)(&splits[0])) {
-                // http header
-                sess->SendNoDelay(html.c_str(), html.length());
-                return bytes;
-//            }
-//        }
-//
-//        return bytes - 3;
+    }).SetHttpCb([&](SessionRef, HttpRequest const&, HttpResponse & res){
+        res.SetHeader("Server", "libgonet")
+            .SetHeader("Content-Type", "text/html");
+        res.body = "hello world!";
     });
     boost_ec ec = server.goStart(url);
     if (ec) {
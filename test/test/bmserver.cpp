@@ -28,6 +28,7 @@ int g_package = 64;
 int g_max_pack = 0;
 bool g_nodelay_flag = false;
 int g_thread_count = 1;
+int g_accept_shards = 0;
 
 void start_server(std::string url)
 {
@@ -42,6 +43,7 @@ void start_server(std::string url)
 #endif
 
     s.SetListenBacklog(1024);
+    s.SetAcceptShards(g_accept_shards);
     s.SetMaxPackSize(recv_buffer_length);
     s.SetMaxPackSizeHard(-1);
     s.SetDisconnectedCb([&](SessionEntry, boost_ec const& ec){
@@ -159,9 +161,9 @@ int main(int argc, char** argv)
     co_sched.GetOptions().enable_work_steal = false;
 
     if (argc > 1 && argv[1] == std::string("-h")) {
-        printf("Usage %s [PackageSize] [NoDelay] [recv_buffer_length(KB)] [Threads] [URL]\n\n", argv[0]);
-        printf("Defaults [PackageSize=%d] [NoDelay=%d] [recv_buffer_length=%d(KB)] [Threads=%d] [URL=%s]\n\n",
-                g_package, g_nodelay_flag, recv_buffer_length / 1024, g_thread_count, g_url.c_str());
+        printf("Usage %s [PackageSize] [NoDelay] [recv_buffer_length(KB)] [Threads] [URL] [AcceptShards]\n\n", argv[0]);
+        printf("Defaults [PackageSize=%d] [NoDelay=%d] [recv_buffer_length=%d(KB)] [Threads=%d] [URL=%s] [AcceptShards=%d]\n\n",
+                g_package, g_nodelay_flag, recv_buffer_length / 1024, g_thread_count, g_url.c_str(), g_accept_shards);
         return 1;
     }
 
@@ -181,6 +183,9 @@ int main(int argc, char** argv)
     if (argc > 5)
         g_url = argv[5];
 
+    if (argc > 6)
+        g_accept_shards = atoi(argv[6]);
+
     go [&]{ start_server(g_url); };
     co_timer_add(std::chrono::milliseconds(100), [=]{ show_status(); });
     boost::thread_group tg;
@@ -0,0 +1,161 @@
+/**************************************************
+* 连接速率测试: 客户端协程循环地 connect -> (echo) -> close,
+* 统计服务端每秒建立和释放的session数.
+**************************************************/
+#include <iostream>
+#include <unistd.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+std::string g_url = "tcp://127.0.0.1:3060";
+std::atomic<unsigned long long> g_accepted{0};
+std::atomic<unsigned long long> g_closed{0};
+std::atomic<unsigned long long> g_connected{0};
+std::atomic<unsigned long long> g_connect_err{0};
+
+int g_thread_count = 1;
+int g_concurrency = 64;
+int g_accept_shards = 0;
+bool g_echo = true;
+
+boost::asio::io_service& GetIoService()
+{
+    static boost::asio::io_service ios;
+    return ios;
+}
+
+void start_server(std::string url)
+{
+    Server s;
+    s.SetListenBacklog(4096);
+    s.SetAcceptShards(g_accept_shards);
+    s.SetConnectedCb([&](SessionEntry){ ++g_accepted; })
+        .SetDisconnectedCb([&](SessionEntry, boost_ec const&){ ++g_closed; })
+        .SetReceiveCb([&](SessionEntry sess, const char* data, size_t bytes){
+                sess->Send(data, bytes);
+                return bytes;
+            });
+
+    boost_ec ec = s.goStart(url);
+    if (ec) {
+        printf("server start error: %s\n", ec.message().c_str());
+        exit(1);
+    }
+
+    for (;;)
+        co_sleep(10000);
+}
+
+void start_connector(::boost::asio::ip::tcp::endpoint addr)
+{
+    char c = 'x';
+    for (;;)
+    {
+        ::boost::asio::ip::tcp::socket s(GetIoService());
+        boost_ec ec;
+        s.connect(addr, ec);
+        if (ec) {
+            ++g_connect_err;
+            co_sleep(10);
+            continue;
+        }
+
+        if (g_echo) {
+            s.write_some(::boost::asio::buffer(&c, 1), ec);
+            if (!ec)
+                s.read_some(::boost::asio::buffer(&c, 1), ec);
+        }
+
+        if (ec)
+            ++g_connect_err;
+        else
+            ++g_connected;
+        s.close(ec);
+    }
+}
+
+void show_status()
+{
+    static int s_c = 0;
+    if (s_c++ % 10 == 0) {
+        // print title
+        printf("--------------------------------------------------------------------------------------------------------\n");
+        printf("------------- start Concurrency=%d, Echo=%d, Threads=%d, AcceptShards=%d URL=%s -------------\n",
+                g_concurrency, g_echo, g_thread_count, g_accept_shards, g_url.c_str());
+        printf(" index |  accepted/s  |   closed/s   |  connected/s  | connect_err/s\n");
+    }
+
+    static unsigned long long last_accepted{0};
+    static unsigned long long last_closed{0};
+    static unsigned long long last_connected{0};
+    static unsigned long long last_connect_err{0};
+
+    unsigned long long accepted = g_accepted - last_accepted;
+    unsigned long long closed = g_closed - last_closed;
+    unsigned long long connected = g_connected - last_connected;
+    unsigned long long connect_err = g_connect_err - last_connect_err;
+
+    printf("%6d | %12llu | %12llu | %13llu | %13llu\n",
+            s_c, accepted, closed, connected, connect_err);
+
+    last_accepted = g_accepted;
+    last_closed = g_closed;
+    last_connected = g_connected;
+    last_connect_err = g_connect_err;
+
+    co_timer_add(std::chrono::seconds(1), [=]{ show_status(); });
+}
+
+int main(int argc, char** argv)
+{
+    co_sched.GetOptions().enable_work_steal = false;
+
+    if (argc > 1 && argv[1] == std::string("-h")) {
+        printf("Usage %s [Concurrency] [Echo] [Threads] [AcceptShards] [URL]\n\n", argv[0]);
+        printf("Defaults [Concurrency=%d] [Echo=%d] [Threads=%d] [AcceptShards=%d] [URL=%s]\n\n",
+                g_concurrency, g_echo, g_thread_count, g_accept_shards, g_url.c_str());
+        return 1;
+    }
+
+    if (argc > 1)
+        g_concurrency = atoi(argv[1]);
+
+    if (argc > 2)
+        g_echo = !!atoi(argv[2]);
+
+    if (argc > 3)
+        g_thread_count = atoi(argv[3]);
+
+    if (argc > 4)
+        g_accept_shards = atoi(argv[4]);
+
+    if (argc > 5)
+        g_url = argv[5];
+
+    boost_ec ec;
+    endpoint addr = endpoint::from_string(g_url, ec);
+    if (ec) {
+        printf("url parse error: %s\n", ec.message().c_str());
+        return 1;
+    }
+
+    go [&]{ start_server(g_url); };
+    for (int i = 0; i < g_concurrency; ++i) {
+        ::boost::asio::ip::tcp::endpoint tcp_addr(addr);
+        go [tcp_addr]{
+            co_sleep(100);
+            start_connector(tcp_addr);
+        };
+    }
+
+    co_timer_add(std::chrono::milliseconds(100), [=]{ show_status(); });
+    boost::thread_group tg;
+    for (int i = 0; i < g_thread_count; ++i)
+        tg.create_thread([]{ co_sched.RunLoop(); });
+    tg.join_all();
+    return 0;
+}
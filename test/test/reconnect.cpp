@@ -0,0 +1,173 @@
+/**************************************************
+* TLS重连风暴测试: 客户端协程循环地 connect(握手) -> close,
+* 对比开启/关闭会话复用时每秒握手数和每次握手消耗的CPU时间.
+* 需要以ENABLE_SSL编译libgonet.
+**************************************************/
+#include <iostream>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+#if ENABLE_SSL
+std::string g_url = "ssl://127.0.0.1:3080";
+std::atomic<unsigned long long> g_connected{0};
+std::atomic<unsigned long long> g_connect_err{0};
+
+int g_thread_count = 1;
+int g_concurrency = 16;
+bool g_resume = true;
+int g_handshake_threads = 0;
+Server* g_server = nullptr;
+
+void start_server(std::string url)
+{
+    Server s;
+    OptionSSL ssl_opt;
+    ssl_opt.certificate_chain_file = "server.crt";
+    ssl_opt.private_key_file = "server.key";
+    ssl_opt.tmp_dh_file = "dh2048.pem";
+    if (!g_resume) {
+        ssl_opt.session_cache_size = 0;
+        ssl_opt.session_tickets = false;
+    }
+    s.SetSSLOption(ssl_opt);
+    s.SetListenBacklog(4096);
+    s.SetHandshakeThreads(g_handshake_threads);
+    // TLS1.3的会话票据在握手之后发送, 回一个字节保证客户端关闭前已经收到票据.
+    s.SetConnectedCb([&](SessionEntry sess){ sess->Send("x", 1); })
+        .SetReceiveCb([&](SessionEntry, const char*, size_t bytes){ return bytes; });
+
+    boost_ec ec = s.goStart(url);
+    if (ec) {
+        printf("server start error: %s\n", ec.message().c_str());
+        exit(1);
+    }
+    g_server = &s;
+
+    for (;;)
+        co_sleep(10000);
+}
+
+void start_connector(std::string url)
+{
+    OptionSSL ssl_opt;
+    ssl_opt.session_resume = g_resume;
+    for (;;)
+    {
+        std::atomic<bool> received{false};
+        Client c;
+        c.SetSSLOption(ssl_opt);
+        c.SetReceiveCb([&](SessionEntry, const char*, size_t bytes){
+                received = true;
+                return bytes;
+            });
+        boost_ec ec = c.Connect(url);
+        if (ec) {
+            ++g_connect_err;
+            co_sleep(10);
+            continue;
+        }
+
+        while (!received && c.IsEstab())
+            co_sleep(1);
+        ++g_connected;
+        c.Shutdown();
+        while (c.IsEstab())
+            co_sleep(1);
+    }
+}
+
+static uint64_t cpu_usec()
+{
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000
+        + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+void show_status()
+{
+    static int s_c = 0;
+    if (s_c++ % 10 == 0) {
+        // print title
+        printf("--------------------------------------------------------------------------------------------------------\n");
+        printf("------------- start Concurrency=%d, Resume=%d, Threads=%d, HandshakeThreads=%d URL=%s -------------\n",
+                g_concurrency, g_resume, g_thread_count, g_handshake_threads, g_url.c_str());
+        printf(" index |  connected/s  | connect_err/s | cpu us/connect | hs_queued | hs_rejected | hs_timeout\n");
+    }
+
+    static unsigned long long last_connected{0};
+    static unsigned long long last_connect_err{0};
+    static uint64_t last_cpu = cpu_usec();
+
+    unsigned long long connected = g_connected - last_connected;
+    unsigned long long connect_err = g_connect_err - last_connect_err;
+    uint64_t cpu = cpu_usec();
+
+    HandshakeStats hs;
+    if (g_server)
+        hs = g_server->GetHandshakeStats();
+
+    printf("%6d | %13llu | %13llu | %14llu | %9llu | %11llu | %10llu\n",
+            s_c, connected, connect_err,
+            connected ? (unsigned long long)(cpu - last_cpu) / connected : 0,
+            (unsigned long long)hs.queued, (unsigned long long)hs.rejected,
+            (unsigned long long)hs.timeout);
+
+    last_connected = g_connected;
+    last_connect_err = g_connect_err;
+    last_cpu = cpu;
+
+    co_timer_add(std::chrono::seconds(1), [=]{ show_status(); });
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && argv[1] == std::string("-h")) {
+        printf("Usage %s [Concurrency] [Resume] [Threads] [HandshakeThreads] [URL]\n\n", argv[0]);
+        printf("Defaults [Concurrency=%d] [Resume=%d] [Threads=%d] [HandshakeThreads=%d] [URL=%s]\n\n",
+                g_concurrency, g_resume, g_thread_count, g_handshake_threads, g_url.c_str());
+        return 1;
+    }
+
+    if (argc > 1)
+        g_concurrency = atoi(argv[1]);
+
+    if (argc > 2)
+        g_resume = !!atoi(argv[2]);
+
+    if (argc > 3)
+        g_thread_count = atoi(argv[3]);
+
+    if (argc > 4)
+        g_handshake_threads = atoi(argv[4]);
+
+    if (argc > 5)
+        g_url = argv[5];
+
+    go [&]{ start_server(g_url); };
+    for (int i = 0; i < g_concurrency; ++i)
+        go [&]{
+            co_sleep(100);
+            start_connector(g_url);
+        };
+
+    co_timer_add(std::chrono::milliseconds(100), [=]{ show_status(); });
+    boost::thread_group tg;
+    for (int i = 0; i < g_thread_count; ++i)
+        tg.create_thread([]{ co_sched.RunLoop(); });
+    tg.join_all();
+    return 0;
+}
+#else
+int main()
+{
+    printf("Not support ssl, please rebuild libgonet with cmake option: -DENABLE_SSL=ON\n");
+    return 1;
+}
+#endif
@@ -0,0 +1,156 @@
+/**************************************************
+* TLS吞吐测试: 客户端持续发送小包, 服务端只收不回,
+* 统计服务端每秒收到的明文字节数和客户端的发送积压.
+* 需要以ENABLE_SSL编译libgonet.
+**************************************************/
+#include <iostream>
+#include <unistd.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+#define MB / (1024 * 1024)
+
+#if ENABLE_SSL
+std::string g_url = "ssl://127.0.0.1:3070";
+std::atomic<unsigned long long> g_server_recv{0};
+std::atomic<unsigned long long> g_client_send{0};
+std::atomic<unsigned long long> g_client_send_err{0};
+
+int g_thread_count = 1;
+int g_concurrency = 16;
+int g_package = 64;
+bool g_ktls = false;
+
+void start_server(std::string url)
+{
+    Server s;
+    OptionSSL ssl_opt;
+    ssl_opt.certificate_chain_file = "server.crt";
+    ssl_opt.private_key_file = "server.key";
+    ssl_opt.tmp_dh_file = "dh2048.pem";
+    ssl_opt.ktls = g_ktls;
+    s.SetSSLOption(ssl_opt);
+    s.SetListenBacklog(1024);
+    s.SetReceiveCb([&](SessionEntry, const char*, size_t bytes){
+                g_server_recv += bytes;
+                return bytes;
+            });
+
+    boost_ec ec = s.goStart(url);
+    if (ec) {
+        printf("server start error: %s\n", ec.message().c_str());
+        exit(1);
+    }
+
+    for (;;)
+        co_sleep(10000);
+}
+
+void start_client(std::string url)
+{
+    Client c;
+    OptionSSL ssl_opt;
+    ssl_opt.ktls = g_ktls;
+    c.SetSSLOption(ssl_opt);
+    c.SetReceiveCb([&](SessionEntry, const char*, size_t bytes){ return bytes; });
+    boost_ec ec = c.Connect(url);
+    if (ec) {
+        printf("client connect error: %s\n", ec.message().c_str());
+        return ;
+    }
+
+    std::string data(g_package, 'x');
+    while (c.IsEstab()) {
+        // 积压过多时让出, 保持队列中总有一批小包可合并.
+        if (c.GetSession()->GetSendQueueSize() > 1024) {
+            co_yield;
+            continue;
+        }
+
+        c.Send(data.data(), data.size(), [](boost_ec const& ec){
+                if (ec)
+                    ++g_client_send_err;
+                else
+                    ++g_client_send;
+            });
+    }
+}
+
+void show_status()
+{
+    static int s_c = 0;
+    if (s_c++ % 10 == 0) {
+        // print title
+        printf("--------------------------------------------------------------------------------------------------------\n");
+        printf("------------- start Concurrency=%d, Package=%d, Threads=%d, Ktls=%d URL=%s -------------\n",
+                g_concurrency, g_package, g_thread_count, g_ktls, g_url.c_str());
+        printf(" index |  server_recv  |  client_send/s  | client_send_err/s\n");
+    }
+
+    static unsigned long long last_server_recv{0};
+    static unsigned long long last_client_send{0};
+    static unsigned long long last_client_send_err{0};
+
+    unsigned long long server_recv = g_server_recv - last_server_recv;
+    unsigned long long client_send = g_client_send - last_client_send;
+    unsigned long long client_send_err = g_client_send_err - last_client_send_err;
+
+    printf("%6d | %8llu MB/s | %15llu | %17llu\n",
+            s_c, server_recv MB, client_send, client_send_err);
+
+    last_server_recv = g_server_recv;
+    last_client_send = g_client_send;
+    last_client_send_err = g_client_send_err;
+
+    co_timer_add(std::chrono::seconds(1), [=]{ show_status(); });
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && argv[1] == std::string("-h")) {
+        printf("Usage %s [Concurrency] [Package] [Threads] [Ktls] [URL]\n\n", argv[0]);
+        printf("Defaults [Concurrency=%d] [Package=%d] [Threads=%d] [Ktls=%d] [URL=%s]\n\n",
+                g_concurrency, g_package, g_thread_count, g_ktls, g_url.c_str());
+        return 1;
+    }
+
+    if (argc > 1)
+        g_concurrency = atoi(argv[1]);
+
+    if (argc > 2)
+        g_package = atoi(argv[2]);
+
+    if (argc > 3)
+        g_thread_count = atoi(argv[3]);
+
+    if (argc > 4)
+        g_ktls = !!atoi(argv[4]);
+
+    if (argc > 5)
+        g_url = argv[5];
+
+    go [&]{ start_server(g_url); };
+    for (int i = 0; i < g_concurrency; ++i)
+        go [&]{
+            co_sleep(100);
+            start_client(g_url);
+        };
+
+    co_timer_add(std::chrono::milliseconds(100), [=]{ show_status(); });
+    boost::thread_group tg;
+    for (int i = 0; i < g_thread_count; ++i)
+        tg.create_thread([]{ co_sched.RunLoop(); });
+    tg.join_all();
+    return 0;
+}
+#else
+int main()
+{
+    printf("Not support ssl, please rebuild libgonet with cmake option: -DENABLE_SSL=ON\n");
+    return 1;
+}
+#endif
@@ -0,0 +1,170 @@
+/**************************************************
+* unix域socket与tcp回环的对比: 同一进程内先后在tcp://127.0.0.1和unix://上
+* 启动回显服务端, 每个连接循环地发送Package字节并等待完整回显(ping-pong),
+* 每个传输层跑Seconds秒, 统计每秒往返次数和平均往返延迟, 最后汇总对比.
+**************************************************/
+#include <iostream>
+#include <unistd.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+std::string g_tcp_url = "tcp://127.0.0.1:3090";
+std::string g_unix_url = "unix:///tmp/libgonet_udsbench.sock";
+std::atomic<unsigned long long> g_round_trips{0};
+std::atomic<unsigned long long> g_latency_us{0};
+std::atomic<unsigned long long> g_errors{0};
+std::atomic<bool> g_running{false};
+
+int g_thread_count = 1;
+int g_concurrency = 16;
+int g_package = 64;
+int g_seconds = 5;
+
+static uint64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void start_client(std::string url, std::atomic<int> & alive)
+{
+    std::string data(g_package, 'x');
+    size_t received = 0;
+    uint64_t start = 0;
+    Client c;
+    c.SetReceiveCb([&](SessionEntry sess, const char*, size_t bytes){
+                received += bytes;
+                if (received >= data.size()) {
+                    ++g_round_trips;
+                    g_latency_us += now_us() - start;
+                    received = 0;
+                    if (!g_running) {
+                        sess->Shutdown();
+                        return bytes;
+                    }
+                    start = now_us();
+                    sess->Send(data.data(), data.size());
+                }
+                return bytes;
+            });
+    boost_ec ec = c.Connect(url);
+    if (ec) {
+        ++g_errors;
+        printf("client connect error: %s\n", ec.message().c_str());
+        --alive;
+        return ;
+    }
+
+    start = now_us();
+    c.Send(data.data(), data.size());
+    while (c.IsEstab())
+        co_sleep(100);
+    --alive;
+}
+
+struct Result
+{
+    std::string url;
+    unsigned long long round_trips;
+    unsigned long long latency_us;
+};
+
+Result run(std::string url)
+{
+    Server s;
+    s.SetListenBacklog(1024);
+    s.SetReceiveCb([](SessionEntry sess, const char* data, size_t bytes){
+                sess->Send(data, bytes);
+                return bytes;
+            });
+    boost_ec ec = s.goStart(url);
+    if (ec) {
+        printf("server start error: %s\n", ec.message().c_str());
+        exit(1);
+    }
+
+    printf("--------------------------------------------------------------------------------------------------------\n");
+    printf("------------- start Concurrency=%d, Package=%d, Threads=%d URL=%s -------------\n",
+            g_concurrency, g_package, g_thread_count, url.c_str());
+    printf(" second | round trips/s | avg latency(us) | errors\n");
+
+    std::atomic<int> alive{g_concurrency};
+    g_running = true;
+    for (int i = 0; i < g_concurrency; ++i)
+        go [url, &alive]{ start_client(url, alive); };
+
+    // 第一秒用于建立连接, 不计入结果
+    co_sleep(1000);
+    Result total = {url, 0, 0};
+    for (int i = 1; i <= g_seconds; ++i) {
+        unsigned long long round_trips = g_round_trips;
+        unsigned long long latency = g_latency_us;
+        co_sleep(1000);
+        round_trips = g_round_trips - round_trips;
+        latency = g_latency_us - latency;
+        total.round_trips += round_trips;
+        total.latency_us += latency;
+        printf("%7d | %13llu | %15llu | %6llu\n", i, round_trips,
+                round_trips ? latency / round_trips : 0, (unsigned long long)g_errors);
+    }
+
+    g_running = false;
+    while (alive > 0)
+        co_sleep(10);
+    s.Shutdown();
+    return total;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && argv[1] == std::string("-h")) {
+        printf("Usage %s [Concurrency] [Package] [Threads] [Seconds] [TcpURL] [UnixURL]\n\n", argv[0]);
+        printf("Defaults [Concurrency=%d] [Package=%d] [Threads=%d] [Seconds=%d] [TcpURL=%s] [UnixURL=%s]\n\n",
+                g_concurrency, g_package, g_thread_count, g_seconds, g_tcp_url.c_str(), g_unix_url.c_str());
+        return 1;
+    }
+
+    if (argc > 1)
+        g_concurrency = atoi(argv[1]);
+
+    if (argc > 2)
+        g_package = (std::max)(atoi(argv[2]), 1);
+
+    if (argc > 3)
+        g_thread_count = atoi(argv[3]);
+
+    if (argc > 4)
+        g_seconds = (std::max)(atoi(argv[4]), 1);
+
+    if (argc > 5)
+        g_tcp_url = argv[5];
+
+    if (argc > 6)
+        g_unix_url = argv[6];
+
+    go []{
+        std::vector<Result> results;
+        results.push_back(run(g_tcp_url));
+        results.push_back(run(g_unix_url));
+
+        printf("--------------------------------------------------------------------------------------------------------\n");
+        printf(" %-40s | round trips/s | avg latency(us)\n", "url");
+        for (Result const& r : results)
+            printf(" %-40s | %13llu | %15llu\n", r.url.c_str(), r.round_trips / g_seconds,
+                    r.round_trips ? r.latency_us / r.round_trips : 0);
+        printf(" unix/tcp round trips: %.2fx\n",
+                results[0].round_trips ? (double)results[1].round_trips / results[0].round_trips : 0.0);
+        exit(0);
+    };
+
+    boost::thread_group tg;
+    for (int i = 0; i < g_thread_count; ++i)
+        tg.create_thread([]{ co_sched.RunLoop(); });
+    tg.join_all();
+    return 0;
+}
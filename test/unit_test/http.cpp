@@ -0,0 +1,345 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+// 逐字节喂给解析器, 模拟任意位置的分包.
+static std::vector<std::string> ParseByteByByte(std::string const& data)
+{
+    std::vector<std::string> bodies;
+    HttpRequestParser parser;
+    HttpRequest req;
+    size_t begin = 0;
+    for (size_t end = 1; end <= data.size(); ++end) {
+        size_t consumed = 0;
+        HttpRequestParser::result_t r = parser.Parse(data.data() + begin, end - begin, req, consumed);
+        EXPECT_NE(r, HttpRequestParser::error);
+        if (r == HttpRequestParser::complete) {
+            bodies.push_back(req.method.to_string() + " " + req.target.to_string() + " " + req.body.to_string());
+            begin += consumed;
+        }
+    }
+    EXPECT_EQ(begin, data.size());
+    return bodies;
+}
+
+TEST(testHttp, testParser)
+{
+    HttpRequestParser parser;
+    HttpRequest req;
+    size_t consumed = 0;
+    std::string data = "GET /index.html?a=1 HTTP/1.1\r\nHost: localhost\r\nX-Empty:\r\n"
+        "Connection: close\r\n\r\n";
+    ASSERT_EQ(parser.Parse(data.data(), data.size(), req, consumed), HttpRequestParser::complete);
+    EXPECT_EQ(consumed, data.size());
+    EXPECT_EQ(req.method, "GET");
+    EXPECT_EQ(req.path, "/index.html");
+    EXPECT_EQ(req.query, "a=1");
+    EXPECT_EQ(req.GetHeader("host"), "localhost");
+    EXPECT_EQ(req.GetHeader("x-empty"), "");
+    EXPECT_FALSE(req.keep_alive);
+
+    data = "GET / HTTP/1.0\r\n\r\n";
+    ASSERT_EQ(parser.Parse(data.data(), data.size(), req, consumed), HttpRequestParser::complete);
+    EXPECT_FALSE(req.keep_alive);
+
+    data = "GET / HTTP/2.0\r\n\r\n";
+    EXPECT_EQ(parser.Parse(data.data(), data.size(), req, consumed), HttpRequestParser::error);
+    parser.Reset();
+
+    data = "POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n";
+    EXPECT_EQ(parser.Parse(data.data(), data.size(), req, consumed), HttpRequestParser::error);
+    parser.Reset();
+
+    // pipelined, content-length and chunked bodies, split at every byte
+    data = "GET /a HTTP/1.1\r\n\r\n"
+        "POST /b HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+        "POST /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\nTrailer: x\r\n\r\n"
+        "GET /d HTTP/1.1\r\n\r\n";
+    std::vector<std::string> expected = {"GET /a ", "POST /b hello", "POST /c hello world", "GET /d "};
+    EXPECT_EQ(ParseByteByByte(data), expected);
+}
+
+// 各个扫描实现的结果必须与逐字节实现一致, 并且解析器在各实现下行为相同.
+TEST(testHttp, testScan)
+{
+    std::string data;
+    for (int i = 0; i < 4096; ++i)
+        data += (char)(i % 7 ? 'a' + i % 26 : i * 31 % 256);
+
+    std::vector<const char*> impls;
+    for (const char* name : {"scalar", "sse4.2", "avx2"})
+        if (HttpScan::SetImpl(name))
+            impls.push_back(name);
+    ASSERT_FALSE(impls.empty());
+
+    for (int cs = HttpScan::cs_token; cs <= HttpScan::cs_value; ++cs)
+        for (size_t off = 0; off < 64; ++off)
+            for (size_t len = 0; len < 100; len += 3) {
+                const char* p = data.data() + off;
+                HttpScan::SetImpl("scalar");
+                const char* expected = HttpScan::Find(p, p + len, (HttpScan::charset_t)cs);
+                for (const char* name : impls) {
+                    HttpScan::SetImpl(name);
+                    EXPECT_EQ(HttpScan::Find(p, p + len, (HttpScan::charset_t)cs), expected) << name;
+                }
+            }
+
+    std::string head = "GET /" + std::string(100, 'x') + " HTTP/1.1\r\n"
+        "Accept:  \t text/html, */*  \t\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n\r\n";
+    for (const char* name : impls) {
+        HttpScan::SetImpl(name);
+        HttpRequestParser parser;
+        HttpRequest req;
+        size_t consumed = 0;
+        ASSERT_EQ(parser.Parse(head.data(), head.size(), req, consumed), HttpRequestParser::complete) << name;
+        EXPECT_EQ(req.path.size(), 101u);
+        EXPECT_EQ(req.GetHeader("accept"), "text/html, */*");
+        EXPECT_EQ(req.headers.size(), 2u);
+
+        // 控制字符、名称中的空白、请求行中的换行
+        for (std::string bad : {"GET / HTTP/1.1\r\nHost: a\x01" "b\r\n\r\n",
+                "GET / HTTP/1.1\r\nBad Name: a\r\n\r\n",
+                "GET /a\n HTTP/1.1\r\n\r\n"}) {
+            parser.Reset();
+            EXPECT_EQ(parser.Parse(bad.data(), bad.size(), req, consumed), HttpRequestParser::error) << name;
+        }
+    }
+    HttpScan::SetImpl(impls.back());
+}
+
+TEST(testHttp, testServer)
+{
+    go []{
+        HttpRouter router;
+        router.Route("GET", "/hello", [](SessionRef, HttpRequest const&, HttpResponse & res){
+                    res.body = "hello";
+                })
+            .Route("POST", "/echo/", [](SessionRef, HttpRequest const& req, HttpResponse & res){
+                    res.SetHeader("Content-Type", "text/plain");
+                    res.body = req.body.to_string();
+                })
+            .Route("GET", "/stream", [](SessionRef, HttpRequest const&, HttpResponse & res){
+                    res.WriteChunk("ab", 2);
+                    res.body = "cd";
+                })
+            .Route("HEAD", "/stream", [](SessionRef, HttpRequest const&, HttpResponse & res){
+                    res.WriteChunk("ab", 2);
+                    res.body = "cd";
+                });
+
+        Server s;
+        s.SetHttpCb(router);
+        boost_ec ec = s.goStart("http://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+
+        std::string received;
+        boost_ec ignore_ec;
+        Client c;
+        c.SetReceiveCb([&](SessionEntry, const char* data, size_t bytes){
+                    received.append(data, bytes);
+                    return bytes;
+                });
+        ec = c.Connect("tcp://127.0.0.1:" + std::to_string(s.LocalAddr().port()));
+        ASSERT_FALSE(!!ec);
+
+        // 一次发出多个请求, 应答按请求顺序返回
+        std::string requests = "GET /hello HTTP/1.1\r\n\r\n"
+            "POST /echo/x HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+            "GET /stream HTTP/1.1\r\n\r\n"
+            "HEAD /stream HTTP/1.1\r\n\r\n"
+            "DELETE /hello HTTP/1.1\r\n\r\n"
+            "GET /none HTTP/1.1\r\nConnection: close\r\n\r\n"
+            "GET /hello HTTP/1.1\r\n\r\n";
+        c.Send(requests.data(), requests.size());
+        co_sleep(200);
+
+        std::string expected = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello"
+            "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 3\r\n\r\nabc"
+            "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nab\r\n2\r\ncd\r\n0\r\n\r\n"
+            // HEAD只有头部, 没有结束块
+            "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n"
+            "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        EXPECT_EQ(received, expected);
+        EXPECT_FALSE(c.IsEstab());
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
+
+TEST(testHttp, testClient)
+{
+    go []{
+        HttpRouter router;
+        router.Route("GET", "/hello", [](SessionRef, HttpRequest const&, HttpResponse & res){
+                    res.body = "hello";
+                })
+            .Route("POST", "/echo", [](SessionRef, HttpRequest const& req, HttpResponse & res){
+                    res.body = req.body.to_string();
+                })
+            .Route("GET", "/stream", [](SessionRef, HttpRequest const&, HttpResponse & res){
+                    res.WriteChunk("ab", 2);
+                    res.body = "cd";
+                })
+            .Route("GET", "/slow", [](SessionRef, HttpRequest const&, HttpResponse & res){
+                    co_sleep(300);
+                    res.body = "slow";
+                });
+
+        Server s;
+        s.SetHttpCb(router);
+        boost_ec ec = s.goStart("http://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+        std::string base = "http://127.0.0.1:" + std::to_string(s.LocalAddr().port());
+
+        HttpClient c;
+        c.SetHttpMaxConnsPerHost(1).SetHttpMaxPipeline(4);
+
+        // keep-alive: 连续的请求复用同一个连接
+        HttpClientResponse res;
+        for (int i = 0; i < 3; ++i) {
+            ec = c.Get(base + "/hello", res);
+            ASSERT_FALSE(!!ec);
+            EXPECT_EQ(res.status, 200);
+            EXPECT_EQ(res.body, "hello");
+        }
+        EXPECT_EQ(c.ConnectionCount(), 1u);
+
+        ec = c.Post(base + "/echo", "abc", res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(res.body, "abc");
+
+        ec = c.Get(base + "/none", res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(res.status, 404);
+
+        // 多个协程并发, 在同一连接上pipelining
+        std::atomic<int> ok{0};
+        co_chan<bool> done(4);
+        for (int i = 0; i < 4; ++i)
+            go [&]{
+                HttpClientResponse r;
+                if (!c.Get(base + "/hello", r) && r.body == "hello") ++ok;
+                done << true;
+            };
+        for (int i = 0; i < 4; ++i) { bool b; done >> b; }
+        EXPECT_EQ(ok, 4);
+        EXPECT_EQ(c.ConnectionCount(), 1u);
+
+        // 流式接收chunked应答
+        std::string streamed;
+        HttpClientRequest req;
+        req.url = base + "/stream";
+        req.on_body = [&](const char* data, size_t bytes){ streamed.append(data, bytes); };
+        ec = c.Do(req, res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(streamed, "abcd");
+        EXPECT_TRUE(res.body.empty());
+
+        // 超时后连接被关闭, 之后的请求使用新连接
+        req = HttpClientRequest();
+        req.url = base + "/slow";
+        req.timeout = 100;
+        ec = c.Do(req, res);
+        EXPECT_EQ(ec, MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_timeout));
+        ec = c.Get(base + "/hello", res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(res.body, "hello");
+
+        c.Shutdown();
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
+
+TEST(testHttp, testStatic)
+{
+    char dir[] = "/tmp/libgonet_static_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    std::string root = dir;
+    auto write_file = [&](std::string const& name, std::string const& data) {
+        FILE* fp = fopen((root + "/" + name).c_str(), "wb");
+        fwrite(data.data(), 1, data.size(), fp);
+        fclose(fp);
+    };
+    std::string big(1024 * 1024, 'x');
+    for (size_t i = 0; i < big.size(); i += 1000)
+        big[i] = 'a' + i % 26;
+    write_file("index.html", "<html>hi</html>");
+    write_file("big.bin", big);
+
+    go [&]{
+        HttpStatic files(root, "/static/");
+        files.SetMaxCachedFile(64 * 1024).SetRevalidateInterval(0);
+
+        Server s;
+        s.SetHttpCb(files);
+        boost_ec ec = s.goStart("http://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+        std::string base = "http://127.0.0.1:" + std::to_string(s.LocalAddr().port()) + "/static/";
+
+        HttpClient c;
+        HttpClientResponse res;
+        for (int i = 0; i < 2; ++i) {
+            ec = c.Get(base, res);
+            ASSERT_FALSE(!!ec);
+            EXPECT_EQ(res.status, 200);
+            EXPECT_EQ(res.body, "<html>hi</html>");
+            EXPECT_EQ(res.GetHeader("content-type"), "text/html; charset=utf-8");
+        }
+        EXPECT_EQ(files.CachedFiles(), 1u);
+
+        // 条件请求
+        HttpClientRequest req;
+        req.url = base + "index.html";
+        req.headers.push_back(std::make_pair("If-None-Match", res.GetHeader("etag").to_string()));
+        ec = c.Do(req, res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(res.status, 304);
+        EXPECT_TRUE(res.body.empty());
+
+        // 文件变化后重新读取
+        write_file("index.html", "<html>changed</html>");
+        ec = c.Get(base + "index.html", res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(res.body, "<html>changed</html>");
+
+        // 大文件以sendfile发送, 不进入缓存
+        ec = c.Get(base + "big.bin", res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(res.status, 200);
+        EXPECT_TRUE(res.body == big);
+        EXPECT_EQ(files.CachedFiles(), 1u);
+
+        req = HttpClientRequest();
+        req.method = "HEAD";
+        req.url = base + "big.bin";
+        ec = c.Do(req, res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(res.GetHeader("content-length"), std::to_string(big.size()));
+        EXPECT_TRUE(res.body.empty());
+
+        ec = c.Get(base + "../etc/passwd", res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(res.status, 404);
+        ec = c.Get(base + "none.html", res);
+        EXPECT_FALSE(!!ec);
+        EXPECT_EQ(res.status, 404);
+
+        c.Shutdown();
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+
+    unlink((root + "/index.html").c_str());
+    unlink((root + "/big.bin").c_str());
+    rmdir(dir);
+}
@@ -0,0 +1,216 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <map>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+static std::string FromHex(const char* hex)
+{
+    std::string s;
+    for (const char* p = hex; p[0] && p[1]; p += 2)
+        s += (char)std::stoi(std::string(p, 2), nullptr, 16);
+    return s;
+}
+
+static std::string Dump(Hpack::Headers const& headers)
+{
+    std::string s;
+    for (auto const& kv : headers)
+        s += kv.first + ": " + kv.second + "\n";
+    return s;
+}
+
+// RFC 7541 C.4: 带huffman编码和动态表的三个请求
+TEST(testHttp2, testHpack)
+{
+    HpackDecoder decoder;
+    Hpack::Headers headers;
+    std::string block = FromHex("828684418cf1e3c2e5f23a6ba0ab90f4ff");
+    ASSERT_TRUE(decoder.Decode((const uint8_t*)block.data(), block.size(), headers));
+    EXPECT_EQ(Dump(headers), ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\n");
+
+    headers.clear();
+    block = FromHex("828684be5886a8eb10649cbf");
+    ASSERT_TRUE(decoder.Decode((const uint8_t*)block.data(), block.size(), headers));
+    EXPECT_EQ(Dump(headers), ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\n"
+            "cache-control: no-cache\n");
+
+    headers.clear();
+    block = FromHex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf");
+    ASSERT_TRUE(decoder.Decode((const uint8_t*)block.data(), block.size(), headers));
+    EXPECT_EQ(Dump(headers), ":method: GET\n:scheme: https\n:path: /index.html\n:authority: www.example.com\n"
+            "custom-key: custom-value\n");
+    EXPECT_EQ(decoder.TableSize(), 164u);
+
+    // 编码器的输出可以被解码, 且不使用动态表
+    Buffer out;
+    Hpack::EncodeStatus(out, 200);
+    Hpack::EncodeStatus(out, 302);
+    Hpack::Encode(out, "content-type", "text/plain");
+    Hpack::Encode(out, "x-long", std::string(300, 'a'));
+    HpackDecoder d2;
+    headers.clear();
+    ASSERT_TRUE(d2.Decode((const uint8_t*)out.data(), out.size(), headers));
+    EXPECT_EQ(Dump(headers), ":status: 200\n:status: 302\ncontent-type: text/plain\nx-long: "
+            + std::string(300, 'a') + "\n");
+    EXPECT_EQ(d2.TableSize(), 0u);
+
+    // 一个4KB的动态表条目被单字节索引反复引用, 解码后的头部列表超过上限,
+    // 超出部分被丢弃, 但动态表仍然同步, 之后的头部块可以正常解码.
+    HpackDecoder d3;
+    Buffer bomb;
+    Hpack::EncodeInt(bomb, 0, 6, 0x40);
+    Hpack::EncodeString(bomb, "x-bomb");
+    Hpack::EncodeString(bomb, std::string(4000, 'b'));
+    for (int i = 0; i < 100; ++i)
+        Hpack::EncodeInt(bomb, Hpack::kStaticTableSize + 1, 7, 0x80);
+    headers.clear();
+    ASSERT_TRUE(d3.Decode((const uint8_t*)bomb.data(), bomb.size(), headers));
+    EXPECT_TRUE(d3.HeaderListTooLarge());
+    EXPECT_EQ(headers.size(), HttpRequestParser::kMaxHeaderSize / (6 + 4000 + 32));
+    bomb.clear();
+    Hpack::EncodeInt(bomb, Hpack::kStaticTableSize + 1, 7, 0x80);
+    headers.clear();
+    ASSERT_TRUE(d3.Decode((const uint8_t*)bomb.data(), bomb.size(), headers));
+    EXPECT_FALSE(d3.HeaderListTooLarge());
+    EXPECT_EQ(Dump(headers), "x-bomb: " + std::string(4000, 'b') + "\n");
+
+    // 填充超过7位
+    std::string bad = FromHex("fffffffc");
+    std::string plain;
+    EXPECT_FALSE(Hpack::HuffmanDecode((const uint8_t*)bad.data(), bad.size(), plain));
+}
+
+static void AppendRequest(Buffer & out, uint32_t id, std::string const& method,
+        std::string const& path, std::string const& body)
+{
+    Buffer block;
+    Hpack::Encode(block, ":method", method);
+    Hpack::Encode(block, ":scheme", "http");
+    Hpack::Encode(block, ":path", path);
+    Hpack::Encode(block, ":authority", "localhost");
+    Http2Frame::AppendHeaders(out, id, block.data(), block.size(), body.empty(),
+            Http2Frame::kDefaultMaxFrameSize);
+    if (!body.empty()) {
+        Http2Frame::AppendHeader(out, body.size(), h2_frame::data, h2_end_stream, id);
+        out.insert(out.end(), body.begin(), body.end());
+    }
+}
+
+TEST(testHttp2, testServer)
+{
+    go []{
+        HttpRouter router;
+        router.Route("GET", "/hello", [](SessionRef, HttpRequest const& req, HttpResponse & res){
+                    res.SetHeader("X-Version", std::to_string(req.major_version));
+                    res.body = "hello";
+                })
+            .Route("POST", "/echo", [](SessionRef, HttpRequest const& req, HttpResponse & res){
+                    res.body = req.GetHeader("host").to_string() + ":" + req.body.to_string();
+                })
+            .Route("GET", "/bad_raw", [](SessionRef, HttpRequest const&, HttpResponse & res){
+                    std::string raw = "not a response\r\n\r\n";
+                    res.SetRaw(SharedBuffer(new Buffer(raw.begin(), raw.end())));
+                });
+
+        Server s;
+        s.SetHttpCb(router).SetHttp2(true);
+        boost_ec ec = s.goStart("http://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+
+        std::string received;
+        Client c;
+        c.SetReceiveCb([&](SessionEntry, const char* data, size_t bytes){
+                    received.append(data, bytes);
+                    return bytes;
+                });
+        ec = c.Connect("tcp://127.0.0.1:" + std::to_string(s.LocalAddr().port()));
+        ASSERT_FALSE(!!ec);
+
+        Buffer out(Http2Frame::kPreface, Http2Frame::kPreface + Http2Frame::kPrefaceSize);
+        Http2Frame::AppendSettings(out, {});
+        AppendRequest(out, 1, "GET", "/hello", "");
+        AppendRequest(out, 3, "POST", "/echo", "abc");
+        AppendRequest(out, 5, "GET", "/none", "");
+        {
+            // 解码后超过SETTINGS_MAX_HEADER_LIST_SIZE的流被拒绝, 连接不受影响
+            Buffer block;
+            Hpack::Encode(block, ":method", "GET");
+            Hpack::Encode(block, ":scheme", "http");
+            Hpack::Encode(block, ":path", "/hello");
+            Hpack::EncodeInt(block, 0, 6, 0x40);
+            Hpack::EncodeString(block, "x-bomb");
+            Hpack::EncodeString(block, std::string(4000, 'b'));
+            for (int i = 0; i < 100; ++i)
+                Hpack::EncodeInt(block, Hpack::kStaticTableSize + 1, 7, 0x80);
+            Http2Frame::AppendHeaders(out, 7, block.data(), block.size(), true,
+                    Http2Frame::kDefaultMaxFrameSize);
+        }
+        // 无法还原的SetRaw应答重置这个流, 之后的流不受影响
+        AppendRequest(out, 9, "GET", "/bad_raw", "");
+        AppendRequest(out, 11, "GET", "/hello", "");
+        Http2Frame::AppendPing(out, "12345678", false);
+        c.Send(out.data(), out.size());
+        co_sleep(200);
+
+        std::map<uint32_t, std::string> responses;
+        std::map<uint32_t, uint32_t> resets;
+        bool settings = false, settings_ack = false, ping_ack = false;
+        HpackDecoder decoder;
+        size_t pos = 0;
+        while (received.size() - pos >= Http2Frame::kHeaderSize) {
+            Http2FrameHeader h = Http2Frame::ParseHeader(received.data() + pos);
+            ASSERT_LE(pos + Http2Frame::kHeaderSize + h.length, received.size());
+            const char* payload = received.data() + pos + Http2Frame::kHeaderSize;
+            pos += Http2Frame::kHeaderSize + h.length;
+            if (h.type == h2_frame::settings) {
+                (h.flags & h2_ack ? settings_ack : settings) = true;
+            } else if (h.type == h2_frame::ping) {
+                ping_ack = (h.flags & h2_ack) && std::string(payload, 8) == "12345678";
+            } else if (h.type == h2_frame::headers) {
+                Hpack::Headers headers;
+                ASSERT_TRUE(decoder.Decode((const uint8_t*)payload, h.length, headers));
+                responses[h.stream_id] += Dump(headers);
+            } else if (h.type == h2_frame::data) {
+                responses[h.stream_id] += std::string(payload, h.length);
+            } else if (h.type == h2_frame::rst_stream) {
+                const uint8_t* p = (const uint8_t*)payload;
+                resets[h.stream_id] = (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+            }
+        }
+        EXPECT_EQ(pos, received.size());
+        EXPECT_TRUE(settings);
+        EXPECT_TRUE(settings_ack);
+        EXPECT_TRUE(ping_ack);
+        EXPECT_EQ(responses[1], ":status: 200\nx-version: 2\ncontent-length: 5\nhello");
+        EXPECT_EQ(responses[3], ":status: 200\ncontent-length: 13\nlocalhost:abc");
+        EXPECT_EQ(responses[5], ":status: 404\ncontent-length: 0\n");
+        EXPECT_EQ(responses.count(7), 0u);
+        EXPECT_EQ(resets[7], (uint32_t)h2_error::enhance_your_calm);
+        EXPECT_EQ(responses.count(9), 0u);
+        EXPECT_EQ(resets[9], (uint32_t)h2_error::internal_error);
+        EXPECT_EQ(responses[11], responses[1]);
+        EXPECT_TRUE(c.IsEstab());
+
+        // 没有连接前言的连接仍按http/1.1处理
+        received.clear();
+        Client c1;
+        c1.SetReceiveCb([&](SessionEntry, const char* data, size_t bytes){
+                    received.append(data, bytes);
+                    return bytes;
+                });
+        ec = c1.Connect("tcp://127.0.0.1:" + std::to_string(s.LocalAddr().port()));
+        ASSERT_FALSE(!!ec);
+        std::string request = "GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n";
+        c1.Send(request.data(), request.size());
+        co_sleep(200);
+        EXPECT_EQ(received, "HTTP/1.1 200 OK\r\nX-Version: 1\r\nContent-Length: 5\r\nConnection: close\r\n\r\nhello");
+
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
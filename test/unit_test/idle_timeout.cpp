@@ -0,0 +1,86 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+// 客户端不发数据, 服务端读空闲超时后关闭连接.
+void test_read_idle()
+{
+    std::atomic<int> disconnected{0};
+    boost_ec close_ec;
+
+    Server s;
+    s.SetReadIdleTimeout(300)
+        .SetReceiveCb([](SessionEntry, const char*, size_t bytes){ return bytes; })
+        .SetDisconnectedCb([&](SessionEntry, boost_ec const& ec){
+                close_ec = ec;
+                ++disconnected;
+            });
+    boost_ec ec = s.goStart("tcp://127.0.0.1:0");
+    ASSERT_FALSE(!!ec);
+
+    boost_ec ignore_ec;
+    Client c;
+    ec = c.Connect(s.LocalAddr().to_string(ignore_ec));
+    ASSERT_FALSE(!!ec);
+
+    co_sleep(150);
+    EXPECT_TRUE(c.IsEstab());
+    EXPECT_EQ(disconnected, 0);
+
+    co_sleep(600);
+    EXPECT_EQ(disconnected, 1);
+    EXPECT_EQ(close_ec, MakeNetworkErrorCode(eNetworkErrorCode::ec_recv_timeout));
+    EXPECT_FALSE(c.IsEstab());
+    s.Shutdown();
+}
+
+// 客户端写空闲时发送心跳包, 服务端读空闲检测不会触发.
+void test_heartbeat()
+{
+    std::atomic<int> disconnected{0};
+    std::atomic<int> heartbeats{0};
+
+    Server s;
+    s.SetReadIdleTimeout(300)
+        .SetReceiveCb([&](SessionEntry, const char* data, size_t bytes){
+                heartbeats += std::count(data, data + bytes, 'h');
+                return bytes;
+            })
+        .SetDisconnectedCb([&](SessionEntry, boost_ec const&){ ++disconnected; });
+    boost_ec ec = s.goStart("tcp://127.0.0.1:0");
+    ASSERT_FALSE(!!ec);
+
+    boost_ec ignore_ec;
+    Client c;
+    c.SetWriteIdleTimeout(100)
+        .SetHeartbeatCb([](SessionEntry){ return Buffer(1, 'h'); });
+    ec = c.Connect(s.LocalAddr().to_string(ignore_ec));
+    ASSERT_FALSE(!!ec);
+
+    co_sleep(1000);
+    EXPECT_EQ(disconnected, 0);
+    EXPECT_GT(heartbeats, 3);
+    EXPECT_TRUE(c.IsEstab());
+
+    c.Shutdown();
+    s.Shutdown();
+}
+
+TEST(testIdleTimeout, testReadIdle)
+{
+    go test_read_idle;
+    co_sched.RunUntilNoTask();
+}
+
+TEST(testIdleTimeout, testHeartbeat)
+{
+    go test_heartbeat;
+    co_sched.RunUntilNoTask();
+}
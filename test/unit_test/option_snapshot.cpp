@@ -0,0 +1,25 @@
+#include <iostream>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <libgonet/network.h>
+using namespace std;
+using namespace network;
+
+TEST(testOptionSnapshot, testShared)
+{
+    Server server;
+    server.SetSndTimeout(100);
+
+    // 配置未修改时, 所有session共享同一份快照.
+    auto a = server.GetSnapshot();
+    auto b = server.GetSnapshot();
+    EXPECT_EQ(a.get(), b.get());
+    EXPECT_EQ(a->sndtimeo_, 100);
+
+    // 修改配置后重建快照, 已经取出的旧快照保持不变.
+    server.SetSndTimeout(200);
+    auto c = server.GetSnapshot();
+    EXPECT_NE(a.get(), c.get());
+    EXPECT_EQ(a->sndtimeo_, 100);
+    EXPECT_EQ(c->sndtimeo_, 200);
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+// 发送协程按需创建时, 多轮请求应答和连续发送的顺序都保持不变.
+TEST(testSendOnDemand, testEcho)
+{
+    go []{
+        std::atomic<int> disconnected{0};
+        Server s;
+        s.SetSendOnDemand(true)
+            .SetReceiveCb([](SessionEntry sess, const char* data, size_t bytes){
+                    sess->Send(data, bytes);
+                    return bytes;
+                })
+            .SetDisconnectedCb([&](SessionEntry, boost_ec const&){ ++disconnected; });
+        boost_ec ec = s.goStart("tcp://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+
+        std::string received;
+        boost_ec ignore_ec;
+        Client c;
+        c.SetSendOnDemand(true)
+            .SetReceiveCb([&](SessionEntry, const char* data, size_t bytes){
+                    received.append(data, bytes);
+                    return bytes;
+                });
+        ec = c.Connect(s.LocalAddr().to_string(ignore_ec));
+        ASSERT_FALSE(!!ec);
+
+        std::string expected;
+        for (int round = 0; round < 10; ++round) {
+            // 每轮之间留出时间让发送协程退出, 下一轮重新创建.
+            for (int i = 0; i < 100; ++i) {
+                std::string msg = std::to_string(round * 100 + i) + ",";
+                expected += msg;
+                c.Send(msg.data(), msg.size());
+            }
+            co_sleep(50);
+        }
+
+        co_sleep(200);
+        EXPECT_EQ(received, expected);
+        EXPECT_TRUE(c.IsEstab());
+
+        c.Shutdown();
+        co_sleep(200);
+        EXPECT_EQ(disconnected, 1);
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+static const int kSenders = 8;
+static const int kMessages = 16;
+static const size_t kMessageSize = 256 * 1024;
+
+// 多个线程上的协程同时向一个会话发送大于socket缓冲区的消息,
+// 直接写socket只写出一部分时, 剩余部分不能被其他消息插队, 每条消息在对端必须连续完整.
+TEST(testSendOrder, testLargeMessages)
+{
+    std::atomic<int> done{0};
+    go [&]{
+        SessionId sid = kInvalidSessionId;
+        Server s;
+        s.SetConnectedCb([&](SessionEntry sess){ sid = sess->GetId(); });
+        boost_ec ec = s.goStart("tcp://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+
+        // 每条消息由同一个字符填满, 字符标识发送者.
+        std::string pending;
+        int messages[kSenders] = {};
+        std::atomic<int> total{0};
+        std::atomic<int> corrupted{0};
+        boost_ec ignore_ec;
+        Client c;
+        c.SetReceiveCb([&](SessionEntry, const char* data, size_t bytes){
+                    pending.append(data, bytes);
+                    size_t pos = 0;
+                    for (; pending.size() - pos >= kMessageSize; pos += kMessageSize) {
+                        char tag = pending[pos];
+                        if (tag < 'A' || tag >= 'A' + kSenders
+                                || pending.find_first_not_of(tag, pos) < pos + kMessageSize)
+                            ++corrupted;
+                        else
+                            ++messages[tag - 'A'];
+                        ++total;
+                    }
+                    pending.erase(0, pos);
+                    return bytes;
+                });
+        ec = c.Connect(s.LocalAddr().to_string(ignore_ec));
+        ASSERT_FALSE(!!ec);
+
+        co_sleep(100);
+        ASSERT_NE(sid, kInvalidSessionId);
+
+        std::atomic<int> sended{0};
+        for (int i = 0; i < kSenders; ++i)
+            go [&, i]{
+                std::string msg(kMessageSize, 'A' + i);
+                for (int j = 0; j < kMessages; ++j)
+                    s.Send(sid, msg.data(), msg.size());
+                ++sended;
+            };
+
+        for (int i = 0; i < 500 && (sended < kSenders || total < kSenders * kMessages); ++i)
+            co_sleep(20);
+
+        EXPECT_EQ(corrupted, 0);
+        for (int i = 0; i < kSenders; ++i)
+            EXPECT_EQ(messages[i], kMessages) << "sender " << i;
+        EXPECT_TRUE(pending.empty());
+
+        c.Shutdown();
+        s.Shutdown();
+        ++done;
+    };
+
+    boost::thread_group tg;
+    for (int i = 0; i < 4; ++i)
+        tg.create_thread([]{ co_sched.RunUntilNoTask(); });
+    tg.join_all();
+    EXPECT_EQ(done, 1);
+}
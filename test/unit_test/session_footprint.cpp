@@ -0,0 +1,104 @@
+#include <iostream>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <atomic>
+#include <libgonet/network.h>
+#include <libgonet/tcp_detail.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+// TcpSession对象本身的大小上限, 超过说明有新增字段需要审视.
+static const size_t c_session_size_budget = 512;
+// 每个空闲连接的RSS上限(包括收发协程栈).
+static const size_t c_session_rss_budget = 32 * 1024;
+static const int c_sessions = 100000;
+
+static size_t GetRss()
+{
+    long pages = 0, rss = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (!fp) return 0;
+    if (fscanf(fp, "%ld %ld", &pages, &rss) != 2) rss = 0;
+    fclose(fp);
+    return (size_t)rss * sysconf(_SC_PAGESIZE);
+}
+
+// 受fd上限限制时按实际能建立的连接数测量, 再折算到100k.
+static int GetTestSessions()
+{
+    rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    getrlimit(RLIMIT_NOFILE, &rl);
+    return (std::min<int>)(c_sessions, ((int)rl.rlim_cur - 256) / 2);
+}
+
+TEST(testSessionFootprint, testSizeof)
+{
+    cout << "sizeof(TcpSession) = " << sizeof(tcp_detail::TcpSession) << endl;
+    cout << "sizeof(tcp_socket) = " << sizeof(tcp_socket) << endl;
+    EXPECT_LE(sizeof(tcp_detail::TcpSession), c_session_size_budget);
+}
+
+TEST(testSessionFootprint, testIdleRss)
+{
+    go []{
+        int n = GetTestSessions();
+        ASSERT_GT(n, 0);
+
+        std::atomic<int> connected{0};
+        Server s;
+        s.SetMaxConnection(n)
+            .SetConnectedCb([&](SessionEntry){ ++connected; })
+            .SetReceiveCb([](SessionEntry, const char*, size_t bytes){ return bytes; });
+        boost_ec ec = s.goStart("tcp://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+
+        size_t rss_before = GetRss();
+
+        // 用多个源地址, 避免单个源地址的临时端口耗尽.
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(s.LocalAddr().port());
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        std::vector<int> fds;
+        for (int i = 0; i < n; ++i) {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            ASSERT_GE(fd, 0);
+            sockaddr_in src = {};
+            src.sin_family = AF_INET;
+            src.sin_addr.s_addr = htonl(INADDR_LOOPBACK + 1 + i % 16);
+            if (::bind(fd, (sockaddr*)&src, sizeof(src)) < 0 ||
+                    ::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+                ::close(fd);
+                break;
+            }
+            fds.push_back(fd);
+        }
+        ASSERT_FALSE(fds.empty());
+
+        for (int i = 0; i < 100 && connected < (int)fds.size(); ++i)
+            co_sleep(100);
+        EXPECT_EQ(connected, (int)fds.size());
+
+        // RSS可能因释放内存而变小, 按有符号数计算, 变小时按0计.
+        long rss_delta = (long)GetRss() - (long)rss_before;
+        size_t per_session = rss_delta > 0 ? (size_t)rss_delta / fds.size() : 0;
+        cout << "sessions: " << fds.size()
+            << ", rss delta: " << rss_delta / 1024 << " KB"
+            << ", per session: " << per_session << " bytes"
+            << ", per 100k sessions: " << per_session * c_sessions / (1024 * 1024) << " MB"
+            << endl;
+        EXPECT_LE(per_session, c_session_rss_budget);
+
+        for (int fd : fds)
+            ::close(fd);
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
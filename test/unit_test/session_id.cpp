@@ -0,0 +1,131 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <libgonet/network.h>
+#include <libgonet/session_registry.h>
+using namespace std;
+using namespace network;
+
+struct Item
+{
+    int value;
+    explicit Item(int v) : value(v) {}
+};
+
+TEST(testSessionId, testGeneration)
+{
+    SessionRegistry<Item> registry;
+    auto a = boost::make_shared<Item>(1);
+    SessionId id_a = registry.Insert(a);
+    EXPECT_NE(id_a, kInvalidSessionId);
+    EXPECT_EQ(registry.Size(), 1u);
+    EXPECT_EQ(registry.Lookup(id_a), a);
+
+    EXPECT_TRUE(registry.Erase(id_a));
+    EXPECT_FALSE(registry.Erase(id_a));
+    EXPECT_EQ(registry.Size(), 0u);
+    EXPECT_FALSE(!!registry.Lookup(id_a));
+
+    // 复用同一个槽位, 但代数不同, 旧id不能查到新的对象.
+    auto b = boost::make_shared<Item>(2);
+    SessionId id_b = registry.Insert(b);
+    EXPECT_NE(id_a, id_b);
+    EXPECT_EQ((uint32_t)id_a, (uint32_t)id_b);
+    EXPECT_FALSE(!!registry.Lookup(id_a));
+    EXPECT_EQ(registry.Lookup(id_b), b);
+
+    EXPECT_FALSE(!!registry.Lookup(kInvalidSessionId));
+    EXPECT_FALSE(!!registry.Lookup(id_b + 12345));
+}
+
+TEST(testSessionId, testServerLookup)
+{
+    go []{
+        SessionId sid = kInvalidSessionId;
+        std::atomic<int> received{0};
+
+        Server s;
+        s.SetConnectedCb([&](SessionEntry sess){ sid = sess->GetId(); });
+        boost_ec ec = s.goStart("tcp://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+
+        boost_ec ignore_ec;
+        Client c;
+        c.SetReceiveCb([&](SessionEntry, const char*, size_t bytes){
+                received += bytes;
+                return bytes;
+            });
+        ec = c.Connect(s.LocalAddr().to_string(ignore_ec));
+        ASSERT_FALSE(!!ec);
+
+        co_sleep(100);
+        ASSERT_NE(sid, kInvalidSessionId);
+        EXPECT_TRUE(s.Lookup(sid)->IsEstab());
+        s.Send(sid, "ping", 4);
+        co_sleep(100);
+        EXPECT_EQ(received, 4);
+
+        c.Shutdown();
+        co_sleep(100);
+        EXPECT_FALSE(s.Lookup(sid)->IsEstab());
+
+        boost_ec send_ec;
+        s.Send(sid, "ping", 4, [&](boost_ec const& ec){ send_ec = ec; });
+        EXPECT_EQ(send_ec, MakeNetworkErrorCode(eNetworkErrorCode::ec_session_not_found));
+
+        // 无效id不能匹配到FakeSession
+        send_ec = boost_ec();
+        s.Send(kInvalidSessionId, "ping", 4, [&](boost_ec const& ec){ send_ec = ec; });
+        EXPECT_EQ(send_ec, MakeNetworkErrorCode(eNetworkErrorCode::ec_session_not_found));
+        send_ec = boost_ec();
+        s.Send(kInvalidSessionId, Buffer(4, 'x'), [&](boost_ec const& ec){ send_ec = ec; });
+        EXPECT_EQ(send_ec, MakeNetworkErrorCode(eNetworkErrorCode::ec_session_not_found));
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
+
+// 断开回调中仍能取到本地地址; 客户端重新连接到其他协议后, 旧session的地址不受影响.
+TEST(testSessionId, testAddrAfterClose)
+{
+    go []{
+        endpoint server_local, client_local;
+        Server s;
+        s.SetDisconnectedCb([&](SessionEntry sess, boost_ec const&){ server_local = sess->LocalAddr(); });
+        boost_ec ec = s.goStart("tcp://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+
+        std::string path = "/tmp/libgonet_unit_test_addr.sock";
+        ::unlink(path.c_str());
+        Server us;
+        ec = us.goStart("unix://" + path);
+        ASSERT_FALSE(!!ec);
+
+        boost_ec ignore_ec;
+        Client c;
+        c.SetDisconnectedCb([&](SessionEntry sess, boost_ec const&){ client_local = sess->LocalAddr(); });
+        ec = c.Connect(s.LocalAddr().to_string(ignore_ec));
+        ASSERT_FALSE(!!ec);
+        SessionEntry old = c.GetSession();
+        endpoint old_local = old->LocalAddr();
+        EXPECT_NE(old_local.port(), 0);
+
+        c.Shutdown();
+        co_sleep(100);
+        EXPECT_EQ(server_local.port(), s.LocalAddr().port());
+        EXPECT_EQ(client_local.port(), old_local.port());
+        EXPECT_EQ(client_local.proto(), proto_type::tcp);
+
+        ec = c.Connect("unix://" + path);
+        ASSERT_FALSE(!!ec);
+        EXPECT_EQ(c.GetSession()->LocalAddr().proto(), proto_type::uds);
+        EXPECT_EQ(old->LocalAddr().proto(), proto_type::tcp);
+        EXPECT_EQ(old->RemoteAddr().port(), s.LocalAddr().port());
+
+        c.Shutdown();
+        us.Shutdown();
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+// SetReceiveRefCb优先于SetReceiveCb; Lock()在回调之外持有session, 断开后Lock()返回空的entry.
+TEST(testSessionRef, testReceiveRefCb)
+{
+    go []{
+        std::atomic<int> ref_calls{0}, entry_calls{0};
+        SessionEntry saved;
+        Server s;
+        s.SetReceiveCb([&](SessionEntry, const char*, size_t bytes){
+                    ++entry_calls;
+                    return bytes;
+                })
+            .SetReceiveRefCb([&](SessionRef sess, const char* data, size_t bytes){
+                    ++ref_calls;
+                    if (!saved->GetId())
+                        saved = sess.Lock();
+                    sess->Send(data, bytes);
+                    return bytes;
+                });
+        boost_ec ec = s.goStart("tcp://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+
+        std::string received;
+        boost_ec ignore_ec;
+        Client c;
+        c.SetReceiveCb([&](SessionEntry, const char* data, size_t bytes){
+                    received.append(data, bytes);
+                    return bytes;
+                });
+        ec = c.Connect(s.LocalAddr().to_string(ignore_ec));
+        ASSERT_FALSE(!!ec);
+
+        c.Send("ping", 4);
+        co_sleep(100);
+        EXPECT_EQ(received, "ping");
+        EXPECT_GT(ref_calls, 0);
+        EXPECT_EQ(entry_calls, 0);
+
+        // 回调之外通过Lock()得到的entry仍然可用
+        ASSERT_NE(saved->GetId(), kInvalidSessionId);
+        EXPECT_TRUE(saved->IsEstab());
+        saved->Send("pong", 4);
+        co_sleep(100);
+        EXPECT_EQ(received, "pingpong");
+
+        c.Shutdown();
+        co_sleep(100);
+        EXPECT_FALSE(saved->IsEstab());
+        SessionRef ref(saved);
+        EXPECT_EQ(ref.Lock()->GetId(), kInvalidSessionId);
+
+        boost_ec send_ec;
+        ref.Lock()->Send("x", 1, [&](boost_ec const& ec){ send_ec = ec; });
+        EXPECT_EQ(send_ec, MakeNetworkErrorCode(eNetworkErrorCode::ec_shutdown));
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+#if ENABLE_SSL
+static OptionSSL ServerOption(std::string const& name)
+{
+    OptionSSL opt;
+    opt.certificate_chain_file = "ssl/" + name + ".crt";
+    opt.private_key_file = "ssl/" + name + ".key";
+    return opt;
+}
+
+// 以server_name发送SNI, 只信任cert的自签名证书; 成功说明服务端选择了这个证书.
+static bool Serves(std::string const& url, std::string const& server_name, std::string const& cert)
+{
+    OptionSSL opt;
+    opt.verify_mode = OptionSSL::verify_mode_t::required;
+    opt.verify_file = "ssl/" + cert + ".crt";
+    opt.server_name = server_name;
+    Client c;
+    c.SetSSLOption(opt);
+    boost_ec ec = c.Connect(url);
+    c.Shutdown();
+    return !ec;
+}
+
+TEST(testSni, testSelect)
+{
+    go []{
+        Server s;
+        s.SetSSLOption(ServerOption("default"))
+            .SetSSLHostOptions({{"a.test", ServerOption("a")}, {"*.wild.test", ServerOption("wild")}});
+        boost_ec ec = s.goStart("ssl://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+        boost_ec ignore_ec;
+        std::string url = s.LocalAddr().to_string(ignore_ec);
+
+        // 精确匹配, 主机名不区分大小写
+        EXPECT_TRUE(Serves(url, "a.test", "a"));
+        EXPECT_FALSE(Serves(url, "a.test", "default"));
+        EXPECT_TRUE(Serves(url, "A.Test", "a"));
+
+        // 通配符只匹配一级
+        EXPECT_TRUE(Serves(url, "x.wild.test", "wild"));
+        EXPECT_FALSE(Serves(url, "x.wild.test", "default"));
+        EXPECT_TRUE(Serves(url, "y.x.wild.test", "default"));
+
+        // 未匹配或未发送SNI时使用默认证书
+        EXPECT_TRUE(Serves(url, "other.test", "default"));
+        EXPECT_FALSE(Serves(url, "other.test", "a"));
+        EXPECT_TRUE(Serves(url, "", "default"));
+
+        // ReloadSSL时按新的主机名配置重建
+        s.SetSSLHostOptions({{"a.test", ServerOption("reload")}});
+        ec = s.ReloadSSL(ServerOption("default"));
+        EXPECT_FALSE(!!ec);
+        EXPECT_TRUE(Serves(url, "a.test", "reload"));
+        EXPECT_FALSE(Serves(url, "a.test", "a"));
+        EXPECT_TRUE(Serves(url, "x.wild.test", "default"));
+
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
+#endif
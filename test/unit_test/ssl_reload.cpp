@@ -0,0 +1,84 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+#if ENABLE_SSL
+static OptionSSL ServerOption(std::string const& name)
+{
+    OptionSSL opt;
+    opt.certificate_chain_file = "ssl/" + name + ".crt";
+    opt.private_key_file = "ssl/" + name + ".key";
+    return opt;
+}
+
+// 只信任name的自签名证书, 连接成功说明服务端出示的正是这个证书.
+static boost_ec ConnectTrusting(Client & c, std::string const& url, std::string const& name)
+{
+    OptionSSL opt;
+    opt.verify_mode = OptionSSL::verify_mode_t::required;
+    opt.verify_file = "ssl/" + name + ".crt";
+    c.SetSSLOption(opt);
+    return c.Connect(url);
+}
+
+TEST(testSslReload, testReload)
+{
+    go []{
+        Server s;
+        s.SetSSLOption(ServerOption("default"))
+            .SetReceiveCb([](SessionEntry sess, const char* data, size_t bytes){
+                    sess->Send(data, bytes);
+                    return bytes;
+                });
+        boost_ec ec = s.goStart("ssl://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+        boost_ec ignore_ec;
+        std::string url = s.LocalAddr().to_string(ignore_ec);
+
+        std::string received;
+        Client estab;
+        estab.SetReceiveCb([&](SessionEntry, const char* data, size_t bytes){
+                    received.append(data, bytes);
+                    return bytes;
+                });
+        ASSERT_FALSE(!!ConnectTrusting(estab, url, "default"));
+
+        // 切换证书, 之后的新连接使用新证书
+        ec = s.ReloadSSL(ServerOption("reload"));
+        EXPECT_FALSE(!!ec);
+        {
+            Client c;
+            EXPECT_FALSE(!!ConnectTrusting(c, url, "reload"));
+        }
+        {
+            Client c;
+            EXPECT_TRUE(!!ConnectTrusting(c, url, "default"));
+        }
+
+        // 已建立的连接不受影响
+        estab.Send("ping", 4);
+        co_sleep(100);
+        EXPECT_TRUE(estab.IsEstab());
+        EXPECT_EQ(received, "ping");
+
+        // 加载失败时返回错误, 保留原来的证书
+        OptionSSL bad = ServerOption("reload");
+        bad.certificate_chain_file = "ssl/none.crt";
+        ec = s.ReloadSSL(bad);
+        EXPECT_TRUE(!!ec);
+        {
+            Client c;
+            EXPECT_FALSE(!!ConnectTrusting(c, url, "reload"));
+        }
+
+        estab.Shutdown();
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
+#endif
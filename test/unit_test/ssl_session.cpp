@@ -0,0 +1,66 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <libgonet/network.h>
+#include <libgonet/ssl_session.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+#if ENABLE_SSL
+static OptionSSL ClientOption(OptionSSL::verify_mode_t verify_mode, std::string const& verify_file)
+{
+    OptionSSL opt;
+    opt.verify_mode = verify_mode;
+    opt.verify_file = verify_file;
+    return opt;
+}
+
+// 不校验证书的客户端保存的会话, 不能被要求校验的客户端复用来跳过证书校验.
+TEST(testSslSession, testResumeIsolation)
+{
+    go []{
+        OptionSSL server_opt;
+        server_opt.certificate_chain_file = "ssl/default.crt";
+        server_opt.private_key_file = "ssl/default.key";
+        Server s;
+        s.SetSSLOption(server_opt);
+        boost_ec ec = s.goStart("ssl://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+
+        boost_ec ignore_ec;
+        std::string url = s.LocalAddr().to_string(ignore_ec);
+        std::size_t stored = SslSessionStore::Instance().Size();
+
+        // 会话(TLS1.3的ticket)在握手之后收到, 留出时间保存.
+        {
+            Client c;
+            c.SetSSLOption(ClientOption(OptionSSL::verify_mode_t::none, ""));
+            ASSERT_FALSE(!!c.Connect(url));
+            co_sleep(100);
+            c.Shutdown();
+        }
+        EXPECT_GT(SslSessionStore::Instance().Size(), stored);
+
+        // 信任的CA与服务端证书不符, 只能完整握手并校验失败
+        {
+            Client c;
+            c.SetSSLOption(ClientOption(OptionSSL::verify_mode_t::required, "ssl/a.crt"));
+            EXPECT_TRUE(!!c.Connect(url));
+        }
+
+        // 同一个客户端配置仍可连接和复用
+        for (int i = 0; i < 2; ++i) {
+            Client c;
+            c.SetSSLOption(ClientOption(OptionSSL::verify_mode_t::required, "ssl/default.crt"));
+            EXPECT_FALSE(!!c.Connect(url)) << i;
+            co_sleep(100);
+            c.Shutdown();
+        }
+
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}
+#endif
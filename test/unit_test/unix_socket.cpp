@@ -0,0 +1,100 @@
+#include <iostream>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+// 在url上启动回显服务端, 连接后发送一次, 检查回显和地址
+static void EchoOver(std::string const& url)
+{
+    boost_ec ignore_ec;
+    Server s;
+    s.SetReceiveCb([](SessionEntry sess, const char* data, size_t bytes){
+                sess->Send(data, bytes);
+                return bytes;
+            });
+    boost_ec ec = s.goStart(url);
+    ASSERT_FALSE(!!ec) << url;
+    EXPECT_EQ(s.LocalAddr().to_string(ignore_ec), url);
+
+    std::string received;
+    Client c;
+    c.SetReceiveCb([&](SessionEntry, const char* data, size_t bytes){
+                received.append(data, bytes);
+                return bytes;
+            });
+    ec = c.Connect(url);
+    ASSERT_FALSE(!!ec) << url;
+    EXPECT_EQ(c.LocalAddr().proto(), proto_type::uds);
+
+    std::string data(100 * 1024, 'x');
+    c.Send(data.data(), data.size());
+    co_sleep(200);
+    EXPECT_TRUE(received == data);
+
+    c.Shutdown();
+    s.Shutdown();
+}
+
+TEST(testUnixSocket, testUnixSocket)
+{
+    go []{
+        std::string path = "/tmp/libgonet_unit_test.sock";
+        ::unlink(path.c_str());
+        EchoOver("unix://" + path);
+        // 关闭后删除socket文件
+        EXPECT_NE(::access(path.c_str(), F_OK), 0);
+
+        // 上次进程遗留的socket文件被替换, 仍在监听的则不能重复绑定
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path.c_str());
+        ASSERT_EQ(::bind(fd, (sockaddr*)&addr, sizeof(addr)), 0);
+        ::close(fd);
+        {
+            Server s;
+            s.SetAcceptShards(2);
+            ASSERT_FALSE(!!s.goStart("unix://" + path));
+            Server s2;
+            EXPECT_TRUE(!!s2.goStart("unix://" + path));
+
+            Client c;
+            EXPECT_FALSE(!!c.Connect("unix://" + path));
+            s.Shutdown();
+        }
+
+        // fork模型中只有绑定socket文件的进程在Shutdown时删除它
+        {
+            Server s;
+            ASSERT_FALSE(!!s.goStartBeforeFork("unix://" + path));
+            pid_t pid = fork();
+            if (pid == 0) {
+                s.Shutdown();
+                _exit(0);
+            }
+            ASSERT_GT(pid, 0);
+            int status = 0;
+            waitpid(pid, &status, 0);
+            EXPECT_EQ(::access(path.c_str(), F_OK), 0);
+            s.Shutdown();
+            EXPECT_NE(::access(path.c_str(), F_OK), 0);
+        }
+
+        EchoOver("unix://@libgonet_unit_test");
+
+        Client c;
+        EXPECT_TRUE(!!c.Connect("unix:///tmp/libgonet_unit_test_none.sock"));
+        Server s;
+        EXPECT_TRUE(!!s.goStart("unix://relative.sock"));
+    };
+    co_sched.RunUntilNoTask();
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <libgo/coroutine.h>
+#include <atomic>
+#include <libgonet/network.h>
+using namespace std;
+using namespace co;
+using namespace network;
+
+TEST(testWebSocket, testFrame)
+{
+    // RFC 6455 1.3
+    EXPECT_EQ(WsFrame::AcceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+
+    // 各种长度和偏移下与逐字节异或一致
+    char key[4] = {0x12, 0x34, 0x56, (char)0x9a};
+    for (size_t n = 0; n < 200; n += 3)
+        for (size_t offset = 0; offset < 4; ++offset) {
+            std::string src(n, 0), dst(n, 0);
+            for (size_t i = 0; i < n; ++i)
+                src[i] = (char)(i * 131);
+            WsFrame::Mask(&dst[0], src.data(), n, key, offset);
+            for (size_t i = 0; i < n; ++i)
+                ASSERT_EQ(dst[i], (char)(src[i] ^ key[(i + offset) & 3]));
+        }
+
+    // 分片之间穿插ping, 任意位置分包
+    std::string payload(70000, 0);
+    for (size_t i = 0; i < payload.size(); ++i)
+        payload[i] = (char)i;
+    Buffer data;
+    WsFrame::Append(data, ws_opcode::binary, payload.data(), 30000, true, false);
+    WsFrame::Append(data, ws_opcode::ping, "p", 1, true);
+    WsFrame::Append(data, ws_opcode::continuation, payload.data() + 30000, 40000, true);
+    for (size_t split : {1, 13, 4096, 1 << 20}) {
+        WsFrameParser parser;
+        std::vector<std::pair<ws_opcode, std::string>> messages;
+        size_t begin = 0, end = 0;
+        while (begin < data.size()) {
+            end = (std::min)(data.size(), end + split);
+            for (;;) {
+                size_t consumed = 0;
+                WsMessage msg;
+                WsFrameParser::result_t r = parser.Parse(&data[begin], end - begin, consumed, msg);
+                begin += consumed;
+                ASSERT_NE(r, WsFrameParser::error);
+                if (r == WsFrameParser::incomplete)
+                    break;
+                messages.emplace_back(msg.opcode, msg.data.to_string());
+            }
+        }
+        ASSERT_EQ(messages.size(), 2u);
+        EXPECT_TRUE(messages[0].first == ws_opcode::ping);
+        EXPECT_TRUE(messages[1].first == ws_opcode::binary);
+        EXPECT_TRUE(messages[1].second == payload);
+    }
+
+    // 服务端收到不带掩码的帧, 超长消息
+    size_t consumed = 0;
+    WsMessage msg;
+    Buffer unmasked;
+    WsFrame::Append(unmasked, ws_opcode::text, "abc", 3, false);
+    WsFrameParser server;
+    EXPECT_EQ(server.Parse(&unmasked[0], unmasked.size(), consumed, msg), WsFrameParser::error);
+    EXPECT_EQ(server.ErrorCode(), 1002);
+
+    WsFrameParser limited;
+    limited.SetMaxMessageSize(100);
+    EXPECT_EQ(limited.Parse(&data[0], data.size(), consumed, msg), WsFrameParser::error);
+    EXPECT_EQ(limited.ErrorCode(), 1009);
+}
+
+TEST(testWebSocket, testEcho)
+{
+    go []{
+        Server s;
+        s.SetWsHandshakeCb([](SessionRef, HttpRequest const& req, HttpResponse & res){
+                    return req.path == "/echo";
+                })
+            .SetWsMessageCb([](SessionRef sess, WsMessage const& msg){
+                    if (msg.opcode == ws_opcode::text || msg.opcode == ws_opcode::binary)
+                        WebSocket::Send(sess, msg.opcode, msg.data.data(), msg.data.size());
+                });
+        boost_ec ec = s.goStart("ws://127.0.0.1:0");
+        ASSERT_FALSE(!!ec);
+        std::string port = std::to_string(s.LocalAddr().port());
+
+        Client rejected;
+        ec = rejected.Connect("ws://127.0.0.1:" + port + "/other");
+        EXPECT_EQ(ec, MakeNetworkErrorCode(eNetworkErrorCode::ec_handshake_rejected));
+
+        std::vector<std::string> received;
+        bool closed = false;
+        Client c;
+        c.SetWsMessageCb([&](SessionRef, WsMessage const& msg){
+                    if (msg.opcode == ws_opcode::close)
+                        closed = true;
+                    else
+                        received.push_back(msg.data.to_string());
+                });
+        ec = c.Connect("ws://127.0.0.1:" + port + "/echo");
+        ASSERT_FALSE(!!ec);
+
+        std::string big(100000, 'x');
+        WebSocket::SendText(c.GetSession(), "hello");
+        WebSocket::SendBinary(c.GetSession(), big.data(), big.size());
+        co_sleep(200);
+        ASSERT_EQ(received.size(), 2u);
+        EXPECT_EQ(received[0], "hello");
+        EXPECT_TRUE(received[1] == big);
+
+        // 由客户端发起关闭, 服务端回应后断开
+        WebSocket::Close(c.GetSession());
+        co_sleep(200);
+        EXPECT_TRUE(closed);
+        EXPECT_FALSE(c.IsEstab());
+        s.Shutdown();
+    };
+    co_sched.RunUntilNoTask();
+}